@@ -0,0 +1,63 @@
+import os, sys, re, csv, argparse, subprocess, statistics
+from bench_sweep import parse_report, int_list, STAGES
+# Comparación de layouts de Precomp: el binario por defecto (12 B, deltas int16 y
+# color+radio empaquetados) contra uno compilado con -DPRECOMP_FLOAT (24 B en floats).
+# Mismo mundo y flags en ambos; cada N deja una fila por binario con la mediana de reps.
+BIN = os.path.join("paralelo", "bin", "screensaver_par")
+BIN_F32 = os.path.join("paralelo", "bin", "screensaver_par_f32")
+OUT = os.path.join("analysis_output", "layout_results.csv")
+FIELDS = ["layout", "precomp_bytes", "n", "threads", "frames", "reps"] + [f"{s}_ms" for s in STAGES] + ["wall_ms", "mb_per_frame"]
+BYTES_RE = re.compile(r"Precomp (\d+) B")
+
+def run(binary, n, a):
+    cmd = [binary, "--headless", "1", "--frames", str(a.frames), "--seed", str(a.seed), "--n", str(n),
+           "--threads", str(a.threads), "--fused", "0"] + a.extra
+    p = subprocess.run(cmd, capture_output=True, text=True, timeout=a.timeout)
+    rep = parse_report(p.stdout)
+    if p.returncode != 0 or "wall" not in rep:
+        sys.exit(f"Falló {' '.join(cmd)}: {(p.stderr.strip().splitlines() or [f'exit {p.returncode}'])[-1]}")
+    m = BYTES_RE.search(p.stdout)
+    return rep, int(m.group(1)) if m else 0
+
+def main():
+    ap = argparse.ArgumentParser(description="Layout de Precomp: empaquetado (12 B) vs floats (24 B), headless")
+    ap.add_argument("--bin", default=BIN, help="binario por defecto (Precomp empaquetado)")
+    ap.add_argument("--bin-f32", default=BIN_F32, help="binario compilado con -DPRECOMP_FLOAT")
+    ap.add_argument("--out", default=OUT, help="CSV de resultados (se sobrescribe)")
+    ap.add_argument("--n", default="1e5,1e6,4e6", help="lista de N")
+    ap.add_argument("--threads", type=int, default=0, help="hilos (0 = todos)")
+    ap.add_argument("--frames", type=int, default=60)
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--seed", type=int, default=42)
+    ap.add_argument("--timeout", type=float, default=600.0, help="segundos por corrida")
+    ap.add_argument("extra", nargs="*", help="flags extra para ambos binarios (tras --)")
+    a = ap.parse_args()
+
+    for b in (a.bin, a.bin_f32):
+        if not os.path.exists(b):
+            sys.exit(f"No existe el binario {b} (ver paralelo/README.md, variante E)")
+    os.makedirs(os.path.dirname(a.out) or ".", exist_ok=True)
+    rows = []
+    for n in int_list(a.n):
+        for layout, binary in (("packed", a.bin), ("float", a.bin_f32)):
+            reps = [run(binary, n, a) for _ in range(a.reps)]
+            nbytes = reps[0][1]
+            row = dict(layout=layout, precomp_bytes=nbytes, n=n, threads=a.threads, frames=a.frames, reps=a.reps,
+                       mb_per_frame=round(nbytes * n / 1e6, 2))
+            for s in STAGES + ["wall"]:
+                row[f"{s}_ms"] = statistics.median(r[0].get(s, 0.0) for r in reps)
+            rows.append(row)
+            print(f"  n={n:<9d} {layout:6s} {nbytes:2d} B ({row['mb_per_frame']:7.2f} MB/frame) → "
+                  f"precalc {row['precalc_ms']:8.3f}  render {row['render_ms']:8.3f}  wall {row['wall_ms']:8.3f} ms/frame")
+        f32, pk = rows[-1], rows[-2]
+        if pk["wall_ms"] > 0:
+            print(f"  n={n:<9d} float/packed: precalc ×{f32['precalc_ms'] / max(pk['precalc_ms'], 1e-9):.2f}, "
+                  f"wall ×{f32['wall_ms'] / pk['wall_ms']:.2f}")
+    with open(a.out, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=FIELDS)
+        w.writeheader()
+        w.writerows(rows)
+    print(f"Listo → {a.out}")
+
+if __name__ == "__main__":
+    main()
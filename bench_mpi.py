@@ -0,0 +1,72 @@
+import os, sys, csv, shlex, argparse, subprocess, time
+from bench_sweep import FIELDS, int_list, parse_report, frames_for, plan, command, STAGES
+# Escalado entre nodos (fuerte y débil) del binario compilado con -DUSE_MPI, headless.
+# Mismo CSV tidy que bench_sweep.py con p = ranks en la columna threads (cada rank usa
+# --threads-per-rank hilos), así compare_speedup.py lo analiza igual y deja las salidas con
+# prefijo mpi_. El lanzador decide nodos y reparto: p. ej. "mpirun --hostfile hosts -np {ranks}".
+BIN = os.path.join("paralelo", "bin", "screensaver_par_mpi")
+OUT = os.path.join("analysis_output", "mpi_scaling_results.csv")
+MPI_FIELDS = FIELDS + ["ranks", "threads_per_rank", "launcher"]
+
+def main():
+    ap = argparse.ArgumentParser(description="Barrido de escalado fuerte/débil entre ranks MPI (headless)")
+    ap.add_argument("--bin", default=BIN, help="binario compilado con -DUSE_MPI")
+    ap.add_argument("--out", default=OUT, help="CSV tidy de resultados (se agrega al final)")
+    ap.add_argument("--ranks", type=int_list, default=[1, 2, 4], help="lista de ranks, p.ej. 1,2,4,8")
+    ap.add_argument("--threads-per-rank", type=int, default=0, help="hilos OpenMP por rank (0 = todos)")
+    ap.add_argument("--launcher", default="mpirun -np {ranks}", help="comando de lanzamiento ({ranks} = p)")
+    ap.add_argument("--n", default="1e5,1e6,1e7", help="N del escalado fuerte")
+    ap.add_argument("--weak-n", default="1e5,1e6", help="N por rank del escalado débil (vacío = no)")
+    ap.add_argument("--sym", default="6", help="valores de --sym")
+    ap.add_argument("--mirror", default="1", help="valores de --mirror")
+    ap.add_argument("--ssaa", default="1", help="valores de --ssaa")
+    ap.add_argument("--frames", type=int, default=120)
+    ap.add_argument("--min-frames", type=int, default=10)
+    ap.add_argument("--work", type=float, default=2e8, help="tope de n·frames por corrida (0 = sin tope)")
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--seed", type=int, default=42)
+    ap.add_argument("--width", type=int, default=800, help="ancho de la tesela de cada rank")
+    ap.add_argument("--height", type=int, default=600)
+    ap.add_argument("--timeout", type=float, default=900.0, help="segundos por corrida")
+    ap.add_argument("--dry-run", action="store_true", help="solo imprime los comandos")
+    ap.add_argument("extra", nargs="*", help="flags extra para el binario (tras --)")
+    a = ap.parse_args()
+    a.threads = a.ranks  # plan() recorre p en a.threads
+
+    runs = plan(a)
+    cmd = lambda r, frames: (shlex.split(a.launcher.format(ranks=r["threads"]))
+                             + command(dict(r, threads=a.threads_per_rank), frames, a))
+    print(f"🔎 {len(runs)} configuraciones × {a.reps} repeticiones → {a.out}")
+    if a.dry_run:
+        for r in runs: print(" ".join(cmd(r, frames_for(r["n"], a))))
+        return
+    if not os.path.exists(a.bin):
+        sys.exit(f"No existe el binario {a.bin} (ver paralelo/README.md, variante F)")
+    os.makedirs(os.path.dirname(a.out) or ".", exist_ok=True)
+    new = not os.path.exists(a.out) or os.path.getsize(a.out) == 0
+    with open(a.out, "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=MPI_FIELDS)
+        if new: w.writeheader()
+        for i, r in enumerate(runs):
+            frames = frames_for(r["n"], a)
+            for rep in range(a.reps):
+                row = dict(r, rep=rep, frames=frames, width=a.width, height=a.height, ok=0, error="",
+                           ranks=r["threads"], threads_per_rank=a.threads_per_rank, launcher=a.launcher)
+                t0 = time.time()
+                try:
+                    p = subprocess.run(cmd(r, frames), capture_output=True, text=True, timeout=a.timeout)
+                    rep_ms = parse_report(p.stdout)  # Solo el rank 0 imprime el reporte
+                    if p.returncode != 0 or "wall" not in rep_ms:
+                        row["error"] = (p.stderr.strip().splitlines() or [f"exit {p.returncode}"])[-1][:120]
+                    else:
+                        for s in STAGES: row[f"{s}_ms"] = rep_ms.get(s, "")
+                        row["total_ms"] = rep_ms.get("total", ""); row["wall_ms"] = rep_ms["wall"]; row["ok"] = 1
+                except subprocess.TimeoutExpired:
+                    row["error"] = "timeout"
+                w.writerow(row); f.flush()
+                print(f"  [{i+1}/{len(runs)}] {r['mode']:6s} ranks={r['threads']:<3d} n={r['n']:<9d} rep={rep} → "
+                      f"{row.get('wall_ms') or row['error']} (wait {row.get('wait_ms', '-')}) ({time.time()-t0:.1f}s)")
+    print("Listo")
+
+if __name__ == "__main__":
+    main()
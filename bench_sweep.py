@@ -0,0 +1,106 @@
+import os, sys, re, csv, argparse, subprocess, itertools, time
+# Barrido de escalado (fuerte y débil) del binario paralelo en modo headless.
+# Cada corrida deja una fila en un único CSV "tidy" que compare_speedup.py convierte en
+# curvas de speedup, eficiencia, fracción serial de Karp–Flatt y escalado débil.
+BIN = os.path.join("paralelo", "bin", "screensaver_par")
+OUT = os.path.join("analysis_output", "scaling_results.csv")
+# Etapas que imprime el reporte headless, en el mismo orden
+STAGES = ["events","update","precalc","render","resolve","present","wait"]
+FIELDS = (["mode","threads","n","n_per_thread","sym","mirror","ssaa","rep","frames","width","height"]
+          + [f"{s}_ms" for s in STAGES] + ["total_ms","wall_ms","ok","error"])
+STAGE_RE = re.compile(r"^\s+(\w+)\s+([0-9.]+) ms/frame")
+
+def default_threads():
+    p = os.cpu_count() or 1
+    ts, t = [], 1
+    while t < p: ts.append(t); t *= 2
+    return ts + [p]
+
+def int_list(s): return [int(float(x)) for x in s.split(",") if x.strip()]
+
+def parse_report(out):
+    """Lee las líneas '<etapa>  X ms/frame' del reporte headless."""
+    r = {}
+    for line in out.splitlines():
+        m = STAGE_RE.match(line)
+        if m: r[m.group(1)] = float(m.group(2))
+    return r
+
+def frames_for(n, a):
+    """Con --work se acotan los frames para que n·frames no explote en N grandes."""
+    if a.work <= 0: return a.frames
+    return max(a.min_frames, min(a.frames, int(a.work // max(n, 1))))
+
+def plan(a):
+    """Lista de corridas: fuerte = N fijo para cada p; débil = N = n0·p."""
+    runs = []
+    cfgs = list(itertools.product(int_list(a.sym), int_list(a.mirror), int_list(a.ssaa)))
+    for (sym, mirror, ssaa), n, p in itertools.product(cfgs, int_list(a.n), a.threads):
+        runs.append(dict(mode="strong", threads=p, n=n, n_per_thread=n // p, sym=sym, mirror=mirror, ssaa=ssaa))
+    for (sym, mirror, ssaa), n0, p in itertools.product(cfgs, int_list(a.weak_n), a.threads):
+        runs.append(dict(mode="weak", threads=p, n=n0 * p, n_per_thread=n0, sym=sym, mirror=mirror, ssaa=ssaa))
+    return runs
+
+def command(r, frames, a):
+    return [a.bin, "--headless", "1", "--frames", str(frames), "--seed", str(a.seed),
+            "--n", str(r["n"]), "--threads", str(r["threads"]), "--sym", str(r["sym"]),
+            "--mirror", str(r["mirror"]), "--ssaa", str(r["ssaa"]),
+            "--width", str(a.width), "--height", str(a.height)] + a.extra
+
+def main():
+    ap = argparse.ArgumentParser(description="Barrido de escalado fuerte/débil (headless)")
+    ap.add_argument("--bin", default=BIN, help="binario paralelo")
+    ap.add_argument("--out", default=OUT, help="CSV tidy de resultados (se agrega al final)")
+    ap.add_argument("--threads", type=int_list, default=default_threads(), help="lista de hilos, p.ej. 1,2,4,8")
+    ap.add_argument("--n", default="1e3,1e4,1e5,1e6,1e7", help="N del escalado fuerte")
+    ap.add_argument("--weak-n", default="1e4,1e5", help="N por hilo del escalado débil (vacío = no)")
+    ap.add_argument("--sym", default="1,6", help="valores de --sym")
+    ap.add_argument("--mirror", default="0,1", help="valores de --mirror")
+    ap.add_argument("--ssaa", default="1,2", help="valores de --ssaa")
+    ap.add_argument("--frames", type=int, default=120)
+    ap.add_argument("--min-frames", type=int, default=10)
+    ap.add_argument("--work", type=float, default=2e8, help="tope de n·frames por corrida (0 = sin tope)")
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--seed", type=int, default=42)
+    ap.add_argument("--width", type=int, default=800)
+    ap.add_argument("--height", type=int, default=600)
+    ap.add_argument("--timeout", type=float, default=600.0, help="segundos por corrida")
+    ap.add_argument("--dry-run", action="store_true", help="solo imprime los comandos")
+    ap.add_argument("extra", nargs="*", help="flags extra para el binario (tras --)")
+    a = ap.parse_args()
+
+    runs = plan(a)
+    print(f"🔎 {len(runs)} configuraciones × {a.reps} repeticiones → {a.out}")
+    if a.dry_run:
+        for r in runs: print(" ".join(command(r, frames_for(r["n"], a), a)))
+        return
+    if not os.path.exists(a.bin):
+        sys.exit(f"No existe el binario {a.bin} (compílalo primero, ver paralelo/README.md)")
+    os.makedirs(os.path.dirname(a.out) or ".", exist_ok=True)
+    new = not os.path.exists(a.out) or os.path.getsize(a.out) == 0
+    with open(a.out, "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=FIELDS)
+        if new: w.writeheader()
+        for i, r in enumerate(runs):
+            frames = frames_for(r["n"], a)
+            for rep in range(a.reps):
+                row = dict(r, rep=rep, frames=frames, width=a.width, height=a.height, ok=0, error="")
+                t0 = time.time()
+                try:
+                    p = subprocess.run(command(r, frames, a), capture_output=True, text=True, timeout=a.timeout)
+                    rep_ms = parse_report(p.stdout)
+                    if p.returncode != 0 or "wall" not in rep_ms:
+                        row["error"] = (p.stderr.strip().splitlines() or [f"exit {p.returncode}"])[-1][:120]
+                    else:
+                        for s in STAGES: row[f"{s}_ms"] = rep_ms.get(s, "")
+                        row["total_ms"] = rep_ms.get("total", ""); row["wall_ms"] = rep_ms["wall"]; row["ok"] = 1
+                except subprocess.TimeoutExpired:
+                    row["error"] = "timeout"
+                w.writerow(row); f.flush()
+                print(f"  [{i+1}/{len(runs)}] {r['mode']:6s} p={r['threads']:<3d} n={r['n']:<9d} "
+                      f"sym={r['sym']} mirror={r['mirror']} ssaa={r['ssaa']} rep={rep} → "
+                      f"{row.get('wall_ms') or row['error']} ({time.time()-t0:.1f}s)")
+    print("Listo")
+
+if __name__ == "__main__":
+    main()
@@ -1,4 +1,4 @@
-import os, glob
+import os, glob, struct
 from collections import Counter, defaultdict
 import numpy as np
 import pandas as pd
@@ -9,9 +9,39 @@ WARMUP_SECONDS = 1.0
 OUT_DIR = "analysis_output"
 SEQ_DIR = os.path.join("secuencial", "runs")
 PAR_DIR = os.path.join("paralelo", "runs")
+# Etapas del frame que ambos binarios registran como <etapa>_ms_mean / <etapa>_ms_p95
+PHASES = ["events","update","precalc","render","resolve","present","wait"]
+# Resultados tidy del barrido de escalado (bench_sweep.py)
+SCALING_CSV = os.path.join(OUT_DIR, "scaling_results.csv")
+# Mismo formato entre nodos (bench_mpi.py): la columna threads cuenta ranks MPI
+MPI_SCALING_CSV = os.path.join(OUT_DIR, "mpi_scaling_results.csv")
+SCALING_CFG = ["n","sym","mirror","ssaa"]
 
 def ensure_outdir(p): os.makedirs(p, exist_ok=True)
-def find_csvs(d): return sorted(glob.glob(os.path.join(d, "*.csv")))
+def find_csvs(d): return sorted(glob.glob(os.path.join(d, "*.csv")) + glob.glob(os.path.join(d, "*.sslog")))
+
+def read_sslog(path):
+    """Log binario (--log-format bin): cabecera con columnas y meta, luego registros fijos por frame."""
+    with open(path, "rb") as f:
+        head = f.read(24)
+        if len(head) < 24 or head[:8] != b"SSLOGv1\0":
+            raise ValueError("no es un log binario")
+        header_bytes, record_bytes, ncols, meta_bytes = struct.unpack("<4I", head[8:])
+        cols = f.read(32 * ncols)
+        meta = f.read(meta_bytes).decode("utf-8", "replace")
+    names, formats, offsets = [], [], []
+    for c in range(ncols):
+        name, fmt, off = struct.unpack("<24s4sI", cols[32 * c:32 * (c + 1)])
+        names.append(name.split(b"\0")[0].decode()); formats.append(fmt.split(b"\0")[0].decode()); offsets.append(off)
+    dt = np.dtype({"names": names, "formats": formats, "offsets": offsets, "itemsize": record_bytes})
+    rec = np.fromfile(path, dtype=dt, offset=header_bytes)
+    df = pd.DataFrame({n: rec[n] for n in names})
+    for line in meta.splitlines():
+        k, _, v = line.partition("=")
+        if not k: continue
+        try: df[k] = float(v)
+        except ValueError: df[k] = v
+    return df
 
 def infer_palette_from_df_or_name(df, path):
     if "palette" in df.columns and df["palette"].notna().any():
@@ -27,12 +57,12 @@ def safe_q(s, q):
     except: return float("nan")
 
 def summarize_one_run(path, variant):
-    try: df = pd.read_csv(path)
+    try: df = read_sslog(path) if path.endswith(".sslog") else pd.read_csv(path)
     except Exception as e:
         return {"ok": False, "path": path, "error": f"read_error: {e}"}
 
     for c in ["time_s","fps_inst","smoothed_fps","n","width","height","vsync",
-              "threads","ssaa","render_frac","sym","palette"]:
+              "threads","ssaa","render_frac","sym","palette","headless"]:
         if c not in df.columns: df[c] = np.nan
 
     if df["time_s"].notna().any():
@@ -57,6 +87,18 @@ def summarize_one_run(path, variant):
         try: return float(f(s)) if len(s) else float(default)
         except: return float(default)
 
+    # Desglose por etapa: media de las medias por ventana y mediana de los p95
+    # (log binario: un valor <etapa>_ms por frame, media y p95 directos)
+    phases = {}
+    for ph in PHASES:
+        cm, cp, cf = f"{ph}_ms_mean", f"{ph}_ms_p95", f"{ph}_ms"
+        if cf in df.columns:
+            phases[cm] = sstat(df[cf].astype(float), pd.Series.mean)
+            phases[cp] = safe_q(df[cf].astype(float), 0.95)
+            continue
+        phases[cm] = sstat(df[cm].astype(float), pd.Series.mean) if cm in df.columns else np.nan
+        phases[cp] = sstat(df[cp].astype(float), pd.Series.median) if cp in df.columns else np.nan
+
     return {
         "ok": True, "path": path, "file": os.path.basename(path),
         "variant": variant, "palette": palette,
@@ -82,6 +124,32 @@ def summarize_one_run(path, variant):
         "height": last.get("height", np.nan), "vsync": last.get("vsync", np.nan),
         "threads": last.get("threads", np.nan), "ssaa": last.get("ssaa", np.nan),
         "render_frac": last.get("render_frac", np.nan), "sym": last.get("sym", np.nan),
+        # headless=1: FPS de cómputo (sin ventana ni present); 0 o NaN: ventana
+        "headless": float(last.get("headless")) if pd.notna(last.get("headless", np.nan)) else 0.0,
+        "fused": last.get("fused", np.nan),
+        "fast_math": last.get("fast_math", np.nan),
+        "color_lut": last.get("color_lut", np.nan),
+        "batch": last.get("batch", np.nan),
+        "pipeline": last.get("pipeline", np.nan),
+        "backend": last.get("backend", "sdl"),
+        "deterministic": last.get("deterministic", np.nan),
+        "hugepages": last.get("hugepages", np.nan),
+        "schedule": last.get("schedule", "static"),
+        "chunk": last.get("chunk", 0),
+        "bind": last.get("bind", "none"),
+        "interact": last.get("interact", 0.0),
+        "attractors": last.get("attractors", 3),
+        "lod": last.get("lod", 0),
+        "lod_budget": last.get("lod_budget", 0.0),
+        "adapt": last.get("adapt", 0),
+        "adapt_changes": last.get("adapt_changes", 0),
+        "replay": last.get("replay", 0),
+        # Ejecutor del núcleo compartido; los CSV anteriores no lo registran
+        "exec": last.get("exec", "serial" if variant == "sequential" else "openmp"),
+        "gpu": last.get("gpu", 0),
+        # Máximo/media de bloques por hilo (--exec); NaN en CSV anteriores o en el log binario
+        "work_imbalance": sstat(df["work_imbalance"].astype(float), pd.Series.median) if "work_imbalance" in df.columns else np.nan,
+        **phases,
     }
 
 def summarize_many(csvs, variant):
@@ -89,7 +157,10 @@ def summarize_many(csvs, variant):
     ok = [r for r in rows if r.get("ok")]
     bad = [r for r in rows if not r.get("ok")]
     if bad: print("⚠️  Ignorando:", [os.path.basename(b["path"]) for b in bad])
-    return pd.DataFrame(ok)
+    df = pd.DataFrame(ok)
+    if not df.empty and df["headless"].nunique() > 1:
+        print(f"⚠️  {variant}: mezcla corridas headless y con ventana; el speedup no es comparable")
+    return df
 
 def aggregate_by_variant_palette(df):
     if df.empty: return pd.DataFrame()
@@ -99,7 +170,7 @@ def aggregate_by_variant_palette(df):
     keys = ["variant","palette"]
     metrics = ["fps_inst_median","fps_inst_mean","smoothed_fps_median","smoothed_fps_mean",
                "frame_ms_median","frame_ms_mean","frame_ms_p95","frame_ms_p99",
-               "throughput_particles_per_s","n","width","height","vsync","ssaa","render_frac","sym"]
+               "throughput_particles_per_s","n","width","height","vsync","ssaa","render_frac","sym","headless"]
     agg = df.groupby(keys).agg({m:"median" for m in metrics}).reset_index()
     agg["runs"] = df.groupby(keys)["file"].count().values
     agg["threads_mode"] = df.groupby(keys)["threads"].apply(mode_or_nan).values
@@ -112,7 +183,7 @@ def aggregate_by_variant(df):
         return float(Counter(s).most_common(1)[0][0]) if len(s) else np.nan
     metrics = ["fps_inst_median","fps_inst_mean","smoothed_fps_median","smoothed_fps_mean",
                "frame_ms_median","frame_ms_mean","frame_ms_p95","frame_ms_p99",
-               "throughput_particles_per_s","n","width","height","vsync","ssaa","render_frac","sym"]
+               "throughput_particles_per_s","n","width","height","vsync","ssaa","render_frac","sym","headless"]
     agg = df.groupby(["variant"]).agg({m:"median" for m in metrics}).reset_index()
     agg["runs"] = df.groupby("variant")["file"].count().values
     agg["threads_mode"] = df.groupby("variant")["threads"].apply(mode_or_nan).values
@@ -139,6 +210,54 @@ def compute_speedup_by_variant(agg_var_df):
     }])
 
 
+def aggregate_by_policy(df):
+    """Corridas paralelas agrupadas por hilos, ejecutor y política OpenMP (--exec/--schedule/--chunk/--bind)."""
+    if df.empty: return pd.DataFrame()
+    par = df[df["variant"]=="parallel"]
+    if par.empty: return pd.DataFrame()
+    keys = ["threads","exec","schedule","chunk","bind"]
+    metrics = ["fps_inst_median","frame_ms_median","frame_ms_p95","throughput_particles_per_s","work_imbalance"]
+    agg = par.groupby(keys, dropna=False).agg({m:"median" for m in metrics}).reset_index()
+    agg["runs"] = par.groupby(keys, dropna=False)["file"].count().values
+    return agg.sort_values(["threads","fps_inst_median"], ascending=[True, False])
+
+def aggregate_phases_by_variant(df):
+    if df.empty: return pd.DataFrame()
+    cols = [c for ph in PHASES for c in (f"{ph}_ms_mean", f"{ph}_ms_p95") if c in df.columns]
+    if not cols: return pd.DataFrame()
+    return df.groupby(["variant"]).agg({c:"median" for c in cols}).reset_index()
+
+
+def plot_phase_breakdown(agg_ph_df, out_path):
+    """Barras apiladas con la media por etapa (ms/frame) y p95 por etapa al lado."""
+    if agg_ph_df.empty: return
+    order = [v for v in ["sequential","parallel"] if v in set(agg_ph_df["variant"])]
+    if not order: return
+    labels = {"sequential":"Sequential","parallel":"Parallel"}
+    fig, (ax_m, ax_p) = plt.subplots(1, 2, figsize=(11,4.5))
+    x = np.arange(len(order))
+    bottom = np.zeros(len(order))
+    for ph in PHASES:
+        c = f"{ph}_ms_mean"
+        if c not in agg_ph_df.columns: continue
+        vals = np.array([agg_ph_df.loc[agg_ph_df["variant"]==v, c].iloc[0] for v in order], dtype=float)
+        vals = np.nan_to_num(vals)
+        ax_m.bar(x, vals, bottom=bottom, label=ph)
+        bottom += vals
+    ax_m.set_xticks(x); ax_m.set_xticklabels([labels[v] for v in order])
+    ax_m.set_ylabel("ms/frame (mean)"); ax_m.set_title("Per-phase frame time (mean)")
+    ax_m.legend(fontsize=8)
+    w = 0.8 / len(order)
+    px = np.arange(len(PHASES))
+    for j, v in enumerate(order):
+        vals = [float(agg_ph_df.loc[agg_ph_df["variant"]==v, f"{ph}_ms_p95"].iloc[0]) if f"{ph}_ms_p95" in agg_ph_df.columns else np.nan for ph in PHASES]
+        ax_p.bar(px + j*w, np.nan_to_num(vals), width=w, label=labels[v])
+    ax_p.set_xticks(px + w*(len(order)-1)/2); ax_p.set_xticklabels(PHASES, rotation=25)
+    ax_p.set_ylabel("ms (p95)"); ax_p.set_title("Per-phase p95")
+    ax_p.legend(fontsize=8)
+    plt.tight_layout(); plt.savefig(out_path, dpi=150); plt.close()
+
+
 def plot_boxplots_runs(df_runs, out_path):
     if df_runs.empty: return
     plt.figure(figsize=(10,5))
@@ -195,14 +314,96 @@ def plot_throughput_by_variant(agg_var_df, out_path):
     plt.tight_layout(); plt.savefig(out_path, dpi=150); plt.close()
 
 
+def load_scaling(path):
+    """Mediana de wall_ms por configuración (sobre repeticiones) del CSV de bench_sweep.py."""
+    if not os.path.exists(path): return pd.DataFrame()
+    df = pd.read_csv(path)
+    df = df[df["ok"]==1]
+    if df.empty: return pd.DataFrame()
+    keys = ["mode","threads","n_per_thread"] + SCALING_CFG
+    agg = df.groupby(keys).agg(wall_ms=("wall_ms","median"), wall_ms_std=("wall_ms","std"),
+                               reps=("wall_ms","count")).reset_index()
+    return agg
+
+def strong_scaling(agg):
+    """S(p)=T1/Tp, E=S/p y Karp–Flatt e=(1/S-1/p)/(1-1/p) por configuración con N fijo."""
+    st = agg[agg["mode"]=="strong"].copy()
+    if st.empty: return st
+    t1 = st[st["threads"]==1].set_index(SCALING_CFG)["wall_ms"].rename("t1_ms")
+    st = st.join(t1, on=SCALING_CFG).dropna(subset=["t1_ms"])
+    p = st["threads"].astype(float)
+    st["speedup"] = st["t1_ms"] / st["wall_ms"]
+    st["efficiency"] = st["speedup"] / p
+    with np.errstate(divide="ignore", invalid="ignore"):
+        st["karp_flatt"] = np.where(p>1, (1.0/st["speedup"] - 1.0/p) / (1.0 - 1.0/p), np.nan)
+    return st.sort_values(SCALING_CFG + ["threads"])
+
+def weak_scaling(agg):
+    """Eficiencia débil T1(n0)/Tp(n0·p) con N por hilo fijo."""
+    wk = agg[agg["mode"]=="weak"].copy()
+    if wk.empty: return wk
+    keys = ["n_per_thread","sym","mirror","ssaa"]
+    t1 = wk[wk["threads"]==1].set_index(keys)["wall_ms"].rename("t1_ms")
+    wk = wk.join(t1, on=keys).dropna(subset=["t1_ms"])
+    wk["weak_efficiency"] = wk["t1_ms"] / wk["wall_ms"]
+    return wk.sort_values(keys + ["threads"])
+
+def scaling_label(r, keys):
+    return " ".join(f"{k}={int(r[k])}" for k in keys)
+
+def plot_scaling_metric(df, col, keys, ylabel, title, out_path, ideal=None, logy=False, xlabel="threads"):
+    """Una curva por configuración: métrica vs p (hilos o ranks); 'ideal' recibe los p y dibuja la referencia."""
+    if df.empty or col not in df.columns: return
+    plt.figure(figsize=(8,5))
+    for cfg, sub in df.groupby(keys):
+        sub = sub.dropna(subset=[col])
+        if sub.empty: continue
+        plt.plot(sub["threads"], sub[col], marker="o", label=scaling_label(sub.iloc[0], keys))
+    ps = np.array(sorted(df["threads"].unique()), dtype=float)
+    if ideal is not None and len(ps): plt.plot(ps, ideal(ps), "k--", lw=1, label="ideal")
+    plt.xlabel(xlabel); plt.ylabel(ylabel); plt.title(title)
+    if logy: plt.yscale("log")
+    plt.legend(fontsize=7, ncol=2); plt.grid(alpha=0.3)
+    plt.tight_layout(); plt.savefig(out_path, dpi=150); plt.close()
+
+def analyze_scaling(path, out_dir, prefix="", xlabel="threads"):
+    """Resúmenes y curvas de escalado; prefix separa las salidas de cada CSV (p. ej. mpi_)."""
+    agg = load_scaling(path)
+    if agg.empty: return
+    print(f"Escalado: {len(agg)} configuraciones en {path}")
+    out = lambda name: os.path.join(out_dir, prefix + name)
+    what = "" if xlabel == "threads" else f" ({xlabel})"
+    st = strong_scaling(agg)
+    if not st.empty:
+        st.to_csv(out("strong_scaling_summary.csv"), index=False)
+        plot_scaling_metric(st, "speedup", SCALING_CFG, "speedup T1/Tp", f"Strong scaling{what} – speedup",
+                            out("fig_strong_speedup.png"), ideal=lambda p: p, xlabel=xlabel)
+        plot_scaling_metric(st, "efficiency", SCALING_CFG, "efficiency S/p", f"Strong scaling{what} – parallel efficiency",
+                            out("fig_parallel_efficiency.png"), ideal=np.ones_like, xlabel=xlabel)
+        plot_scaling_metric(st, "karp_flatt", SCALING_CFG, "Karp–Flatt serial fraction e",
+                            f"Karp–Flatt serial fraction{what} (flat = Amdahl, rising = overhead)",
+                            out("fig_karp_flatt.png"), xlabel=xlabel)
+    wk = weak_scaling(agg)
+    if not wk.empty:
+        wk.to_csv(out("weak_scaling_summary.csv"), index=False)
+        keys = ["n_per_thread","sym","mirror","ssaa"]
+        plot_scaling_metric(wk, "weak_efficiency", keys, "weak efficiency T1(n0)/Tp(n0·p)",
+                            f"Weak scaling{what} – efficiency", out("fig_weak_efficiency.png"),
+                            ideal=np.ones_like, xlabel=xlabel)
+        plot_scaling_metric(wk, "wall_ms", keys, "wall ms/frame", f"Weak scaling{what} – frame time",
+                            out("fig_weak_frame_ms.png"), logy=True, xlabel=xlabel)
+
+
 def main():
-    print("🔎 Buscando CSVs…")
+    print("🔎 Buscando CSVs y logs binarios…")
     seq_csvs = find_csvs(SEQ_DIR)
     par_csvs = find_csvs(PAR_DIR)
     print(f"  - secuencial: {len(seq_csvs)} archivos en {SEQ_DIR}")
     print(f"  - paralelo  : {len(par_csvs)} archivos en {PAR_DIR}")
 
     ensure_outdir(OUT_DIR)
+    analyze_scaling(SCALING_CSV, OUT_DIR)
+    analyze_scaling(MPI_SCALING_CSV, OUT_DIR, prefix="mpi_", xlabel="ranks")
 
     seq_runs = summarize_many(seq_csvs, "sequential")
     par_runs = summarize_many(par_csvs, "parallel")
@@ -225,6 +426,15 @@ def main():
     plot_frame_ms_p95_by_variant(agg_var, os.path.join(OUT_DIR, "fig_frame_ms_p95_by_variant.png"))
     plot_throughput_by_variant(agg_var, os.path.join(OUT_DIR, "fig_throughput_by_variant.png"))
 
+    agg_pol = aggregate_by_policy(all_runs)
+    if not agg_pol.empty:
+        agg_pol.to_csv(os.path.join(OUT_DIR, "policy_summary.csv"), index=False)
+
+    agg_ph = aggregate_phases_by_variant(all_runs)
+    if not agg_ph.empty:
+        agg_ph.to_csv(os.path.join(OUT_DIR, "phase_breakdown_by_variant.csv"), index=False)
+        plot_phase_breakdown(agg_ph, os.path.join(OUT_DIR, "fig_phase_breakdown_by_variant.png"))
+
     sp_var = compute_speedup_by_variant(agg_var)
     sp_var.to_csv(os.path.join(OUT_DIR, "speedup_by_variant.csv"), index=False)
     if not sp_var.empty:
@@ -0,0 +1,885 @@
+/**
+ * Núcleo de simulación compartido: implementación (ver mandala_core.h).
+ * Compilar con -fopenmp habilita el ejecutor OpenMP; sin él solo queda el
+ * ejecutor en serie y todo el archivo es C11 puro.
+ */
+
+#include "mandala_core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <stdatomic.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ------------------------ Utilidades de CLI ------------------------
+
+bool parse_int(const char *s, int *out)
+{
+    char *e = 0;
+    long v = strtol(s, &e, 10);
+    if (!e || *e)
+        return false;
+    if (v < INT_MIN || v > INT_MAX)
+        return false;
+    *out = (int)v;
+    return true;
+}
+
+bool parse_float(const char *s, float *out)
+{
+    char *e = 0;
+    float v = strtof(s, &e);
+    if (!e || *e)
+        return false;
+    *out = v;
+    return true;
+}
+
+bool str_ieq(const char *a, const char *b)
+{
+    if (!a || !b)
+        return false;
+    while (*a && *b)
+    {
+        char ca = (char)tolower((unsigned char)*a++),
+             cb = (char)tolower((unsigned char)*b++);
+        if (ca != cb)
+            return false;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+// ------------------------ Utilidades numéricas ------------------------
+
+float rng_u01(uint32_t seed, uint32_t stream, uint32_t i, uint32_t k)
+{
+    uint64_t z = ((uint64_t)seed << 32 | stream) * 0xD1342543DE82EF95ull;
+    z += (((uint64_t)i << 8) | k) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (float)(z >> 40) * (1.0f / 16777216.0f); // 24 bits: exacto en float
+}
+
+float rng_range(uint32_t seed, uint32_t stream, uint32_t i, uint32_t k, float a, float b)
+{
+    return a + (b - a) * rng_u01(seed, stream, i, k);
+}
+
+Uint8 clamp_u8(int v)
+{
+    if (v < 0)
+        v = 0;
+    if (v > 255)
+        v = 255;
+    return (Uint8)v;
+}
+
+void hsv2rgb(float h, float s, float v, Uint8 *r, Uint8 *g, Uint8 *b)
+{
+    float C = v * s;
+    float X = C * (1.0f - fabsf(fmodf(h / 60.0f, 2.0f) - 1.0f));
+    float m = v - C;
+    float R = 0, G = 0, B = 0;
+    if (h < 60)
+    {
+        R = C;
+        G = X;
+        B = 0;
+    }
+    else if (h < 120)
+    {
+        R = X;
+        G = C;
+        B = 0;
+    }
+    else if (h < 180)
+    {
+        R = 0;
+        G = C;
+        B = X;
+    }
+    else if (h < 240)
+    {
+        R = 0;
+        G = X;
+        B = C;
+    }
+    else if (h < 300)
+    {
+        R = X;
+        G = 0;
+        B = C;
+    }
+    else
+    {
+        R = C;
+        G = 0;
+        B = X;
+    }
+    *r = clamp_u8((int)((R + m) * 255.0f));
+    *g = clamp_u8((int)((G + m) * 255.0f));
+    *b = clamp_u8((int)((B + m) * 255.0f));
+}
+
+// ------------------------ Matemática rápida (vectorizable) ------------------------
+
+/**
+ * Recorre [-64pi, 64pi] en ambos modos contra sinf/cosf y una grilla h,s,v
+ * de hsv2rgb_branchless contra hsv2rgb (en niveles de 8 bits); imprime los
+ * máximos.
+ */
+int fastmath_self_test(void)
+{
+    const float bound[3] = {0.0f, 1e-6f, 2e-4f};
+    int fails = 0;
+    for (int mode = FASTMATH_ACCURATE; mode <= FASTMATH_FAST; ++mode)
+    {
+        double es = 0.0, ec = 0.0;
+        const int N = 2000000;
+        for (int i = 0; i <= N; ++i)
+        {
+            float x = (float)(-64.0 * M_PI + 128.0 * M_PI * (double)i / (double)N);
+            double ds = fabs((double)fast_sinf(x, mode) - (double)sinf(x));
+            double dc = fabs((double)fast_cosf(x, mode) - (double)cosf(x));
+            if (ds > es)
+                es = ds;
+            if (dc > ec)
+                ec = dc;
+        }
+        bool ok = es <= bound[mode] && ec <= bound[mode];
+        fails += ok ? 0 : 1;
+        printf("fast-math %d: max|sin err|=%.3e max|cos err|=%.3e (cota %.0e) %s\n",
+               mode, es, ec, bound[mode], ok ? "OK" : "FALLA");
+    }
+    int emax = 0;
+    for (int hi = 0; hi < 3600; ++hi)
+        for (int si = 0; si <= 20; ++si)
+            for (int vi = 0; vi <= 20; ++vi)
+            {
+                float h = hi * 0.1f, sv = si / 20.0f, vv = vi / 20.0f;
+                Uint8 r0, g0, b0;
+                float r1, g1, b1;
+                hsv2rgb(h, sv, vv, &r0, &g0, &b0);
+                hsv2rgb_branchless(h, sv, vv, &r1, &g1, &b1);
+                int d[3] = {abs(r0 - unit_to_u8(r1)), abs(g0 - unit_to_u8(g1)), abs(b0 - unit_to_u8(b1))};
+                for (int c = 0; c < 3; ++c)
+                    if (d[c] > emax)
+                        emax = d[c];
+            }
+    bool hok = emax <= 1;
+    fails += hok ? 0 : 1;
+    printf("hsv2rgb sin ramas: max|dif|=%d niveles (cota 1) %s\n", emax, hok ? "OK" : "FALLA");
+    return fails ? 1 : 0;
+}
+
+// ------------------------ FPS (tiempo y medición) ------------------------
+
+double ticks_to_seconds(uint64_t t) { return (double)t / (double)SDL_GetPerformanceFrequency(); }
+
+uint64_t ticks_to_ms_u64(uint64_t t)
+{
+    double ms = (double)t * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    if (ms < 0.0)
+        ms = 0.0;
+    return (uint64_t)(ms + 0.5);
+}
+
+double fps_tick(FPSCounter *f, double *fps_inst)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    double dt = ticks_to_seconds(now - f->last_ticks);
+    f->last_ticks = now;
+    double inst = (dt > 0.0) ? (1.0 / dt) : 0.0;
+    if (f->smoothed_fps <= 0.0)
+        f->smoothed_fps = inst;
+    else
+        f->smoothed_fps = f->alpha * inst + (1.0 - f->alpha) * f->smoothed_fps;
+    if (fps_inst)
+        *fps_inst = inst;
+    return dt;
+}
+
+// ------------------------ Tiempos por etapa ------------------------
+
+const char *const STAGE_NAMES[STAGE_COUNT] = {"events", "update", "precalc", "render", "resolve", "present", "wait"};
+
+void stage_lap(StageTimes *st, Stage s, uint64_t *mark)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    st->frame[s] += now - *mark;
+    if (st->span)
+        st->span(STAGE_NAMES[s], *mark, now);
+    *mark = now;
+}
+
+void stage_end_frame(StageTimes *st)
+{
+    if (st->win_count == st->win_cap)
+    {
+        int cap = st->win_cap ? st->win_cap * 2 : 256;
+        for (int s = 0; s < STAGE_COUNT; ++s)
+        {
+            double *p = (double *)realloc(st->win_ms[s], sizeof(double) * (size_t)cap);
+            if (!p)
+            {
+                cap = 0; // Sin memoria: se descarta la muestra, no el frame
+                break;
+            }
+            st->win_ms[s] = p;
+        }
+        if (cap > 0)
+            st->win_cap = cap;
+    }
+    bool keep = st->win_count < st->win_cap;
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        st->total[s] += st->frame[s];
+        if (keep)
+            st->win_ms[s][st->win_count] = ticks_to_seconds(st->frame[s]) * 1000.0;
+        st->frame[s] = 0;
+    }
+    if (keep)
+        st->win_count++;
+    st->frames++;
+}
+
+/** Comparador ascendente de doubles para qsort. */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Calcula media y p95 (ms) por etapa sobre la ventana de log y la reinicia.
+ * Ordena in situ las muestras; sin muestras reporta 0.
+ */
+static void stage_window_stats(StageTimes *st, double mean[STAGE_COUNT], double p95[STAGE_COUNT])
+{
+    int n = st->win_count;
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        mean[s] = p95[s] = 0.0;
+        if (n == 0)
+            continue;
+        double sum = 0.0;
+        for (int i = 0; i < n; ++i)
+            sum += st->win_ms[s][i];
+        mean[s] = sum / n;
+        qsort(st->win_ms[s], (size_t)n, sizeof(double), cmp_double);
+        int k = (int)ceil(0.95 * n) - 1;
+        p95[s] = st->win_ms[s][k < 0 ? 0 : k];
+    }
+    st->win_count = 0;
+}
+
+void stage_csv_header(FILE *fp)
+{
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        fprintf(fp, ",%s_ms_mean,%s_ms_p95", STAGE_NAMES[s], STAGE_NAMES[s]);
+}
+
+void stage_csv_row(FILE *fp, StageTimes *st)
+{
+    double mean[STAGE_COUNT], p95[STAGE_COUNT];
+    stage_window_stats(st, mean, p95);
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        fprintf(fp, ",%.4f,%.4f", mean[s], p95[s]);
+}
+
+void stage_free(StageTimes *st)
+{
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        free(st->win_ms[s]);
+}
+
+// ------------------------ Ejecutores ------------------------
+
+const char *const EXEC_NAMES[EXEC_COUNT] = {"serial", "openmp", "steal"};
+
+// Trabajo por hilo (executor_take_stats); cada hilo suma una vez por región
+static _Atomic uint64_t exec_blocks[EXEC_LANES], exec_steals[EXEC_LANES];
+static _Atomic int exec_lanes;
+
+/** Suma lo hecho por el hilo t de un equipo en una región. */
+static void exec_count(int t, int blocks, int steals)
+{
+    if (t >= EXEC_LANES)
+        t = EXEC_LANES - 1;
+    atomic_fetch_add_explicit(&exec_blocks[t], (uint64_t)blocks, memory_order_relaxed);
+    if (steals)
+        atomic_fetch_add_explicit(&exec_steals[t], (uint64_t)steals, memory_order_relaxed);
+    int seen = atomic_load_explicit(&exec_lanes, memory_order_relaxed);
+    while (seen < t + 1 && !atomic_compare_exchange_weak_explicit(&exec_lanes, &seen, t + 1, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void executor_take_stats(ExecStats *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->lanes = atomic_exchange_explicit(&exec_lanes, 0, memory_order_relaxed);
+    for (int t = 0; t < s->lanes; ++t)
+    {
+        s->blocks[t] = atomic_exchange_explicit(&exec_blocks[t], 0, memory_order_relaxed);
+        s->steals[t] = atomic_exchange_explicit(&exec_steals[t], 0, memory_order_relaxed);
+    }
+}
+
+static int serial_threads(void) { return 1; }
+
+/** Bloques en orden, en el hilo que llama. */
+static void serial_for_blocks(int n, int block, ExecBlockFn fn, void *ctx)
+{
+    int done = 0;
+    for (int i0 = 0; i0 < n; i0 += block, ++done)
+        fn(ctx, i0, i0 + block < n ? i0 + block : n);
+    exec_count(0, done, 0);
+}
+
+static const Executor EXECUTOR_SERIAL = {"serial", serial_threads, serial_for_blocks};
+
+#ifdef _OPENMP
+static int openmp_threads(void) { return omp_get_max_threads(); }
+
+/**
+ * Un bloque por iteración con schedule(runtime): la política y el tamaño del
+ * equipo son los ICV del hilo que llama (team_setup del paralelo), así la
+ * primera escritura y la física reparten los bloques igual.
+ */
+static void openmp_for_blocks(int n, int block, ExecBlockFn fn, void *ctx)
+{
+    int nblocks = (n + block - 1) / block;
+#pragma omp parallel
+    {
+        int done = 0;
+#pragma omp for schedule(runtime) nowait
+        for (int blk = 0; blk < nblocks; ++blk)
+        {
+            int i0 = blk * block;
+            fn(ctx, i0, i0 + block < n ? i0 + block : n);
+            ++done;
+        }
+        exec_count(omp_get_thread_num(), done, 0);
+    }
+}
+
+static const Executor EXECUTOR_OPENMP = {"openmp", openmp_threads, openmp_for_blocks};
+
+/*
+ * Robo de trabajo: cada hilo arranca con el tramo contiguo de bloques que le
+ * daría schedule(static) (misma localidad de la primera escritura) y toma de
+ * su frente `grain` bloques a la vez; el chunk de omp_set_schedule
+ * (--chunk, 0 => 1 bloque). Al vaciarse le roba la mitad trasera al tramo
+ * con más bloques pendientes. Cada tramo [lo,hi) es una palabra atómica de
+ * 64 bits en su propia línea de caché: dueño y ladrones la cambian con CAS,
+ * así cada bloque se entrega exactamente una vez. Sirve cuando el costo por
+ * bloque no es uniforme (--lod, --interact, colitas) o los núcleos no son
+ * iguales (P/E), donde el reparto estático deja hilos esperando.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t range; // lo | hi << 32
+} StealLane;
+
+#define STEAL_PACK(lo, hi) ((uint64_t)(uint32_t)(lo) | (uint64_t)(uint32_t)(hi) << 32)
+#define STEAL_LO(r) ((int)(uint32_t)(r))
+#define STEAL_HI(r) ((int)((r) >> 32))
+
+/** El dueño toma hasta grain bloques del frente de su tramo en [*a,*b); false si está vacío. */
+static bool steal_pop(StealLane *l, int grain, int *a, int *b)
+{
+    uint64_t r = atomic_load(&l->range);
+    for (;;)
+    {
+        int lo = STEAL_LO(r), hi = STEAL_HI(r);
+        if (lo >= hi)
+            return false;
+        int e = hi - lo > grain ? lo + grain : hi;
+        if (atomic_compare_exchange_weak(&l->range, &r, STEAL_PACK(e, hi)))
+        {
+            *a = lo;
+            *b = e;
+            return true;
+        }
+    }
+}
+
+/** Roba la mitad trasera del tramo ajeno con más bloques en [*a,*b); false si no queda trabajo. */
+static bool steal_from(StealLane *lane, int nth, int self, int *a, int *b)
+{
+    for (;;)
+    {
+        int victim = -1, best = 0;
+        uint64_t rv = 0;
+        for (int k = 1; k < nth; ++k)
+        {
+            int v = (self + k) % nth;
+            uint64_t r = atomic_load(&lane[v].range);
+            if (STEAL_HI(r) - STEAL_LO(r) > best)
+            {
+                best = STEAL_HI(r) - STEAL_LO(r);
+                victim = v;
+                rv = r;
+            }
+        }
+        if (victim < 0)
+            return false;
+        int lo = STEAL_LO(rv), hi = STEAL_HI(rv), mid = hi - (hi - lo + 1) / 2;
+        if (atomic_compare_exchange_strong(&lane[victim].range, &rv, STEAL_PACK(lo, mid)))
+        {
+            *a = mid;
+            *b = hi;
+            return true;
+        }
+    }
+}
+
+static void steal_for_blocks(int n, int block, ExecBlockFn fn, void *ctx)
+{
+    int nblocks = (n + block - 1) / block;
+    if (nblocks <= 0)
+        return;
+    omp_sched_t kind;
+    int grain;
+    omp_get_schedule(&kind, &grain);
+    (void)kind;
+    if (grain < 1)
+        grain = 1;
+    int team = omp_get_max_threads();
+    team = team < EXEC_LANES ? team : EXEC_LANES;
+    team = team < nblocks ? team : nblocks;
+    StealLane lane[EXEC_LANES];
+#pragma omp parallel num_threads(team)
+    {
+        int t = omp_get_thread_num(), nth = omp_get_num_threads();
+        atomic_init(&lane[t].range, STEAL_PACK((long long)nblocks * t / nth, (long long)nblocks * (t + 1) / nth));
+#pragma omp barrier
+        int done = 0, steals = 0, a, b;
+        for (;;)
+        {
+            if (!steal_pop(&lane[t], grain, &a, &b))
+            {
+                if (!steal_from(lane, nth, t, &a, &b))
+                    break;
+                steals++;
+                atomic_store(&lane[t].range, STEAL_PACK(a, b)); // Vacío hasta aquí: nadie más lo escribe
+                continue;
+            }
+            for (int blk = a; blk < b; ++blk)
+            {
+                int i0 = blk * block;
+                fn(ctx, i0, i0 + block < n ? i0 + block : n);
+            }
+            done += b - a;
+        }
+        exec_count(t, done, steals);
+    }
+}
+
+static int steal_threads(void)
+{
+    int t = omp_get_max_threads();
+    return t < EXEC_LANES ? t : EXEC_LANES;
+}
+
+static const Executor EXECUTOR_STEAL = {"steal", steal_threads, steal_for_blocks};
+#endif
+
+const Executor *executor_get(ExecKind kind)
+{
+#ifdef _OPENMP
+    if (kind == EXEC_OPENMP)
+        return &EXECUTOR_OPENMP;
+    if (kind == EXEC_STEAL)
+        return &EXECUTOR_STEAL;
+#else
+    (void)kind;
+#endif
+    return &EXECUTOR_SERIAL;
+}
+
+// ------------------------ Mundo: Atractores y Orbitadores ------------------------
+
+#define ORB_FLOAT_FIELDS 15 // Arreglos float de Orbiters (más att, int)
+
+/** Bytes de un arreglo de cap elementos de `elem` bytes, redondeado a ORB_ALIGN. */
+static size_t orb_chunk(size_t cap, size_t elem)
+{
+    return (cap * elem + ORB_ALIGN - 1) / ORB_ALIGN * ORB_ALIGN;
+}
+
+size_t orbiters_bytes(int n)
+{
+    size_t cap = (size_t)(n + ORB_LANES - 1) / ORB_LANES * ORB_LANES;
+    return ORB_FLOAT_FIELDS * orb_chunk(cap, sizeof(float)) + orb_chunk(cap, sizeof(int));
+}
+
+void orbiters_bind(Orbiters *o, int n, void *mem)
+{
+    memset(o, 0, sizeof(*o));
+    o->n = n;
+    o->cap = (n + ORB_LANES - 1) / ORB_LANES * ORB_LANES;
+    size_t fb = orb_chunk((size_t)o->cap, sizeof(float));
+    float **f[ORB_FLOAT_FIELDS] = {&o->x, &o->y, &o->px, &o->py, &o->vx, &o->vy, &o->angle, &o->omega,
+                                   &o->radius, &o->k, &o->damping, &o->size_base, &o->size_amp,
+                                   &o->size_speed, &o->size_phase};
+    unsigned char *p = (unsigned char *)mem;
+    for (size_t i = 0; i < ORB_FLOAT_FIELDS; ++i, p += fb)
+        *f[i] = (float *)p;
+    o->att = (int *)p;
+}
+
+bool attractors_alloc(Attractors *a, int n, int k)
+{
+    memset(a, 0, sizeof(*a));
+    a->mem = (float *)calloc((size_t)n * 10, sizeof(float));
+    if (!a->mem)
+        return false;
+    a->n = n;
+    a->k = k < n ? k : n;
+    float **f[] = {&a->x, &a->y, &a->ax, &a->ay, &a->fx, &a->fy, &a->phx, &a->phy, &a->cx, &a->cy};
+    for (size_t i = 0; i < sizeof(f) / sizeof(f[0]); ++i)
+        *f[i] = a->mem + i * (size_t)n;
+    return true;
+}
+
+void attractors_free(Attractors *a)
+{
+    free(a->mem);
+    memset(a, 0, sizeof(*a));
+}
+
+void init_attractors(Attractors *a, int W, int H, uint32_t seed)
+{
+    float cx = W * 0.5f, cy = H * 0.5f;
+    float s = (float)(W < H ? W : H) * 0.15f;
+    a->sigma2 = s * s;
+    for (int i = 0; i < a->n; ++i)
+    {
+        a->x[i] = a->cx[i] = cx;
+        a->y[i] = a->cy[i] = cy;
+        a->ax[i] = rng_range(seed, RNG_STREAM_ATTR, i, 0, W * 0.20f, W * 0.35f);
+        a->ay[i] = rng_range(seed, RNG_STREAM_ATTR, i, 1, H * 0.20f, H * 0.35f);
+        float fx_hz = rng_range(seed, RNG_STREAM_ATTR, i, 2, 0.05f, 0.15f),
+              fy_hz = rng_range(seed, RNG_STREAM_ATTR, i, 3, 0.05f, 0.15f);
+        a->fx[i] = 2.0f * (float)M_PI * fx_hz; // Hz → rad/s
+        a->fy[i] = 2.0f * (float)M_PI * fy_hz;
+        a->phx[i] = rng_range(seed, RNG_STREAM_ATTR, i, 4, 0.0f, (float)M_PI * 2.0f);
+        a->phy[i] = rng_range(seed, RNG_STREAM_ATTR, i, 5, 0.0f, (float)M_PI * 2.0f);
+    }
+}
+
+/**
+ * Centros efectivos de los atractores [i0,i1) con k > 1: cada uno busca sus
+ * k-1 vecinos más cercanos (inserción en una lista corta, empates por índice)
+ * y mezcla sus posiciones con peso 1/(1 + d²/sigma²).
+ */
+static void attractors_blend_range(void *ctx, int i0, int i1)
+{
+    Attractors *a = (Attractors *)ctx;
+    const int m = a->k - 1;
+    for (int i = i0; i < i1; ++i)
+    {
+        float bd[ATTR_KNN_MAX];
+        int bj[ATTR_KNN_MAX], cnt = 0;
+        for (int j = 0; j < a->n; ++j)
+        {
+            if (j == i)
+                continue;
+            float dx = a->x[j] - a->x[i], dy = a->y[j] - a->y[i];
+            float d2 = dx * dx + dy * dy;
+            if (cnt == m && d2 >= bd[m - 1])
+                continue;
+            int p = cnt < m ? cnt++ : m - 1;
+            while (p > 0 && bd[p - 1] > d2)
+            {
+                bd[p] = bd[p - 1];
+                bj[p] = bj[p - 1];
+                --p;
+            }
+            bd[p] = d2;
+            bj[p] = j;
+        }
+        float sx = a->x[i], sy = a->y[i], sw = 1.0f;
+        for (int q = 0; q < cnt; ++q)
+        {
+            float w = 1.0f / (1.0f + bd[q] / a->sigma2);
+            sx += w * a->x[bj[q]];
+            sy += w * a->y[bj[q]];
+            sw += w;
+        }
+        a->cx[i] = sx / sw;
+        a->cy[i] = sy / sw;
+    }
+}
+
+/**
+ * Actualiza posiciones senoidales de los atractores en el tiempo t (s) y
+ * sus centros efectivos. La mezcla k-NN es O(n²): con cientos de atractores
+ * se reparte por atractor con ex; con pocos no compensa y va en serie.
+ */
+void update_attractors(const Executor *ex, Attractors *a, float t, int W, int H)
+{
+    float cx = W * 0.5f, cy = H * 0.5f;
+    for (int i = 0; i < a->n; ++i)
+    {
+        a->x[i] = cx + a->ax[i] * sinf(a->fx[i] * t + a->phx[i]);
+        a->y[i] = cy + a->ay[i] * sinf(a->fy[i] * t + a->phy[i]);
+    }
+    if (a->k <= 1)
+    {
+        memcpy(a->cx, a->x, sizeof(float) * (size_t)a->n);
+        memcpy(a->cy, a->y, sizeof(float) * (size_t)a->n);
+        return;
+    }
+    if (a->n >= 64)
+        ex->for_blocks(a->n, 8, attractors_blend_range, a);
+    else
+        attractors_blend_range(a, 0, a->n);
+}
+
+/** Relleno [n, cap): campos en cero (inertes para la física vectorizada). */
+static void orbiters_zero_pad(Orbiters *o, int i)
+{
+    o->att[i] = 0;
+    o->x[i] = o->y[i] = o->px[i] = o->py[i] = o->vx[i] = o->vy[i] = 0.0f;
+    o->angle[i] = o->omega[i] = o->radius[i] = o->k[i] = o->damping[i] = 0.0f;
+    o->size_base[i] = o->size_amp[i] = o->size_speed[i] = o->size_phase[i] = 0.0f;
+}
+
+/** Argumentos de init_orbiters_range. */
+typedef struct
+{
+    Orbiters *o;
+    const Attractors *a;
+    float minR, maxR;
+    uint32_t seed;
+} OrbInitJob;
+
+/** Inicializa las partículas [i0,i1) (las de índice >= n quedan como relleno). */
+static void init_orbiters_range(void *ctx, int i0, int i1)
+{
+    const OrbInitJob *j = (const OrbInitJob *)ctx;
+    Orbiters *o = j->o;
+    const Attractors *a = j->a;
+    const uint32_t seed = j->seed, S = RNG_STREAM_ORB;
+    for (int i = i0; i < i1; ++i)
+    {
+        if (i >= o->n)
+        {
+            orbiters_zero_pad(o, i);
+            o->att[i] = attractor_of(i, o->n, a->n);
+            continue;
+        }
+        o->att[i] = attractor_of(i, o->n, a->n);
+        o->radius[i] = rng_range(seed, S, i, 0, j->minR, j->maxR);
+        o->angle[i] = rng_range(seed, S, i, 1, 0.0f, (float)M_PI * 2.0f);
+        float hz = rng_range(seed, S, i, 2, 0.04f, 0.35f);
+        o->omega[i] = 2.0f * (float)M_PI * hz; // rad/s
+        o->k[i] = rng_range(seed, S, i, 3, 4.0f, 10.0f);
+        o->damping[i] = rng_range(seed, S, i, 4, 1.4f, 3.2f);
+        float tx = a->x[o->att[i]] + cosf(o->angle[i]) * o->radius[i];
+        float ty = a->y[o->att[i]] + sinf(o->angle[i]) * o->radius[i];
+        o->x[i] = o->px[i] = tx;
+        o->y[i] = o->py[i] = ty;
+        o->vx[i] = o->vy[i] = 0.0f;
+        // Parámetros estéticos de respiración del punto
+        o->size_base[i] = rng_range(seed, S, i, 5, 2.0f, 3.5f);
+        o->size_amp[i] = rng_range(seed, S, i, 6, 1.2f, 2.8f);
+        o->size_speed[i] = rng_range(seed, S, i, 7, 0.6f, 1.6f) * 2.0f * (float)M_PI;
+        o->size_phase[i] = rng_range(seed, S, i, 8, 0.0f, 2.0f * (float)M_PI);
+    }
+}
+
+/**
+ * Inicializa N orbitadores con radios/fases aleatorias y parámetros de pulso.
+ * Con el RNG por contador cada partícula es independiente, así que el
+ * resultado no depende del ejecutor. Es la primera escritura del bloque y
+ * usa el mismo reparto que update_orbiters (bloques de SIM_BLOCK hasta cap):
+ * con OpenMP y --schedule static cada hilo toca primero las páginas que
+ * luego integra, que quedan en su nodo NUMA.
+ */
+void init_orbiters(const Executor *ex, Orbiters *o, const Attractors *a, int W, int H, uint32_t seed)
+{
+    OrbInitJob j = {o, a, (float)((W < H ? W : H)) * 0.08f, (float)((W < H ? W : H)) * 0.38f, seed};
+    ex->for_blocks(o->cap, SIM_BLOCK, init_orbiters_range, &j);
+}
+
+uint64_t orbiters_checksum(const Orbiters *o)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (int i = 0; i < o->n; ++i)
+    {
+        float f[7] = {o->x[i], o->y[i], o->px[i], o->py[i], o->vx[i], o->vy[i], o->angle[i]};
+        const unsigned char *b = (const unsigned char *)f;
+        for (size_t k = 0; k < sizeof(f); ++k)
+            h = (h ^ b[k]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+/**
+ * Integra la física de las partículas [i0,i1) (i0 múltiplo de ORB_LANES).
+ * Cada partícula realiza:
+ *   - Avance de ángulo de órbita (omega*dt).
+ *   - Cálculo de objetivo (tx,ty) en la órbita del atractor.
+ *   - Fuerza de resorte k*(dest - pos) y amortiguamiento -damping*vel.
+ *   - Integración explícita de velocidad y posición.
+ * Solo toca los arreglos calientes del SoA y se vectoriza con `omp simd`.
+ * Con fm != FASTMATH_OFF (integrate_range_fast) usa fast_sinf/fast_cosf y
+ * mantiene angle en [-pi,pi] para que la reducción de argumento sea exacta.
+ * Con uni = 1 todo el bloque sigue al atractor de i0 (partículas agrupadas
+ * por atractor): el centro queda en registro y no hay gather por partícula.
+ */
+FAST_INLINE void integrate_range_fast(Orbiters *o, const float *atx, const float *aty, float dt, int i0, int i1, const int fm,
+                                      const int uni)
+{
+    float *restrict x = o->x, *restrict y = o->y, *restrict px = o->px, *restrict py = o->py;
+    float *restrict vx = o->vx, *restrict vy = o->vy, *restrict angle = o->angle;
+    const float *restrict omega = o->omega, *restrict radius = o->radius;
+    const float *restrict kk = o->k, *restrict damping = o->damping;
+    const int *restrict att = o->att;
+    const float bx = atx[att[i0]], by = aty[att[i0]];
+#ifdef _OPENMP
+#pragma omp simd aligned(x, y, px, py, vx, vy, angle, omega, radius, kk, damping, att : ORB_ALIGN)
+#endif
+    for (int i = i0; i < i1; ++i)
+    {
+        px[i] = x[i];
+        py[i] = y[i];
+        float ang = wrap_pi(angle[i] + omega[i] * dt);
+        angle[i] = ang;
+        float tx = (uni ? bx : atx[att[i]]) + fast_cosf(ang, fm) * radius[i];
+        float ty = (uni ? by : aty[att[i]]) + fast_sinf(ang, fm) * radius[i];
+        float ax = kk[i] * (tx - x[i]) - damping[i] * vx[i];
+        float ay = kk[i] * (ty - y[i]) - damping[i] * vy[i];
+        vx[i] += ax * dt;
+        vy[i] += ay * dt;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+/** Variante libm de integrate_range_fast (sin reducción de ángulo). */
+FAST_INLINE void integrate_range_libm(Orbiters *o, const float *atx, const float *aty, float dt, int i0, int i1, const int uni)
+{
+    float *restrict x = o->x, *restrict y = o->y, *restrict px = o->px, *restrict py = o->py;
+    float *restrict vx = o->vx, *restrict vy = o->vy, *restrict angle = o->angle;
+    const float *restrict omega = o->omega, *restrict radius = o->radius;
+    const float *restrict kk = o->k, *restrict damping = o->damping;
+    const int *restrict att = o->att;
+    const float bx = atx[att[i0]], by = aty[att[i0]];
+#ifdef _OPENMP
+#pragma omp simd aligned(x, y, px, py, vx, vy, angle, omega, radius, kk, damping, att : ORB_ALIGN)
+#endif
+    for (int i = i0; i < i1; ++i)
+    {
+        px[i] = x[i];
+        py[i] = y[i];
+        float ang = angle[i] + omega[i] * dt;
+        angle[i] = ang;
+        float tx = (uni ? bx : atx[att[i]]) + cosf(ang) * radius[i];
+        float ty = (uni ? by : aty[att[i]]) + sinf(ang) * radius[i];
+        float ax = kk[i] * (tx - x[i]) - damping[i] * vx[i];
+        float ay = kk[i] * (ty - y[i]) - damping[i] * vy[i];
+        vx[i] += ax * dt;
+        vy[i] += ay * dt;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+/**
+ * Integra [i0,i1) con el modo fm y, si el bloque es de un solo atractor
+ * (att ordenado: basta comparar los extremos), sin gather de centros.
+ */
+void integrate_range(Orbiters *o, const float *atx, const float *aty, float dt, int i0, int i1, int fm)
+{
+    // Modo y uni como constantes en cada llamada: el compilador elimina las ramas internas
+    const bool uni = o->att[i0] == o->att[i1 - 1];
+    if (fm == FASTMATH_FAST)
+    {
+        if (uni)
+            integrate_range_fast(o, atx, aty, dt, i0, i1, FASTMATH_FAST, 1);
+        else
+            integrate_range_fast(o, atx, aty, dt, i0, i1, FASTMATH_FAST, 0);
+    }
+    else if (fm == FASTMATH_ACCURATE)
+    {
+        if (uni)
+            integrate_range_fast(o, atx, aty, dt, i0, i1, FASTMATH_ACCURATE, 1);
+        else
+            integrate_range_fast(o, atx, aty, dt, i0, i1, FASTMATH_ACCURATE, 0);
+    }
+    else if (uni)
+        integrate_range_libm(o, atx, aty, dt, i0, i1, 1);
+    else
+        integrate_range_libm(o, atx, aty, dt, i0, i1, 0);
+}
+
+/** Argumentos de update_orbiters_range. */
+typedef struct
+{
+    Orbiters *o;
+    const float *atx, *aty;
+    float dt;
+    int fm;
+} OrbStepJob;
+
+static void update_orbiters_range(void *ctx, int i0, int i1)
+{
+    const OrbStepJob *j = (const OrbStepJob *)ctx;
+    integrate_range(j->o, j->atx, j->aty, j->dt, i0, i1, j->fm);
+}
+
+/**
+ * Integra la física de todas las partículas: bloques de SIM_BLOCK, incluido
+ * el relleno hasta o->cap para no tener epílogo escalar.
+ */
+void update_orbiters(const Executor *ex, Orbiters *o, const Attractors *a, float dt, int fm)
+{
+    OrbStepJob j = {o, a->cx, a->cy, dt, fm};
+    ex->for_blocks(o->cap, SIM_BLOCK, update_orbiters_range, &j);
+}
+
+// ------------------------ Apariencia base por partícula ------------------------
+
+void neon_particle_hsv(int i, float t, float *hue, float *sat, float *val)
+{
+    float h = fmodf((float)i * 137.508f + 90.0f * sinf(0.23f * t + i * 0.031f), 360.0f);
+    if (h < 0.0f)
+        h += 360.0f;
+    *hue = h;
+    *sat = 0.85f;
+    *val = 1.00f;
+}
+
+void ocean_particle_hsv(int i, float t, float *hue, float *sat, float *val)
+{
+    *hue = 180.0f + fmodf((float)i * 3.5f + 18.0f * sinf(0.21f * t + i * 0.05f), 40.0f);
+    *sat = 0.65f + 0.20f * sinf(0.13f * t + i * 0.09f);
+    *val = 0.95f;
+}
+
+int particle_radius(const Orbiters *o, int i, float t, float point_scale, float *breath)
+{
+    float spd = sqrtf(o->vx[i] * o->vx[i] + o->vy[i] * o->vy[i]);
+    float br = 0.5f + 0.5f * sinf(o->size_speed[i] * t + o->size_phase[i]);
+    float base = o->size_base[i] * point_scale;
+    float amp = o->size_amp[i] * point_scale;
+    int pr = (int)lroundf(base + amp * br + fminf(2.0f, spd * 0.015f));
+    if (pr < 1)
+        pr = 1;
+    if (pr > 3)
+        pr = 3; // Se limita para una apariencia “HD”
+    if (breath)
+        *breath = br;
+    return pr;
+}
@@ -0,0 +1,397 @@
+/**
+ * Núcleo de simulación compartido (secuencial y paralelo)
+ * --------------------------------------------------------
+ * Todo lo que debe dar el mismo resultado en ambos binarios vive aquí: RNG
+ * por contador, HSV→RGB, matemática rápida, medición de FPS y de tiempos
+ * por etapa, el mundo
+ * (atractores y orbitadores en SoA), su inicialización, la física y el color
+ * y tamaño base de cada partícula. Los binarios solo difieren en el Executor
+ * que recorre los bloques de partículas (serie u OpenMP) y en su renderer.
+ *
+ * Se compila junto a cada programa (comun/src/mandala_core.c, -Icomun/src);
+ * el ejecutor OpenMP existe solo si esa compilación usa -fopenmp.
+ */
+
+#ifndef MANDALA_CORE_H
+#define MANDALA_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(_WIN32)
+#include <SDL.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ------------------------ Utilidades de CLI ------------------------
+
+/** Convierte string a int con validación de rango; retorna true si es válido. */
+bool parse_int(const char *s, int *out);
+
+/** Convierte string a float con validación; retorna true si es válido. */
+bool parse_float(const char *s, float *out);
+
+/** Comparación case-insensitive de C-strings. */
+bool str_ieq(const char *a, const char *b);
+
+// ------------------------ Utilidades numéricas ------------------------
+
+/*
+ * RNG por contador (SplitMix64 sin estado): el valor depende solo de
+ * (semilla, flujo, índice, campo), así que cada partícula se inicializa en
+ * cualquier hilo y en cualquier orden con el mismo resultado.
+ */
+#define RNG_STREAM_ATTR 1u // Flujo de los atractores
+#define RNG_STREAM_ORB 2u  // Flujo de los orbitadores
+#define RNG_STREAM_LOD 3u  // Flujo de los umbrales de nivel de detalle (--lod)
+
+/** Uniforme en [0,1) para el campo k (< 256) del elemento i del flujo stream. */
+float rng_u01(uint32_t seed, uint32_t stream, uint32_t i, uint32_t k);
+
+/** Uniforme en [a,b) con rng_u01. */
+float rng_range(uint32_t seed, uint32_t stream, uint32_t i, uint32_t k, float a, float b);
+
+/** Satura entero a [0,255] y lo castea a Uint8. */
+Uint8 clamp_u8(int v);
+
+/** Conversión HSV→RGB (h:0..360, s:0..1, v:0..1) a 8bpc. */
+void hsv2rgb(float h, float s, float v, Uint8 *r, Uint8 *g, Uint8 *b);
+
+// ------------------------ Matemática rápida (vectorizable) ------------------------
+
+/*
+ * Modos de --fast-math (precisión vs velocidad del camino por partícula):
+ *   0: libm (sinf/cosf/fmodf) y hsv2rgb con ramas.
+ *   1: polinomio impar grado 11 sobre [-pi/2,pi/2] (error abs. < 1e-6).
+ *   2: polinomio grado 7 (error abs. < 2e-4), más barato.
+ * En 1 y 2 el módulo trunca vía conversión a int y HSV→RGB es sin ramas; el
+ * redondeo usa el truco de 1.5*2^23 en vez de rintf/floorf para que incluso
+ * con SSE2 todo se componga de operaciones vectorizables en `omp simd`.
+ * El secuencial usa siempre FASTMATH_OFF.
+ */
+#define FASTMATH_OFF 0      // libm
+#define FASTMATH_ACCURATE 1 // Polinomio grado 11
+#define FASTMATH_FAST 2     // Polinomio grado 7
+
+#define TWO_PI_HI 6.28125f                // 2*pi en dos partes (Cody–Waite):
+#define TWO_PI_LO 1.9353071795864769e-3f  // HI exacto en float, LO el resto
+#define INV_TWO_PI 0.15915494309189535f
+#define ROUND_MAGIC 12582912.0f // 1.5*2^23: (x + M) - M redondea al entero más cercano
+
+/** Fuerza el inlining de los kernels con modo constante (el if de modo desaparece). */
+#if defined(__GNUC__) || defined(__clang__)
+#define FAST_INLINE static inline __attribute__((always_inline))
+#else
+#define FAST_INLINE static inline
+#endif
+
+/** min/max por comparación: sin la semántica NaN de fminf, mapean a minps/maxps. */
+static inline float vminf(float a, float b) { return a < b ? a : b; }
+static inline float vmaxf(float a, float b) { return a > b ? a : b; }
+
+/** Reduce x a [-pi,pi] restando el múltiplo más cercano de 2*pi (|x| < 2^22). */
+static inline float wrap_pi(float x)
+{
+    float q = (x * INV_TWO_PI + ROUND_MAGIC) - ROUND_MAGIC;
+    return (x - q * TWO_PI_HI) - q * TWO_PI_LO;
+}
+
+/** Seno aproximado sin ramas; `mode` elige el grado del polinomio (1 o 2). */
+static inline float fast_sinf(float x, int mode)
+{
+    x = wrap_pi(x);
+    // Simetría sin(x) = sin(±pi - x) para llevar x a [-pi/2, pi/2], sin ramas
+    float ax = fabsf(x), bx = (float)M_PI - ax;
+    float y = copysignf(1.0f, x) * vminf(ax, bx); // bx < 0 si wrap_pi rebasa pi
+    float y2 = y * y;
+    float p;
+    if (mode == FASTMATH_FAST)
+        p = -1.9841270e-4f; // Taylor grado 7
+    else
+        p = ((-2.5052108e-8f * y2 + 2.7557319e-6f) * y2 - 1.9841270e-4f); // Grado 11
+    p = ((p * y2 + 8.3333333e-3f) * y2 - 1.6666667e-1f) * y2;
+    return y + y * p;
+}
+
+/** Coseno aproximado: cos(x) = sin(x + pi/2), reduciendo antes de desplazar. */
+static inline float fast_cosf(float x, int mode) { return fast_sinf(wrap_pi(x) + (float)(M_PI * 0.5), mode); }
+
+/** Módulo con el mismo signo que x (semántica de fmodf); |x/m| < 2^31. */
+static inline float fast_fmodf(float x, float m) { return x - m * (float)(int)(x / m); }
+
+/**
+ * HSV→RGB sin ramas (h:0..360, s:0..1, v:0..1) en floats [0,1]:
+ * c_n = v - v*s*clamp(min(k, 4-k), 0, 1), con k = (n + h/60) mod 6 y
+ * n = 5,3,1 para R,G,B. Equivale a hsv2rgb sin la cascada de if.
+ */
+static inline void hsv2rgb_branchless(float h, float s, float v, float *r, float *g, float *b)
+{
+    float h6 = h * (1.0f / 60.0f); // h >= 0: truncar a int equivale a floor
+    float kr = 5.0f + h6, kg = 3.0f + h6, kb = 1.0f + h6;
+    kr -= 6.0f * (float)(int)(kr * (1.0f / 6.0f));
+    kg -= 6.0f * (float)(int)(kg * (1.0f / 6.0f));
+    kb -= 6.0f * (float)(int)(kb * (1.0f / 6.0f));
+    float vs = v * s;
+    *r = v - vs * vmaxf(0.0f, vminf(vminf(kr, 4.0f - kr), 1.0f));
+    *g = v - vs * vmaxf(0.0f, vminf(vminf(kg, 4.0f - kg), 1.0f));
+    *b = v - vs * vmaxf(0.0f, vminf(vminf(kb, 4.0f - kb), 1.0f));
+}
+
+/** Convierte canal [0,1] a 8 bits como hsv2rgb (trunca y satura). */
+static inline Uint8 unit_to_u8(float c)
+{
+    int v = (int)(c * 255.0f);
+    return (Uint8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/**
+ * Autoprueba de --self-test: acota el error de fast_sinf/fast_cosf contra
+ * libm y de hsv2rgb_branchless contra hsv2rgb. Retorna 0 si todo está
+ * dentro de las cotas, 1 si no.
+ */
+int fastmath_self_test(void);
+
+// ------------------------ FPS (tiempo y medición) ------------------------
+
+/** Medición de FPS con suavizado exponencial (EMA). */
+typedef struct
+{
+    uint64_t last_ticks; // Última marca de tiempo de alta resolución
+    double smoothed_fps; // FPS suavizado
+    double alpha;        // Factor EMA [0..1]
+} FPSCounter;
+
+/** Convierte ticks de alto rendimiento a segundos. */
+double ticks_to_seconds(uint64_t t);
+
+/** Convierte ticks a milisegundos enteros con redondeo correcto. */
+uint64_t ticks_to_ms_u64(uint64_t t);
+
+/** Avanza contador de FPS; retorna dt (s) y actualiza instantáneo/suavizado. */
+double fps_tick(FPSCounter *f, double *fps_inst);
+
+// ------------------------ Tiempos por etapa ------------------------
+
+/**
+ * Etapas del frame medidas por separado con SDL_GetPerformanceCounter. Ambos
+ * binarios escriben las mismas columnas; las que un binario no tiene quedan
+ * en 0.
+ */
+typedef enum
+{
+    STAGE_EVENTS,  // SDL_PollEvent
+    STAGE_UPDATE,  // update_attractors + update_orbiters (o fusionado)
+    STAGE_PRECALC, // Pre-cálculo de color/tamaño (0 en el secuencial y en modo fusionado)
+    STAGE_RENDER,  // render_frame (envío de dibujo)
+    STAGE_RESOLVE, // Resolución SSAA vía SDL_RenderCopy
+    STAGE_PRESENT, // SDL_RenderPresent
+    STAGE_WAIT,    // Espera del hilo principal por otros hilos (0 en el secuencial)
+    STAGE_COUNT
+} Stage;
+
+extern const char *const STAGE_NAMES[STAGE_COUNT];
+
+/** Gancho por tramo [t0,t1) (ticks) de la etapa `name`, p. ej. la traza del paralelo. */
+typedef void (*StageSpanFn)(const char *name, uint64_t t0, uint64_t t1);
+
+/**
+ * Acumulador de tiempos por etapa:
+ *   - total: ticks de toda la corrida (resumen headless),
+ *   - frame: ticks del frame en curso,
+ *   - win_*: muestras en ms por frame de la ventana de log actual, para
+ *     media y p95 por etapa en cada fila del CSV.
+ * Se inicializa en cero; span es opcional.
+ */
+typedef struct
+{
+    uint64_t total[STAGE_COUNT]; // Ticks acumulados por etapa
+    uint64_t frame[STAGE_COUNT]; // Ticks del frame en curso
+    uint64_t frames;             // Frames medidos
+    double *win_ms[STAGE_COUNT]; // Muestras (ms) de la ventana de log
+    int win_count, win_cap;      // Muestras usadas / capacidad
+    StageSpanFn span;            // NULL => sin gancho
+} StageTimes;
+
+/** Suma a la etapa s los ticks transcurridos desde *mark, avisa a span y avanza la marca. */
+void stage_lap(StageTimes *st, Stage s, uint64_t *mark);
+
+/** Cierra el frame: acumula totales y guarda la muestra de la ventana de log. */
+void stage_end_frame(StageTimes *st);
+
+/** Escribe en el CSV los nombres de columna <etapa>_ms_mean,<etapa>_ms_p95. */
+void stage_csv_header(FILE *fp);
+
+/** Escribe en el CSV media y p95 por etapa de la ventana (y la reinicia). */
+void stage_csv_row(FILE *fp, StageTimes *st);
+
+/** Libera los buffers de muestras. */
+void stage_free(StageTimes *st);
+
+// ------------------------ Ejecutores ------------------------
+
+/*
+ * Executor: cómo se recorren los bloques de partículas. El núcleo escribe
+ * cada bucle como "procesa [i0,i1)" y el ejecutor decide si los bloques van
+ * en serie o repartidos entre hilos; los bloques son independientes, así
+ * que el resultado no depende del ejecutor. Un backend nuevo (hilos propios,
+ * GPU) solo añade una entrada a la tabla.
+ */
+typedef void (*ExecBlockFn)(void *ctx, int i0, int i1);
+
+typedef struct
+{
+    const char *name;
+    int (*threads)(void);                                      // Hilos que usará for_blocks
+    void (*for_blocks)(int n, int block, ExecBlockFn fn, void *ctx); // [0,n) en bloques de `block`
+} Executor;
+
+typedef enum
+{
+    EXEC_SERIAL = 0,
+    EXEC_OPENMP,
+    EXEC_STEAL, // Robo de trabajo entre hilos (costo por bloque no uniforme)
+    EXEC_COUNT
+} ExecKind;
+
+extern const char *const EXEC_NAMES[EXEC_COUNT];
+
+/** Ejecutor de `kind`; sin _OPENMP, EXEC_OPENMP y EXEC_STEAL caen al serie. */
+const Executor *executor_get(ExecKind kind);
+
+#define EXEC_LANES 256 // Hilos por equipo con contador propio (los de índice mayor suman al último)
+
+/**
+ * Trabajo hecho por los ejecutores desde el último executor_take_stats, por
+ * índice de hilo en su equipo (equipos simultáneos, como el productor de
+ * --pipeline, suman en los mismos índices).
+ */
+typedef struct
+{
+    int lanes;                   // Hilos vistos (índice máximo + 1)
+    uint64_t blocks[EXEC_LANES]; // Bloques procesados
+    uint64_t steals[EXEC_LANES]; // Robos hechos (solo "steal")
+} ExecStats;
+
+/** Copia en *s lo acumulado por todos los ejecutores y lo reinicia. */
+void executor_take_stats(ExecStats *s);
+
+// ------------------------ Mundo: Atractores y Orbitadores ------------------------
+
+#define ATTR_KNN_MAX 4  // Máximo de atractores mezclados por partícula (--attr-k)
+#define ORB_ALIGN 64    // Alineación de cada arreglo (línea de caché / AVX-512)
+#define ORB_LANES 16    // Relleno de capacidad en elementos (16 floats = 64 bytes)
+#define SIM_BLOCK 256   // Partículas por bloque de trabajo (múltiplo de ORB_LANES)
+
+/*
+ * Attractors: tabla SoA de n atractores con movimiento senoidal independiente
+ * en X e Y. (cx,cy) es el centro que ven las partículas del atractor: con
+ * k = 1 coincide con (x,y); con k > 1 mezcla (x,y) con sus k-1 atractores más
+ * cercanos, ponderados por distancia. Se calcula una vez por atractor y frame,
+ * así la física sigue leyendo un solo par de floats por atractor.
+ */
+typedef struct
+{
+    int n, k;         // Atractores y vecinos mezclados (1 = solo el propio)
+    float sigma2;     // Escala² de la ponderación por distancia (px²)
+    float *x, *y;     // Posición actual
+    float *ax, *ay;   // Amplitudes
+    float *fx, *fy;   // Frecuencias (rad/s)
+    float *phx, *phy; // Fases iniciales (rad)
+    float *cx, *cy;   // Centro efectivo para la física
+    float *mem;       // Bloque único de los arreglos
+} Attractors;
+
+/**
+ * Orbiters: estado de las N partículas en formato SoA (structure of arrays).
+ * Cada campo vive en su propio arreglo, alineado a ORB_ALIGN bytes y con
+ * capacidad `cap` redondeada a múltiplo de ORB_LANES, de modo que el bucle
+ * de física recorre vectores completos sin epílogo escalar (el relleno queda
+ * en cero y es inerte). Campos:
+ *   - calientes (física): (x,y) posición, (px,py) previa para estela, (vx,vy)
+ *     velocidad, angle/omega/radius órbita alrededor del atractor att,
+ *     k/damping constantes del resorte y amortiguamiento;
+ *   - fríos (solo pre-cálculo): size_* control del “pulso” del punto.
+ */
+typedef struct
+{
+    int n, cap; // Partículas válidas / capacidad con relleno
+    float *x, *y, *px, *py, *vx, *vy;
+    float *angle, *omega, *radius, *k, *damping;
+    int *att;
+    float *size_base, *size_amp, *size_speed, *size_phase;
+} Orbiters;
+
+/** Bytes (múltiplo de ORB_ALIGN) del bloque que orbiters_bind reparte para n partículas. */
+size_t orbiters_bytes(int n);
+
+/**
+ * Reparte los arreglos SoA de n partículas dentro de mem (orbiters_bytes(n)
+ * bytes alineados a ORB_ALIGN), sin tocarlos: init_orbiters hace la primera
+ * escritura, incluido el relleno.
+ */
+void orbiters_bind(Orbiters *o, int n, void *mem);
+
+/** Reserva la tabla para n atractores mezclando k; false si no hay memoria. */
+bool attractors_alloc(Attractors *a, int n, int k);
+
+/** Libera la tabla de atractores. */
+void attractors_free(Attractors *a);
+
+/** Inicializa los atractores centrados con amplitudes/frecuencias/fases aleatorias (según seed). */
+void init_attractors(Attractors *a, int W, int H, uint32_t seed);
+
+/** Posiciones senoidales en t (s) y centros efectivos (mezcla k-NN si k > 1). */
+void update_attractors(const Executor *ex, Attractors *a, float t, int W, int H);
+
+/**
+ * Atractor de la partícula i: tramos contiguos de n/A partículas, así cada
+ * bloque de física lee casi siempre un solo atractor. Con i >= n (relleno)
+ * da el último, para que el arreglo siga ordenado.
+ */
+static inline int attractor_of(int i, int n, int A)
+{
+    int k = (int)((long long)i * A / n);
+    return k < A ? k : A - 1;
+}
+
+/** Inicializa las N partículas (y el relleno hasta cap) en bloques de SIM_BLOCK. */
+void init_orbiters(const Executor *ex, Orbiters *o, const Attractors *a, int W, int H, uint32_t seed);
+
+/**
+ * Checksum FNV-1a (64 bits) del estado final: bits de x, y, px, py, vx, vy y
+ * angle de cada partícula en orden de índice.
+ */
+uint64_t orbiters_checksum(const Orbiters *o);
+
+/** Integra [i0,i1) (i0 múltiplo de ORB_LANES) con el modo fm de --fast-math. */
+void integrate_range(Orbiters *o, const float *atx, const float *aty, float dt, int i0, int i1, int fm);
+
+/** Integra todas las partículas (hasta cap) en bloques de SIM_BLOCK repartidos por ex. */
+void update_orbiters(const Executor *ex, Orbiters *o, const Attractors *a, float dt, int fm);
+
+// ------------------------ Apariencia base por partícula ------------------------
+
+/** Calcula (hue, sat, val) sin saturación global de la partícula i en t. */
+typedef void (*ParticleHsvFn)(int i, float t, float *hue, float *sat, float *val);
+
+/** neon: ángulo áureo sobre todo el círculo, saturación fija. */
+void neon_particle_hsv(int i, float t, float *hue, float *sat, float *val);
+
+/** ocean: banda de cian/azul (180..220) con saturación ondulante. */
+void ocean_particle_hsv(int i, float t, float *hue, float *sat, float *val);
+
+/**
+ * Radio del punto [1..3] de la partícula i en t con libm: base + pulso +
+ * (ligero) escalado por velocidad. *breath recibe el pulso en [0,1].
+ */
+int particle_radius(const Orbiters *o, int i, float t, float point_scale, float *breath);
+
+#endif // MANDALA_CORE_H
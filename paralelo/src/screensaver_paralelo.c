@@ -11,34 +11,124 @@
  *   - Calidad adaptativa: ajusta SSAA, fracción de render y simetrías para
  *     intentar mantener un FPS objetivo.
  *   - Logging CSV de métricas de desempeño.
+ *   - Modo headless (--headless 1): sin ventana ni present; renderer por
+ *     software sobre una superficie offscreen y tiempos por etapa.
  *
  * Entrada por CLI (ver print_usage) y validación robusta (parse_args).
- * Requiere SDL2; usa OpenMP si está disponible (_OPENMP).
+ * Requiere SDL2; usa OpenMP si está disponible (_OPENMP) y, compilado con
+ * -DUSE_OPENCL, puede mover física y vértices a la GPU (--gpu 1); con
+ * -DUSE_MPI reparte las partículas entre los procesos de mpirun.
  */
 
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // MAP_ANONYMOUS/madvise y sched_setaffinity también con -std=c11 (glibc)
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h> // offsetof (columnas del log binario)
 #include <stdbool.h>
 #include <string.h>
 #include <limits.h>
 #include <time.h>
 #include <math.h>
 #include <ctype.h>
+#if !defined(_WIN32)
+#include <sys/mman.h> // mmap/madvise para la arena de partículas
+#include <sys/stat.h> // fstat de instantáneas (--load-state / --replay)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sched.h> // sched_setaffinity para --bind
+#endif
 
 #if defined(_WIN32)
 #include <SDL.h> // En Windows suele instalarse como SDL.h
 #else
 #include <SDL2/SDL.h> // En Linux/macOS suele usarse <SDL2/SDL.h>
 #endif
+#if defined(_WIN32)
+#include <SDL_opengl.h>
+#else
+#include <SDL2/SDL_opengl.h> // Tipos y constantes GL de --backend gl (funciones vía SDL_GL_GetProcAddress)
+#endif
 
 #ifdef _OPENMP
 #include <omp.h> // Paralelismo de la física si está disponible
 #endif
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
+#ifdef USE_OPENCL
+#define CL_TARGET_OPENCL_VERSION 120
+#if defined(__APPLE__)
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h> // Física y vértices en GPU con --gpu 1
 #endif
+#endif
+#ifdef USE_MPI
+#include <mpi.h> // Un mundo repartido entre procesos/nodos (mpirun)
+#endif
+
+#include "mandala_core.h" // Mundo, física y ejecutores compartidos con el secuencial
+
+/* Paleta resuelta una vez en parse_args (índice en PALETTES). */
+typedef enum
+{
+    PALETTE_NEON = 0,
+    PALETTE_OCEAN,
+    PALETTE_COUNT
+} PaletteId;
+
+/* Backend de dibujo: renderer de SDL, rasterizador por CPU (CpuRaster) o instancias GL (GlSprites). */
+typedef enum
+{
+    BACKEND_SDL = 0,
+    BACKEND_CPU,
+    BACKEND_GL,
+    BACKEND_COUNT
+} Backend;
+
+static const char *const BACKEND_NAMES[BACKEND_COUNT] = {"sdl", "cpu", "gl"};
+
+/* Estela (--trail): ninguna, una línea por copia o acumulación en el destino persistente. */
+typedef enum
+{
+    TRAIL_OFF = 0,
+    TRAIL_LINES,
+    TRAIL_ACCUM
+} TrailMode;
+
+/* Formato de --log: CSV por ventana o registros binarios por frame (BinLog). */
+typedef enum
+{
+    LOG_CSV = 0,
+    LOG_BIN
+} LogFormat;
+
+/* Reparto de los bucles por bloques de partículas (--schedule, schedule(runtime)). */
+typedef enum
+{
+    SCHED_STATIC = 0,
+    SCHED_DYNAMIC,
+    SCHED_GUIDED,
+    SCHED_COUNT
+} SchedPolicy;
+
+static const char *const SCHED_NAMES[SCHED_COUNT] = {"static", "dynamic", "guided"};
+
+/* Afinidad de los hilos del equipo OpenMP (--bind). */
+typedef enum
+{
+    BIND_NONE = 0,
+    BIND_CLOSE,
+    BIND_SPREAD,
+    BIND_COUNT
+} BindPolicy;
+
+static const char *const BIND_NAMES[BIND_COUNT] = {"none", "close", "spread"};
+
+#define ATTR_MAX 1024   // Máximo de atractores (--attractors)
+#define OUTPUTS_MAX 4   // Salidas de --outputs (el mundo de 4 vistas de 1920 px cabe en los deltas de Precomp)
 
 /* RGBA en 8 bits por canal. Representa color + opacidad. */
 typedef struct
@@ -57,10 +147,12 @@ typedef struct
     int n;               // Número de partículas/orbitadores
     int seconds;         // Duración; <=0 ejecuta hasta ESC/cerrar
     uint32_t seed;       // Semilla RNG; 0 => usa reloj
-    char palette[16];    // "neon" | "ocean"
+    char palette[16];    // "neon" | "ocean" (nombre canónico tras parse_args)
+    PaletteId palette_id; // Paleta resuelta (evita comparar strings por frame)
     int vsync;           // 1=ON, 0=OFF (tearing vs latencia)
     char log_path[256];  // Ruta a CSV para métricas (vacío => sin log)
     int log_every_ms;    // Período de muestreo del log (ms)
+    LogFormat log_format; // csv (filas por ventana) | bin (un registro por frame)
     int show_attractors; // 1=guías de atractores visibles
     float point_scale;   // Escala global del tamaño del punto
     int sym;             // Número de simetrías radiales [1..8]
@@ -71,10 +163,42 @@ typedef struct
     int bg_alpha;        // Alpha del “fade” de fondo [0..255]
     int threads;         // Hilos OpenMP (0 => auto)
     // Controles extra de rendimiento/claridad:
-    int trail;         // 0/1 traza línea de estela larga
+    TrailMode trail;   // 0 = sin estela, 1 = línea por copia, 2 = acumulación (el fade decae el destino, sin líneas)
     float render_frac; // Fracción de partículas a DIBUJAR (física corre para todas)
-    int adapt;         // 0/1 calidad adaptativa para mantener FPS
+    int adapt;         // Calidad adaptativa: 0=no, 1=controlador por tiempo de frame, 2=escalera por pasos
     int target_fps;    // FPS objetivo para adaptación
+    // Benchmark sin ventana:
+    int headless; // 0/1 sin ventana ni present (renderer software offscreen)
+    int frames;   // Frames a simular en modo headless (>=1)
+    int fused;    // 1=física+pre-cálculo en una región paralela; 0=dos regiones
+    int fast_math; // 0=libm, 1=polinomio preciso, 2=polinomio rápido (ver FASTMATH_*)
+    int self_test; // 1=corre fastmath_self_test() y termina
+    int color_lut; // 1=color por tabla hue→RGB (ColorLUT); 0=HSV por partícula
+    int batch;     // 1=SDL_RenderGeometry por capa (SpriteBatch); 0=RenderCopyF por sprite
+    int pipeline;  // 1=productor (física+pre-cálculo) en otro hilo, doble buffer
+    Backend backend;     // sdl | cpu (rasterizador por tiles en CPU) | gl (instancias OpenGL 3.3)
+    char dump_path[256]; // --backend cpu: PPM del último frame (vacío => no)
+    char record_path[256]; // --record: archivo Y4M, "|comando" o patrón PPM (vacío => no)
+    char save_state[256];  // --save-state: instantánea del mundo al salir (vacío => no)
+    char load_state[256];  // --load-state: reanuda desde una instantánea (vacío => mundo nuevo)
+    char save_frames[256]; // --save-frames: Precomp de cada frame para --replay (vacío => no)
+    char replay_path[256]; // --replay: dibuja los frames grabados sin simular (vacío => no)
+    int deterministic;   // 1=dt fijo y cfg.frames frames también con ventana; checksum al final
+    int hugepages;       // 1=arena de partículas con madvise(MADV_HUGEPAGE) si el SO lo soporta
+    SchedPolicy schedule; // Reparto de bloques de partículas entre hilos
+    int chunk;            // Bloques por trozo del reparto (0 => default del runtime)
+    BindPolicy bind;      // Afinidad de hilos: none | close | spread
+    ExecKind exec;        // Ejecutor de los bucles de simulación: serial | openmp
+    int gpu;              // 1=física y vértices en GPU (OpenCL, compilado con USE_OPENCL)
+    float interact;        // Intensidad de repulsión/cohesión entre partículas (0 => apagada)
+    float interact_radius; // Alcance de la interacción en px (lado de celda de ParticleGrid)
+    int attractors;        // Atractores [1..ATTR_MAX]
+    int attr_k;            // Atractores mezclados por partícula [1..ATTR_KNN_MAX]
+    int lod;               // 1=nivel de detalle por importancia (reemplaza el salto de render_frac)
+    float lod_budget;      // Sprites (quads) por frame con --lod 1 (0 => render_frac del costo completo)
+    int outputs;           // Salidas [1..OUTPUTS_MAX]: vistas contiguas de un mismo mundo, una por ventana/display
+    int overlay;           // 1=overlay de perfil (barras por etapa, hilos ocupados/ociosos, llamadas de dibujo); F1 lo oculta
+    char trace_path[256];  // --trace: eventos de Chrome (JSON) de etapas y regiones paralelas (vacío => no)
 } Config;
 
 /** Muestra ayuda de CLI con defaults y opciones válidas. */
@@ -82,57 +206,18 @@ static void print_usage(const char *exe)
 {
     fprintf(stderr,
             "Uso: %s [--n N] [--width W] [--height H] [--seconds S] [--seed SEED] "
-            "[--palette NAME] [--vsync 0|1] [--log PATH] [--log-every-ms MS] "
+            "[--palette NAME] [--vsync 0|1] [--log PATH] [--log-every-ms MS] [--log-format csv|bin] "
             "[--show-attractors 0|1] [--point-scale F] [--sym K] [--mirror 0|1] [--ssaa K] "
-            "[--sat F] [--glow 0|1] [--bg-alpha A] [--threads T] [--trail 0|1] "
-            "[--render-frac F] [--adapt 0|1] [--target-fps FPS]\n"
+            "[--sat F] [--glow 0|1] [--bg-alpha A] [--threads T] [--trail 0|1|2] "
+            "[--render-frac F] [--adapt 0|1|2] [--target-fps FPS] [--headless 0|1] [--frames F] [--fused 0|1] [--fast-math 0|1|2] [--self-test] [--color-lut 0|1] [--batch 0|1] [--pipeline 0|1] [--backend sdl|cpu|gl] [--dump PATH] [--record PATH] [--save-state PATH] [--load-state PATH] [--save-frames PATH] [--replay PATH] [--deterministic 0|1] [--hugepages 0|1] [--schedule static|dynamic|guided] [--chunk C] [--bind none|close|spread] [--exec serial|openmp|steal] [--gpu 0|1] [--interact K] [--interact-radius R] [--attractors A] [--attr-k K] [--lod 0|1] [--lod-budget Q] [--outputs K] [--overlay 0|1] [--trace PATH]\n"
             "Defaults: N=100, W=800, H=600, S=10, SEED=now, PALETTE=neon, VSYNC=1, "
-            "LOG_EVERY_MS=500, SHOW_ATTRACTORS=0, POINT_SCALE=1.0, SYM=6, MIRROR=1, "
+            "LOG_EVERY_MS=500, LOG_FORMAT=csv, SHOW_ATTRACTORS=0, POINT_SCALE=1.0, SYM=6, MIRROR=1, "
             "SSAA=2, SAT=0.65, GLOW=0, BG_ALPHA=10, THREADS=0(auto), TRAIL=0, "
-            "RENDER_FRAC=1.0, ADAPT=0, TARGET_FPS=30\n"
+            "RENDER_FRAC=1.0, ADAPT=0, TARGET_FPS=30, HEADLESS=0, FRAMES=600, FUSED=1, FAST_MATH=0, COLOR_LUT=1, BATCH=1, PIPELINE=0, BACKEND=sdl, DETERMINISTIC=0, HUGEPAGES=1, SCHEDULE=static, CHUNK=0(runtime), BIND=none, EXEC=openmp, GPU=0, INTERACT=0, INTERACT_RADIUS=16, ATTRACTORS=3, ATTR_K=1, LOD=0, LOD_BUDGET=0(auto), OUTPUTS=1, OVERLAY=0\n"
             "Paletas: neon | ocean\n",
             exe);
 }
 
-/** Convierte string a int con validación; retorna true si es válido. */
-static bool parse_int(const char *s, int *out)
-{
-    char *e = 0;
-    long v = strtol(s, &e, 10);
-    if (!e || *e)
-        return false;
-    if (v < INT_MIN || v > INT_MAX)
-        return false;
-    *out = (int)v;
-    return true;
-}
-
-/** Convierte string a float con validación; retorna true si es válido. */
-static bool parse_float(const char *s, float *out)
-{
-    char *e = 0;
-    float v = strtof(s, &e);
-    if (!e || *e)
-        return false;
-    *out = v;
-    return true;
-}
-
-/** Comparación case-insensitive de C-strings. */
-static bool str_ieq(const char *a, const char *b)
-{
-    if (!a || !b)
-        return false;
-    while (*a && *b)
-    {
-        char ca = (char)tolower((unsigned char)*a++),
-             cb = (char)tolower((unsigned char)*b++);
-        if (ca != cb)
-            return false;
-    }
-    return *a == '\0' && *b == '\0';
-}
-
 /**
  * Parsea y valida CLI. Aplica “clamps” de seguridad y normaliza paleta.
  * Asegura mínimos de resolución y partículas; inyecta semilla si es 0.
@@ -150,6 +235,7 @@ static Config parse_args(int argc, char **argv)
     cfg.vsync = 1;
     cfg.log_path[0] = '\0';
     cfg.log_every_ms = 500;
+    cfg.log_format = LOG_CSV;
     cfg.show_attractors = 0;
     cfg.point_scale = 1.0f;
     cfg.sym = 6;
@@ -163,6 +249,34 @@ static Config parse_args(int argc, char **argv)
     cfg.render_frac = 1.0f;
     cfg.adapt = 0;
     cfg.target_fps = 30;
+    cfg.headless = 0;
+    cfg.frames = 600;
+    cfg.fused = 1;
+    cfg.fast_math = FASTMATH_OFF;
+    cfg.self_test = 0;
+    cfg.color_lut = 1;
+    cfg.batch = 1;
+    cfg.pipeline = 0;
+    cfg.backend = BACKEND_SDL;
+    cfg.dump_path[0] = '\0';
+    cfg.record_path[0] = '\0';
+    cfg.save_state[0] = cfg.load_state[0] = cfg.save_frames[0] = cfg.replay_path[0] = '\0';
+    cfg.deterministic = 0;
+    cfg.hugepages = 1;
+    cfg.schedule = SCHED_STATIC;
+    cfg.chunk = 0;
+    cfg.bind = BIND_NONE;
+    cfg.exec = EXEC_OPENMP;
+    cfg.gpu = 0;
+    cfg.interact = 0.0f;
+    cfg.interact_radius = 16.0f;
+    cfg.attractors = 3;
+    cfg.attr_k = 1;
+    cfg.lod = 0;
+    cfg.lod_budget = 0.0f;
+    cfg.outputs = 1;
+    cfg.overlay = 0;
+    cfg.trace_path[0] = '\0';
 
     for (int i = 1; i < argc; ++i)
     {
@@ -244,6 +358,20 @@ static Config parse_args(int argc, char **argv)
             NEED();
             snprintf(cfg.log_path, sizeof(cfg.log_path), "%s", argv[++i]);
         }
+        else if (strcmp(a, "--log-format") == 0)
+        {
+            NEED();
+            ++i;
+            if (str_ieq(argv[i], "csv"))
+                cfg.log_format = LOG_CSV;
+            else if (str_ieq(argv[i], "bin"))
+                cfg.log_format = LOG_BIN;
+            else
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
         else if (strcmp(a, "--log-every-ms") == 0)
         {
             NEED();
@@ -363,7 +491,7 @@ static Config parse_args(int argc, char **argv)
                 print_usage(argv[0]);
                 exit(1);
             }
-            cfg.trail = v ? 1 : 0;
+            cfg.trail = (TrailMode)(v < 0 ? 0 : (v > 2 ? 2 : v));
         }
         else if (strcmp(a, "--render-frac") == 0)
         {
@@ -387,7 +515,7 @@ static Config parse_args(int argc, char **argv)
                 print_usage(argv[0]);
                 exit(1);
             }
-            cfg.adapt = v ? 1 : 0;
+            cfg.adapt = (v < 0 ? 0 : (v > 2 ? 2 : v));
         }
         else if (strcmp(a, "--target-fps") == 0)
         {
@@ -404,662 +532,6410 @@ static Config parse_args(int argc, char **argv)
                 v = 144;
             cfg.target_fps = v;
         }
-        else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0)
+        else if (strcmp(a, "--headless") == 0)
         {
-            print_usage(argv[0]);
-            exit(0);
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.headless = v ? 1 : 0;
         }
-        else
+        else if (strcmp(a, "--frames") == 0)
         {
-            fprintf(stderr, "Argumento no reconocido: %s\n", a);
-            print_usage(argv[0]);
-            exit(1);
+            NEED();
+            if (!parse_int(argv[++i], &cfg.frames))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            if (cfg.frames < 1)
+                cfg.frames = 1;
         }
-#undef NEED
-    }
-    // Normalización final
-    if (!str_ieq(cfg.palette, "neon") && !str_ieq(cfg.palette, "ocean"))
-        snprintf(cfg.palette, sizeof(cfg.palette), "%s", "neon");
-    if (cfg.width < 640)
-        cfg.width = 640;
-    if (cfg.height < 480)
-        cfg.height = 480;
-    if (cfg.n < 1)
-        cfg.n = 1;
-    if (cfg.seed == 0)
-        cfg.seed = (uint32_t)time(NULL);
-    return cfg;
-}
-
-// ------------------------ Utilidades numéricas ------------------------
-
-/** Retorna uniforme en [0,1]. */
-static float frand01(void) { return (float)rand() / (float)RAND_MAX; }
-
-/** Retorna uniforme en [a,b]. */
-static float frand_range(float a, float b) { return a + (b - a) * frand01(); }
-
-/** Satura entero a [0,255] y lo castea a Uint8. */
-static Uint8 clamp_u8(int v)
-{
-    if (v < 0)
-        v = 0;
-    if (v > 255)
-        v = 255;
-    return (Uint8)v;
-}
-
-/** Conversión HSV→RGB (h:0..360, s:0..1, v:0..1) a 8bpc. */
-static void hsv2rgb(float h, float s, float v, Uint8 *r, Uint8 *g, Uint8 *b)
-{
-    float C = v * s;
-    float X = C * (1.0f - fabsf(fmodf(h / 60.0f, 2.0f) - 1.0f));
-    float m = v - C;
-    float R = 0, G = 0, B = 0;
-    if (h < 60)
-    {
-        R = C;
-        G = X;
-        B = 0;
-    }
-    else if (h < 120)
-    {
-        R = X;
-        G = C;
-        B = 0;
-    }
-    else if (h < 180)
-    {
-        R = 0;
-        G = C;
-        B = X;
-    }
-    else if (h < 240)
-    {
-        R = 0;
-        G = X;
-        B = C;
-    }
-    else if (h < 300)
-    {
-        R = X;
-        G = 0;
-        B = C;
-    }
-    else
-    {
-        R = C;
-        G = 0;
-        B = X;
-    }
-    *r = clamp_u8((int)((R + m) * 255.0f));
-    *g = clamp_u8((int)((G + m) * 255.0f));
-    *b = clamp_u8((int)((B + m) * 255.0f));
-}
-
-// ------------------------ FPS (tiempo y medición) ------------------------
-
-/** Medición de FPS con suavizado exponencial (EMA). */
-typedef struct
-{
-    uint64_t last_ticks; // Última marca de tiempo de alta resolución
-    double smoothed_fps; // FPS suavizado
-    double alpha;        // Factor EMA [0..1]
-} FPSCounter;
-
-/** Convierte ticks de alto rendimiento a segundos. */
-static double ticks_to_seconds(uint64_t t) { return (double)t / (double)SDL_GetPerformanceFrequency(); }
-
-/** Convierte ticks a milisegundos enteros con redondeo correcto. */
-static uint64_t ticks_to_ms_u64(uint64_t t)
-{
-    double ms = (double)t * 1000.0 / (double)SDL_GetPerformanceFrequency();
-    if (ms < 0.0)
-        ms = 0.0;
-    return (uint64_t)(ms + 0.5);
-}
-
-/** Avanza contador de FPS; retorna dt (s) y actualiza instantáneo/suavizado. */
-static double fps_tick(FPSCounter *f, double *fps_inst)
-{
-    uint64_t now = SDL_GetPerformanceCounter();
-    double dt = ticks_to_seconds(now - f->last_ticks);
-    f->last_ticks = now;
-    double inst = (dt > 0.0) ? (1.0 / dt) : 0.0;
-    if (f->smoothed_fps <= 0.0)
-        f->smoothed_fps = inst;
-    else
-        f->smoothed_fps = f->alpha * inst + (1.0 - f->alpha) * f->smoothed_fps;
-    if (fps_inst)
-        *fps_inst = inst;
-    return dt;
-}
-
-// ------------------------ Mundo: Atractores y Orbitadores ------------------------
-
-/** Atractor con movimiento senoidal independiente en X e Y. */
-typedef struct
-{
-    float x, y;     // Posición actual
-    float ax, ay;   // Amplitudes
-    float fx, fy;   // Frecuencias (rad/s)
-    float phx, phy; // Fases iniciales (rad)
-} Attractor;
-
-/**
- * Orbiter (partícula):
- *   - (x,y) posición; (px,py) posición previa para estela
- *   - (vx,vy) velocidad
- *   - att índice de atractor seguido
- *   - angle/radius/omega parametrización de la órbita alrededor del atractor
- *   - k/damping constantes del resorte y amortiguamiento
- *   - size_* control del “pulso” del punto (estética)
- */
-typedef struct
-{
-    float x, y, px, py, vx, vy;
-    int att;
-    float angle, radius, omega, k, damping;
-    float size_base, size_amp, size_speed, size_phase;
-} Orbiter;
-
-#define NUM_ATTR 3 // Se utilizan 3 atractores coordinados
-
-/** Inicializa 3 atractores centrados con amplitudes/frecuencias/fases aleatorias. */
-static void init_attractors(Attractor a[NUM_ATTR], int W, int H)
-{
-    float cx = W * 0.5f, cy = H * 0.5f;
-    for (int i = 0; i < NUM_ATTR; ++i)
-    {
-        a[i].x = cx;
-        a[i].y = cy;
-        a[i].ax = frand_range(W * 0.20f, W * 0.35f);
-        a[i].ay = frand_range(H * 0.20f, H * 0.35f);
-        float fx_hz = frand_range(0.05f, 0.15f),
-              fy_hz = frand_range(0.05f, 0.15f);
-        a[i].fx = 2.0f * (float)M_PI * fx_hz; // Hz → rad/s
-        a[i].fy = 2.0f * (float)M_PI * fy_hz;
-        a[i].phx = frand_range(0.0f, (float)M_PI * 2.0f);
-        a[i].phy = frand_range(0.0f, (float)M_PI * 2.0f);
-    }
-}
-
-/** Actualiza posiciones senoidales de los atractores en el tiempo t (s). */
-static void update_attractors(Attractor a[NUM_ATTR], float t, int W, int H)
-{
-    float cx = W * 0.5f, cy = H * 0.5f;
-    for (int i = 0; i < NUM_ATTR; ++i)
-    {
-        a[i].x = cx + a[i].ax * sinf(a[i].fx * t + a[i].phx);
-        a[i].y = cy + a[i].ay * sinf(a[i].fy * t + a[i].phy);
-    }
-}
-
-/** Inicializa N orbitadores con radios/fases aleatorias y parámetros de pulso. */
-static void init_orbiters(Orbiter *o, int n, Attractor a[NUM_ATTR], int W, int H)
-{
-    float minR = (float)((W < H ? W : H)) * 0.08f;
-    float maxR = (float)((W < H ? W : H)) * 0.38f;
-    for (int i = 0; i < n; ++i)
-    {
-        o[i].att = i % NUM_ATTR;
-        o[i].radius = frand_range(minR, maxR);
-        o[i].angle = frand_range(0.0f, (float)M_PI * 2.0f);
-        float hz = frand_range(0.04f, 0.35f);
-        o[i].omega = 2.0f * (float)M_PI * hz; // rad/s
-        o[i].k = frand_range(4.0f, 10.0f);
-        o[i].damping = frand_range(1.4f, 3.2f);
-        float tx = a[o[i].att].x + cosf(o[i].angle) * o[i].radius;
-        float ty = a[o[i].att].y + sinf(o[i].angle) * o[i].radius;
-        o[i].x = o[i].px = tx;
-        o[i].y = o[i].py = ty;
-        o[i].vx = o[i].vy = 0.0f;
-        // Parámetros estéticos de respiración del punto
-        o[i].size_base = frand_range(2.0f, 3.5f);
-        o[i].size_amp = frand_range(1.2f, 2.8f);
-        o[i].size_speed = frand_range(0.6f, 1.6f) * 2.0f * (float)M_PI;
-        o[i].size_phase = frand_range(0.0f, 2.0f * (float)M_PI);
-    }
-}
-
-/**
- * Integra la física de N partículas en paralelo (OpenMP si está disponible).
- * Cada partícula realiza:
- *   - Avance de ángulo de órbita (omega*dt).
- *   - Cálculo de objetivo (tx,ty) en la órbita del atractor.
- *   - Fuerza de resorte k*(dest - pos) y amortiguamiento -damping*vel.
- *   - Integración explícita de velocidad y posición.
- */
-static void update_orbiters_parallel(Orbiter *o, int n, Attractor a[NUM_ATTR], float dt, int threads)
-{
-#ifdef _OPENMP
-    if (threads > 0)
-        omp_set_num_threads(threads);
-    else
-        omp_set_num_threads(omp_get_max_threads());
-#pragma omp parallel for schedule(static)
-#endif
-    for (int i = 0; i < n; ++i)
-    {
-        Orbiter *p = &o[i];
-        p->px = p->x;
-        p->py = p->y;
-        p->angle += p->omega * dt;
-        float tx = a[p->att].x + cosf(p->angle) * p->radius;
-        float ty = a[p->att].y + sinf(p->angle) * p->radius;
-        float ax = p->k * (tx - p->x) - p->damping * p->vx;
-        float ay = p->k * (ty - p->y) - p->damping * p->vy;
-        p->vx += ax * dt;
-        p->vy += ay * dt;
-        p->x += p->vx * dt;
-        p->y += p->vy * dt;
-    }
-}
-
-// ------------------------ Pre-cálculo para dibujo ------------------------
-
-/** Adelanto de firma: calcula color de partícula según paleta y tiempo. */
-static void particle_color(const Config *cfg, int i, float t, Uint8 *r, Uint8 *g, Uint8 *b);
-
-/**
- * Precomp: datos precomputados por partícula para reducir trabajo en el bucle
- * de dibujo. Incluye:
- *   - deltas relativos al centro (actual y previo),
- *   - radio del punto (pr),
- *   - color actual (r,g,b).
- */
-typedef struct
-{
-    float dx0, dy0, dxp, dyp; // Pos actuales y previas relativas al centro
-    int pr;                   // Radio de punto [1..3]
-    Uint8 r, g, b;            // Color actual
-} Precomp;
-
-/**
- * Precalcula deltas, radios y colores por partícula (paralelizable).
- * Reduce el costo durante el render al reusar estos valores.
- */
-static void precalc_particles(const Config *cfg, const Orbiter *o, int n, float t, float cx, float cy, Precomp *out, int threads)
-{
-#ifdef _OPENMP
-    if (threads > 0)
-        omp_set_num_threads(threads);
-#pragma omp parallel for schedule(static)
-#endif
-    for (int i = 0; i < n; ++i)
-    {
-        float dx0 = o[i].x - cx, dy0 = o[i].y - cy;
-        float dxp = o[i].px - cx, dyp = o[i].py - cy;
-        float spd = sqrtf(o[i].vx * o[i].vx + o[i].vy * o[i].vy);
-        float breath = 0.5f + 0.5f * sinf(o[i].size_speed * t + o[i].size_phase);
-        float base = o[i].size_base * cfg->point_scale;
-        float amp = o[i].size_amp * cfg->point_scale;
-        int pr = (int)lroundf(base + amp * breath + fminf(2.0f, spd * 0.015f));
-        if (pr < 1)
-            pr = 1;
-        if (pr > 3)
-            pr = 3;
-        Uint8 rr, gg, bb;
-        particle_color(cfg, i, t, &rr, &gg, &bb);
-        out[i].dx0 = dx0;
-        out[i].dy0 = dy0;
-        out[i].dxp = dxp;
-        out[i].dyp = dyp;
-        out[i].pr = pr;
-        out[i].r = rr;
-        out[i].g = gg;
-        out[i].b = bb;
-    }
-}
-
-// ------------------------ Sprites: discos y halos ------------------------
-
-/**
- * Genera textura de disco RGBA (radio r) para dibujar puntos vía GPU.
- * Usa superficie temporal y la convierte en textura, con blend habilitado.
- */
-static SDL_Texture *make_disc_texture(SDL_Renderer *ren, int r)
-{
-    int D = r * 2 + 1;
-    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, D, D, 32, SDL_PIXELFORMAT_RGBA32);
-    if (!s)
-        return NULL;
-    Uint32 *p = (Uint32 *)s->pixels;
-    int pitch = s->pitch / 4;
-    Uint32 on = SDL_MapRGBA(s->format, 255, 255, 255, 255);
-    Uint32 off = SDL_MapRGBA(s->format, 255, 255, 255, 0);
-    for (int y = 0; y < D; ++y)
-    {
-        for (int x = 0; x < D; ++x)
+        else if (strcmp(a, "--fused") == 0)
         {
-            int dx = x - r, dy = y - r;
-            int d2 = dx * dx + dy * dy;
-            p[y * pitch + x] = (d2 <= r * r) ? on : off;
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.fused = v ? 1 : 0;
         }
-    }
-    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, s);
-    SDL_FreeSurface(s);
-    if (tex)
-        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
-    return tex;
-}
-
-/**
- * Genera textura radial RGBA (D x D) para halos suaves (falloff ~ t^1.8).
- * Se colorea y modula alpha por partícula en tiempo de dibujo.
- */
-static SDL_Texture *make_radial_texture(SDL_Renderer *ren, int D)
-{
-    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, D, D, 32, SDL_PIXELFORMAT_RGBA32);
-    if (!s)
-        return NULL;
-    Uint32 *p = (Uint32 *)s->pixels;
-    int pitch = s->pitch / 4;
-    Uint32 pix;
-    for (int y = 0; y < D; ++y)
-    {
-        for (int x = 0; x < D; ++x)
+        else if (strcmp(a, "--fast-math") == 0)
         {
-            float dx = x - (D - 1) * 0.5f;
-            float dy = y - (D - 1) * 0.5f;
-            float r = sqrtf(dx * dx + dy * dy);
-            float t = fmaxf(0.0f, 1.0f - r / (D * 0.5f));
-            Uint8 a = (Uint8)(255.0f * powf(t, 1.8f));
-            pix = SDL_MapRGBA(s->format, 255, 255, 255, a);
-            p[y * pitch + x] = pix;
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.fast_math = (v < FASTMATH_OFF ? FASTMATH_OFF : (v > FASTMATH_FAST ? FASTMATH_FAST : v));
         }
-    }
-    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, s);
-    SDL_FreeSurface(s);
-    if (tex)
-        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
-    return tex;
-}
-
-// ------------------------ Paletas y colores ------------------------
-
-/** Color de atractores según paleta (neon/ocean) con leve modulación temporal. */
-static void palette_attractor_color(const char *pal, int k, float t, Uint8 *r, Uint8 *g, Uint8 *b)
-{
-    float base = str_ieq(pal, "ocean") ? 190.0f : 0.0f;
-    float hue = base + 20.0f * k + 10.0f * sinf(0.37f * t + k);
+        else if (strcmp(a, "--self-test") == 0)
+        {
+            cfg.self_test = 1;
+        }
+        else if (strcmp(a, "--color-lut") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.color_lut = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--batch") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.batch = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--pipeline") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.pipeline = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--backend") == 0)
+        {
+            NEED();
+            ++i;
+            int k = 0;
+            while (k < BACKEND_COUNT && !str_ieq(argv[i], BACKEND_NAMES[k]))
+                ++k;
+            if (k == BACKEND_COUNT)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.backend = (Backend)k;
+        }
+        else if (strcmp(a, "--dump") == 0)
+        {
+            NEED();
+            snprintf(cfg.dump_path, sizeof(cfg.dump_path), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--record") == 0)
+        {
+            NEED();
+            snprintf(cfg.record_path, sizeof(cfg.record_path), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--save-state") == 0)
+        {
+            NEED();
+            snprintf(cfg.save_state, sizeof(cfg.save_state), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--load-state") == 0)
+        {
+            NEED();
+            snprintf(cfg.load_state, sizeof(cfg.load_state), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--save-frames") == 0)
+        {
+            NEED();
+            snprintf(cfg.save_frames, sizeof(cfg.save_frames), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--replay") == 0)
+        {
+            NEED();
+            snprintf(cfg.replay_path, sizeof(cfg.replay_path), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--deterministic") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.deterministic = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--hugepages") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.hugepages = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--schedule") == 0)
+        {
+            NEED();
+            ++i;
+            int k = 0;
+            while (k < SCHED_COUNT && !str_ieq(argv[i], SCHED_NAMES[k]))
+                ++k;
+            if (k == SCHED_COUNT)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.schedule = (SchedPolicy)k;
+        }
+        else if (strcmp(a, "--exec") == 0)
+        {
+            NEED();
+            ++i;
+            int k = 0;
+            while (k < EXEC_COUNT && !str_ieq(argv[i], EXEC_NAMES[k]))
+                ++k;
+            if (k == EXEC_COUNT)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.exec = (ExecKind)k;
+        }
+        else if (strcmp(a, "--gpu") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.gpu = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--chunk") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.chunk = (v < 0 ? 0 : v);
+        }
+        else if (strcmp(a, "--bind") == 0)
+        {
+            NEED();
+            ++i;
+            int k = 0;
+            while (k < BIND_COUNT && !str_ieq(argv[i], BIND_NAMES[k]))
+                ++k;
+            if (k == BIND_COUNT)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.bind = (BindPolicy)k;
+        }
+        else if (strcmp(a, "--interact") == 0)
+        {
+            float v;
+            NEED();
+            if (!parse_float(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.interact = (v < 0 ? 0 : v);
+        }
+        else if (strcmp(a, "--interact-radius") == 0)
+        {
+            float v;
+            NEED();
+            if (!parse_float(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.interact_radius = (v < 4 ? 4 : (v > 128 ? 128 : v));
+        }
+        else if (strcmp(a, "--attractors") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.attractors = (v < 1 ? 1 : (v > ATTR_MAX ? ATTR_MAX : v));
+        }
+        else if (strcmp(a, "--attr-k") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.attr_k = (v < 1 ? 1 : (v > ATTR_KNN_MAX ? ATTR_KNN_MAX : v));
+        }
+        else if (strcmp(a, "--lod") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.lod = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--lod-budget") == 0)
+        {
+            float v;
+            NEED();
+            if (!parse_float(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.lod_budget = v < 0.0f ? 0.0f : v;
+        }
+        else if (strcmp(a, "--outputs") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.outputs = (v < 1 ? 1 : (v > OUTPUTS_MAX ? OUTPUTS_MAX : v));
+        }
+        else if (strcmp(a, "--overlay") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.overlay = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--trace") == 0)
+        {
+            NEED();
+            snprintf(cfg.trace_path, sizeof(cfg.trace_path), "%s", argv[++i]);
+        }
+        else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0)
+        {
+            print_usage(argv[0]);
+            exit(0);
+        }
+        else
+        {
+            fprintf(stderr, "Argumento no reconocido: %s\n", a);
+            print_usage(argv[0]);
+            exit(1);
+        }
+#undef NEED
+    }
+    // Normalización final: resuelve la paleta (desconocida => neon)
+    cfg.palette_id = str_ieq(cfg.palette, "ocean") ? PALETTE_OCEAN : PALETTE_NEON;
+    snprintf(cfg.palette, sizeof(cfg.palette), "%s", cfg.palette_id == PALETTE_OCEAN ? "ocean" : "neon");
+    if (cfg.width < 640)
+        cfg.width = 640;
+    if (cfg.height < 480)
+        cfg.height = 480;
+    if (cfg.n < 1)
+        cfg.n = 1;
+    if (cfg.seed == 0)
+        cfg.seed = (uint32_t)time(NULL);
+    if (cfg.outputs > 1 && cfg.backend != BACKEND_SDL)
+    {
+        fprintf(stderr, "--outputs %d: las vistas se dibujan con el renderer de SDL; se ignora --backend %s\n", cfg.outputs,
+                BACKEND_NAMES[cfg.backend]);
+        cfg.backend = BACKEND_SDL;
+    }
+    if (cfg.backend == BACKEND_CPU)
+        cfg.batch = 0; // Los lotes solo alimentan al renderer de SDL
+    if (cfg.replay_path[0] != '\0' && (cfg.load_state[0] != '\0' || cfg.save_state[0] != '\0' || cfg.save_frames[0] != '\0'))
+    {
+        fprintf(stderr, "--replay no simula: no admite --load-state, --save-state ni --save-frames\n");
+        exit(1);
+    }
+    return cfg;
+}
+
+// ------------------------ Perfil de la ruta caliente (--overlay / --trace) ------------------------
+
+#define PROF_LANES 128            // Hilos por equipo con tiempo propio (los de índice mayor no se miden)
+#define PROF_TID_TEAM 1000        // tid de --trace: equipo * PROF_TID_TEAM + (0 = etapas, 1 + hilo)
+#define TRACE_MAX_EVENTS (1 << 21) // Tope de eventos en memoria de --trace (~64 MB)
+
+/*
+ * Perfilador activo solo con --overlay 1 o --trace. Las regiones paralelas
+ * (ejecutor PROF alrededor del de --exec, y los bucles OpenMP propios que
+ * lo piden) miden cada bloque en el hilo que lo corre: ocupado = suma de
+ * sus bloques, ocioso = resto del tiempo de pared de la región. Hay dos
+ * equipos: 0 = hilo principal, 1 = productor de --pipeline (lo de otros
+ * hilos, como las vistas de --outputs, no se cuenta). Con --trace
+ * cada etapa y cada hilo por región queda como tramo en memoria y al salir
+ * se escribe en formato de eventos de Chrome (chrome://tracing, Perfetto).
+ */
+typedef struct
+{
+    const char *name; // Literal estático: etapa o región
+    uint64_t t0, t1;  // Ticks de SDL_GetPerformanceCounter
+    int tid;
+    int blocks;       // Bloques del hilo en la región (-1 = tramo de etapa)
+} TraceEvent;
+
+/** Muestras acumuladas desde el último prof_take, por equipo e hilo. */
+typedef struct
+{
+    uint64_t busy[2][PROF_LANES]; // Ticks ocupados
+    uint64_t span[2];             // Ticks de pared de las regiones del equipo
+    int lanes[2];                 // Hilos vistos (índice máximo + 1)
+} ProfSample;
+
+typedef struct
+{
+    bool on;
+    SDL_threadID main_id;  // Hilo del equipo 0
+    SDL_threadID prod_id;  // Hilo del equipo 1 (0 sin productor)
+    SDL_mutex *lock;       // Productor y main cierran regiones a la vez; protege también prod_id
+    const Executor *inner; // Ejecutor envuelto (solo lo fija el hilo que simula)
+    const char *region;    // Nombre de la próxima región del ejecutor PROF
+    ProfSample acc;
+    TraceEvent *ev;        // --trace (NULL => sin traza)
+    size_t nev, cap;
+    bool full;             // Se llegó a TRACE_MAX_EVENTS
+    uint64_t t_base;       // Origen de tiempos de la traza
+} Prof;
+
+static Prof prof; // Los callbacks del ejecutor no reciben contexto (como mpi_world)
+
+/** Tiempos de una región paralela en curso, por hilo del equipo. */
+typedef struct
+{
+    uint64_t busy, first, last; // Ticks ocupados, inicio del primer bloque y fin del último
+    int blocks;
+} ProfLane;
+
+typedef struct
+{
+    const char *name;
+    uint64_t t0;
+    ProfLane lane[PROF_LANES];
+} ProfRegion;
+
+/** Activa el perfil (y la traza si trace); false si no hay mutex o memoria. */
+static bool prof_init(bool trace)
+{
+    prof.lock = SDL_CreateMutex();
+    if (!prof.lock)
+        return false;
+    if (trace)
+    {
+        prof.cap = 1 << 16;
+        prof.ev = (TraceEvent *)malloc(sizeof(TraceEvent) * prof.cap);
+        if (!prof.ev)
+        {
+            SDL_DestroyMutex(prof.lock);
+            prof.lock = NULL;
+            return false;
+        }
+    }
+    prof.main_id = SDL_ThreadID();
+    prof.t_base = SDL_GetPerformanceCounter();
+    prof.on = true;
+    return true;
+}
+
+static void prof_free(void)
+{
+    free(prof.ev);
+    if (prof.lock)
+        SDL_DestroyMutex(prof.lock);
+    memset(&prof, 0, sizeof(prof));
+}
+
+/** Equipo del hilo que llama (-1 si no es main ni el productor); con prof.lock tomado. */
+static int prof_team(void)
+{
+    SDL_threadID id = SDL_ThreadID();
+    return id == prof.main_id ? 0 : (prof.prod_id != 0 && id == prof.prod_id ? 1 : -1);
+}
+
+/** El hilo productor se anota como equipo 1 al arrancar. */
+static void prof_set_producer(void)
+{
+    if (!prof.on)
+        return;
+    SDL_LockMutex(prof.lock);
+    prof.prod_id = SDL_ThreadID();
+    SDL_UnlockMutex(prof.lock);
+}
+
+/** Agrega un tramo a la traza; llamar con prof.lock tomado. */
+static void trace_push(const char *name, uint64_t t0, uint64_t t1, int tid, int blocks)
+{
+    if (prof.nev == prof.cap)
+    {
+        TraceEvent *p = prof.cap < TRACE_MAX_EVENTS ? (TraceEvent *)realloc(prof.ev, sizeof(TraceEvent) * prof.cap * 2) : NULL;
+        if (!p)
+        {
+            if (!prof.full)
+                fprintf(stderr, "--trace: se alcanzó el tope de %zu eventos; el resto de la corrida no se traza\n", prof.nev);
+            prof.full = true;
+            return;
+        }
+        prof.ev = p;
+        prof.cap *= 2;
+    }
+    prof.ev[prof.nev++] = (TraceEvent){name, t0, t1, tid, blocks};
+}
+
+/** Tramo [t0,t1) de una etapa en la fila del equipo que llama (sin --trace no hace nada). */
+static void prof_span(const char *name, uint64_t t0, uint64_t t1)
+{
+    if (!prof.ev || prof.full)
+        return;
+    SDL_LockMutex(prof.lock);
+    int team = prof_team();
+    if (team >= 0)
+        trace_push(name, t0, t1, team * PROF_TID_TEAM, -1);
+    SDL_UnlockMutex(prof.lock);
+}
+
+static void prof_region_begin(ProfRegion *r, const char *name)
+{
+    memset(r->lane, 0, sizeof(r->lane));
+    r->name = name;
+    r->t0 = SDL_GetPerformanceCounter();
+}
+
+/** Bloque [a,b) corrido por el hilo actual del equipo (cada hilo toca solo su ProfLane). */
+static void prof_block(ProfRegion *r, uint64_t a, uint64_t b)
+{
+#ifdef _OPENMP
+    int t = omp_get_thread_num();
+#else
+    int t = 0;
+#endif
+    if (t >= PROF_LANES)
+        return;
+    ProfLane *l = &r->lane[t];
+    if (l->blocks++ == 0)
+        l->first = a;
+    l->last = b;
+    l->busy += b - a;
+}
+
+/** Cierra la región: suma ocupado/pared al equipo y deja un tramo por hilo en la traza. */
+static void prof_region_end(ProfRegion *r)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    SDL_LockMutex(prof.lock);
+    int team = prof_team();
+    if (team < 0)
+    {
+        SDL_UnlockMutex(prof.lock);
+        return;
+    }
+    prof.acc.span[team] += now - r->t0;
+    for (int t = 0; t < PROF_LANES; ++t)
+    {
+        const ProfLane *l = &r->lane[t];
+        if (l->blocks == 0)
+            continue;
+        prof.acc.busy[team][t] += l->busy;
+        if (t + 1 > prof.acc.lanes[team])
+            prof.acc.lanes[team] = t + 1;
+        if (prof.ev && !prof.full)
+            trace_push(r->name, l->first, l->last, team * PROF_TID_TEAM + 1 + t, l->blocks);
+    }
+    SDL_UnlockMutex(prof.lock);
+}
+
+/** Copia en *s lo acumulado desde la llamada anterior y lo reinicia. */
+static void prof_take(ProfSample *s)
+{
+    SDL_LockMutex(prof.lock);
+    *s = prof.acc;
+    memset(&prof.acc, 0, sizeof(prof.acc));
+    SDL_UnlockMutex(prof.lock);
+}
+
+typedef struct
+{
+    ExecBlockFn fn;
+    void *ctx;
+    ProfRegion *r;
+} ProfJob;
+
+static void prof_job_block(void *ctx, int i0, int i1)
+{
+    const ProfJob *j = (const ProfJob *)ctx;
+    uint64_t a = SDL_GetPerformanceCounter();
+    j->fn(j->ctx, i0, i1);
+    prof_block(j->r, a, SDL_GetPerformanceCounter());
+}
+
+static int prof_threads(void) { return prof.inner->threads(); }
+
+/** Una región medida: los bloques del ejecutor envuelto, cronometrados por hilo. */
+static void prof_for_blocks(int n, int block, ExecBlockFn fn, void *ctx)
+{
+    ProfRegion r;
+    prof_region_begin(&r, prof.region);
+    ProfJob j = {fn, ctx, &r};
+    prof.inner->for_blocks(n, block, prof_job_block, &j);
+    prof_region_end(&r);
+}
+
+static const Executor EXECUTOR_PROF = {"prof", prof_threads, prof_for_blocks};
+
+/**
+ * ex envuelto para medir sus próximas regiones con el nombre `name`; sin
+ * perfil devuelve ex. Solo lo llama el hilo que simula (main o productor).
+ */
+static const Executor *prof_executor(const Executor *ex, const char *name)
+{
+    if (!prof.on)
+        return ex;
+    prof.inner = ex;
+    prof.region = name;
+    return &EXECUTOR_PROF;
+}
+
+/**
+ * Escribe la traza en formato de eventos de Chrome: un evento completo ("X")
+ * por tramo, con ts/dur en µs, y el nombre de cada fila ("M"). false si no
+ * se pudo escribir.
+ */
+static bool trace_write(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return false;
+    const double us = 1e6 / (double)SDL_GetPerformanceFrequency();
+    bool seen[2][PROF_LANES + 1] = {{false}};
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t k = 0; k < prof.nev; ++k)
+    {
+        const TraceEvent *e = &prof.ev[k];
+        int team = e->tid / PROF_TID_TEAM, row = e->tid % PROF_TID_TEAM;
+        seen[team][row] = true;
+        fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+                e->name, e->blocks < 0 ? "stage" : "region", (double)(int64_t)(e->t0 - prof.t_base) * us,
+                (double)(e->t1 - e->t0) * us, e->tid);
+        if (e->blocks >= 0)
+            fprintf(fp, ",\"args\":{\"blocks\":%d}", e->blocks);
+        fprintf(fp, "},\n");
+    }
+    static const char *const team_names[2] = {"main", "productor"};
+    for (int team = 0; team < 2; ++team)
+        for (int row = 0; row <= PROF_LANES; ++row)
+        {
+            if (!seen[team][row])
+                continue;
+            int tid = team * PROF_TID_TEAM + row;
+            if (row == 0)
+                fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", tid,
+                        team_names[team]);
+            else
+                fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s omp %d\"}},\n", tid,
+                        team_names[team], row - 1);
+            fprintf(fp, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}},\n", tid, tid);
+        }
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"screensaver_par\"}}\n]}\n");
+    return fclose(fp) == 0;
+}
+
+// ------------------------ Tiempos por etapa ------------------------
+
+/* Stage, StageTimes y su CSV viven en mandala_core; aquí solo el reporte headless. */
+
+/**
+ * Imprime resumen de tiempos medios por etapa (ms/frame), FPS de cómputo (suma
+ * de etapas) y FPS reales (wall_s). Con --pipeline 1 update/precalc corren en
+ * el productor solapados con el render, así que la suma supera al tiempo real.
+ */
+static void stage_report(FILE *fp, const StageTimes *st, const Config *cfg, int threads, double wall_s)
+{
+    double frames = st->frames > 0 ? (double)st->frames : 1.0;
+    double sum_ms = 0.0;
+    fprintf(fp, "headless: frames=%llu n=%d res=%dx%d ssaa=%d sym=%d mirror=%d threads=%d schedule=%s,%d bind=%s exec=%s gpu=%d\n",
+            (unsigned long long)st->frames, cfg->n, cfg->width, cfg->height,
+            cfg->ssaa, cfg->sym, cfg->mirror, threads, SCHED_NAMES[cfg->schedule], cfg->chunk, BIND_NAMES[cfg->bind],
+            executor_get(cfg->exec)->name, cfg->gpu);
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        double ms = ticks_to_seconds(st->total[s]) * 1000.0 / frames;
+        sum_ms += ms;
+        fprintf(fp, "  %-8s %9.3f ms/frame\n", STAGE_NAMES[s], ms);
+    }
+    fprintf(fp, "  %-8s %9.3f ms/frame (%.1f FPS de cómputo)\n", "total", sum_ms,
+            sum_ms > 0.0 ? 1000.0 / sum_ms : 0.0);
+    double wall_ms = wall_s * 1000.0 / frames;
+    fprintf(fp, "  %-8s %9.3f ms/frame (%.1f FPS reales)\n", "wall", wall_ms,
+            wall_ms > 0.0 ? 1000.0 / wall_ms : 0.0);
+}
+
+/**
+ * Imprime las llamadas de dibujo por frame y, con perfil, lo ocupado por
+ * hilo de cada equipo (ms/frame) y su ocio en las regiones medidas.
+ */
+static void prof_report(FILE *fp, uint64_t frames, uint64_t draws)
+{
+    double nf = frames > 0 ? (double)frames : 1.0;
+    fprintf(fp, "  %-8s %9.1f llamadas de dibujo/frame\n", "draws", (double)draws / nf);
+    if (!prof.on)
+        return;
+    static const char *const team_names[2] = {"main", "productor"};
+    ProfSample p;
+    prof_take(&p);
+    for (int team = 0; team < 2; ++team)
+    {
+        if (p.span[team] == 0)
+            continue;
+        double span_ms = ticks_to_seconds(p.span[team]) * 1000.0 / nf;
+        fprintf(fp, "  regiones %s: %.3f ms/frame de pared\n", team_names[team], span_ms);
+        for (int t = 0; t < p.lanes[team]; ++t)
+        {
+            double busy_ms = ticks_to_seconds(p.busy[team][t]) * 1000.0 / nf;
+            fprintf(fp, "    hilo %-3d %9.3f ms ocupado/frame, %5.1f%% ocioso\n", t, busy_ms,
+                    span_ms > 0.0 ? 100.0 * (1.0 - busy_ms / span_ms) : 0.0);
+        }
+    }
+}
+
+// ------------------------ Trabajo por hilo (--exec) ------------------------
+
+/** Acumula src en dst (ventanas del log en el total de la corrida). */
+static void work_add(ExecStats *dst, const ExecStats *src)
+{
+    for (int t = 0; t < src->lanes; ++t)
+    {
+        dst->blocks[t] += src->blocks[t];
+        dst->steals[t] += src->steals[t];
+    }
+    if (src->lanes > dst->lanes)
+        dst->lanes = src->lanes;
+}
+
+/**
+ * Máximo / media de bloques por hilo (1 = parejo; 0 sin trabajo). Con
+ * schedule(static) es 1 por construcción: ahí el desbalance es de tiempo
+ * (--overlay, --trace); con --exec steal o dynamic muestra quién hizo más.
+ */
+static double work_imbalance(const ExecStats *w)
+{
+    uint64_t sum = 0, max = 0;
+    for (int t = 0; t < w->lanes; ++t)
+    {
+        sum += w->blocks[t];
+        max = w->blocks[t] > max ? w->blocks[t] : max;
+    }
+    return sum > 0 ? (double)max * w->lanes / (double)sum : 0.0;
+}
+
+/** Columnas work_blocks (bloques por hilo separados por '|'), work_imbalance y steals del CSV. */
+static void work_csv_row(FILE *fp, const ExecStats *w)
+{
+    uint64_t steals = 0;
+    fputc(',', fp);
+    for (int t = 0; t < w->lanes; ++t)
+    {
+        fprintf(fp, t ? "|%llu" : "%llu", (unsigned long long)w->blocks[t]);
+        steals += w->steals[t];
+    }
+    fprintf(fp, ",%.3f,%llu", work_imbalance(w), (unsigned long long)steals);
+}
+
+/** Bloques y robos por hilo de toda la corrida (reporte headless). */
+static void work_report(FILE *fp, const ExecStats *w)
+{
+    if (w->lanes == 0)
+        return;
+    fprintf(fp, "  trabajo por hilo (bloques/robos), max/media %.3f:", work_imbalance(w));
+    for (int t = 0; t < w->lanes; ++t)
+        fprintf(fp, " %llu/%llu", (unsigned long long)w->blocks[t], (unsigned long long)w->steals[t]);
+    fputc('\n', fp);
+}
+
+// ------------------------ Log binario (--log-format bin) ------------------------
+
+#define BLOG_MAGIC "SSLOGv1" // 8 bytes con el NUL
+#define BLOG_RING 4096       // Registros del anillo (potencia de 2; ~68 s a 60 FPS)
+#define BLOG_IDLE_MS 4       // Espera del escritor con el anillo vacío
+
+/** Un frame del log binario: tiempos por etapa y perillas vigentes (72 bytes). */
+typedef struct
+{
+    double time_s;               // Tiempo de simulación
+    int32_t frame;               // Índice del frame
+    float fps_inst, smoothed_fps;
+    float stage_ms[STAGE_COUNT]; // ms del frame por etapa (columnas <etapa>_ms)
+    int32_t ssaa, sym, glow;
+    float render_frac, lod_budget;
+    float adapt_pred_ms;         // Predicción de --adapt 1 (0 si no corre)
+} LogRecord;
+
+/* Columna del registro: nombre, formato numpy ('<f8', '<f4', '<i4') y offset. */
+typedef struct
+{
+    const char *name, *fmt;
+    size_t off;
+} LogColumn;
+
+static const LogColumn BLOG_COLS[] = {
+    {"time_s", "<f8", offsetof(LogRecord, time_s)},
+    {"frame", "<i4", offsetof(LogRecord, frame)},
+    {"fps_inst", "<f4", offsetof(LogRecord, fps_inst)},
+    {"smoothed_fps", "<f4", offsetof(LogRecord, smoothed_fps)},
+    {"ssaa", "<i4", offsetof(LogRecord, ssaa)},
+    {"sym", "<i4", offsetof(LogRecord, sym)},
+    {"glow", "<i4", offsetof(LogRecord, glow)},
+    {"render_frac", "<f4", offsetof(LogRecord, render_frac)},
+    {"lod_budget", "<f4", offsetof(LogRecord, lod_budget)},
+    {"adapt_pred_ms", "<f4", offsetof(LogRecord, adapt_pred_ms)},
+};
+#define BLOG_NCOLS ((int)(sizeof(BLOG_COLS) / sizeof(BLOG_COLS[0])) + STAGE_COUNT)
+
+/*
+ * BinLog: anillo SPSC de LogRecord entre el hilo de render y un hilo
+ * escritor. head (solo lo avanza el productor) y tail (solo el escritor) son
+ * contadores crecientes; el productor escribe el registro, publica con
+ * barrera release y avanza head, y nunca espera: con el anillo lleno el
+ * registro se descarta y se cuenta. El escritor vuelca tramos contiguos con
+ * un fwrite y duerme BLOG_IDLE_MS si no hay nada.
+ *
+ * Archivo: cabecera (magic, bytes de cabecera y de registro, columnas con
+ * nombre/formato/offset y texto "clave=valor" con los parámetros fijos de la
+ * corrida) seguida de registros de tamaño fijo: np.fromfile con un dtype
+ * estructurado los lee sin parsear.
+ */
+typedef struct
+{
+    FILE *fp;
+    LogRecord *ring;        // BLOG_RING registros
+    SDL_atomic_t head, tail;
+    SDL_atomic_t quit;
+    SDL_atomic_t failed;    // El escritor no pudo escribir
+    SDL_Thread *thread;
+    unsigned dropped;       // Registros descartados (solo el productor)
+} BinLog;
+
+/** Hilo escritor: vacía el anillo hasta que quit se activa y no queda nada. */
+static int blog_writer(void *arg)
+{
+    BinLog *b = (BinLog *)arg;
+    for (;;)
+    {
+        int quit = SDL_AtomicGet(&b->quit); // Antes que head: lo publicado antes de quit se vuelca
+        unsigned head = (unsigned)SDL_AtomicGet(&b->head), tail = (unsigned)SDL_AtomicGet(&b->tail);
+        SDL_MemoryBarrierAcquire();
+        if (head == tail)
+        {
+            if (quit)
+                break;
+            SDL_Delay(BLOG_IDLE_MS);
+            continue;
+        }
+        unsigned k = tail & (BLOG_RING - 1), cnt = head - tail;
+        if (k + cnt > BLOG_RING)
+            cnt = BLOG_RING - k; // Hasta el final del anillo; el resto en la próxima vuelta
+        if (!SDL_AtomicGet(&b->failed) && fwrite(b->ring + k, sizeof(LogRecord), cnt, b->fp) != cnt)
+            SDL_AtomicSet(&b->failed, 1);
+        SDL_AtomicSet(&b->tail, (int)(tail + cnt));
+    }
+    return 0;
+}
+
+/** Libera el log sin esperar al escritor; acepta NULL. */
+static void blog_free(BinLog *b)
+{
+    if (!b)
+        return;
+    if (b->fp)
+        fclose(b->fp);
+    free(b->ring);
+    free(b);
+}
+
+/**
+ * Crea path, escribe la cabecera (columnas y meta) y arranca el escritor.
+ * NULL si no se puede abrir o no hay memoria/hilo.
+ */
+static BinLog *blog_open(const char *path, const char *meta)
+{
+    BinLog *b = (BinLog *)calloc(1, sizeof(BinLog));
+    if (!b)
+        return NULL;
+    b->ring = (LogRecord *)calloc(BLOG_RING, sizeof(LogRecord));
+    b->fp = fopen(path, "wb");
+    if (!b->ring || !b->fp)
+    {
+        blog_free(b);
+        return NULL;
+    }
+    // Cabecera: 24 bytes fijos + 32 por columna + meta, rellenada a 64
+    const uint32_t ncols = (uint32_t)BLOG_NCOLS, meta_bytes = (uint32_t)strlen(meta);
+    const uint32_t header_bytes = (uint32_t)((24 + 32 * ncols + meta_bytes + 63) / 64 * 64);
+    const uint32_t record_bytes = (uint32_t)sizeof(LogRecord);
+    bool ok = fwrite(BLOG_MAGIC, 8, 1, b->fp) == 1 && fwrite(&header_bytes, 4, 1, b->fp) == 1 &&
+              fwrite(&record_bytes, 4, 1, b->fp) == 1 && fwrite(&ncols, 4, 1, b->fp) == 1 &&
+              fwrite(&meta_bytes, 4, 1, b->fp) == 1;
+    for (uint32_t c = 0; c < ncols && ok; ++c)
+    {
+        char name[24] = {0}, fmt[4] = {0};
+        uint32_t off;
+        if (c < ncols - STAGE_COUNT)
+        {
+            snprintf(name, sizeof(name), "%s", BLOG_COLS[c].name);
+            memcpy(fmt, BLOG_COLS[c].fmt, 3);
+            off = (uint32_t)BLOG_COLS[c].off;
+        }
+        else
+        {
+            int st = (int)(c - (ncols - STAGE_COUNT));
+            snprintf(name, sizeof(name), "%s_ms", STAGE_NAMES[st]);
+            memcpy(fmt, "<f4", 3);
+            off = (uint32_t)(offsetof(LogRecord, stage_ms) + sizeof(float) * (size_t)st);
+        }
+        ok = fwrite(name, sizeof(name), 1, b->fp) == 1 && fwrite(fmt, sizeof(fmt), 1, b->fp) == 1 &&
+             fwrite(&off, 4, 1, b->fp) == 1;
+    }
+    ok = ok && fwrite(meta, 1, meta_bytes, b->fp) == meta_bytes;
+    for (uint32_t k = 24 + 32 * ncols + meta_bytes; k < header_bytes && ok; ++k)
+        ok = fputc(0, b->fp) != EOF;
+    SDL_AtomicSet(&b->head, 0);
+    SDL_AtomicSet(&b->tail, 0);
+    SDL_AtomicSet(&b->quit, 0);
+    SDL_AtomicSet(&b->failed, 0);
+    if (ok)
+        b->thread = SDL_CreateThread(blog_writer, "binlog", b);
+    if (!b->thread)
+    {
+        blog_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+/** Encola un registro sin bloquear (anillo lleno => se descarta). */
+static void blog_push(BinLog *b, const LogRecord *r)
+{
+    unsigned head = (unsigned)SDL_AtomicGet(&b->head), tail = (unsigned)SDL_AtomicGet(&b->tail);
+    if (head - tail >= BLOG_RING)
+    {
+        b->dropped++;
+        return;
+    }
+    b->ring[head & (BLOG_RING - 1)] = *r;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&b->head, (int)(head + 1));
+}
+
+/** Vacía el anillo, detiene el escritor, informa descartes/errores y libera. false si falló la escritura. */
+static bool blog_close(BinLog *b)
+{
+    if (!b)
+        return true;
+    SDL_AtomicSet(&b->quit, 1);
+    SDL_WaitThread(b->thread, NULL);
+    if (b->dropped)
+        fprintf(stderr, "Log binario: %u registros descartados (anillo lleno)\n", b->dropped);
+    bool ok = !SDL_AtomicGet(&b->failed);
+    ok = (fclose(b->fp) == 0) && ok;
+    b->fp = NULL;
+    blog_free(b);
+    return ok;
+}
+
+// ------------------------ Equipo OpenMP ------------------------
+
+/*
+ * Los bucles por bloques de SIM_BLOCK partículas (física, pre-cálculo, primera
+ * escritura y expansión a vértices) usan schedule(runtime): la política sale
+ * de omp_set_schedule, fijada una sola vez por team_setup. El tamaño del
+ * equipo tampoco cambia por frame, así que el runtime reutiliza los mismos
+ * hilos (y su afinidad) en cada región.
+ */
+
+#if defined(_OPENMP) && defined(__linux__)
+static int team_cpus[CPU_SETSIZE]; // CPUs permitidas al proceso antes de fijar afinidades
+static int team_ncpu = -1;         // -1 = sin leer todavía
+
+/**
+ * Fija la afinidad de los hilos del equipo `team` (de `teams`) a su tramo
+ * contiguo de las CPUs permitidas al proceso (leídas una vez, en la primera
+ * llamada de main antes de crear hilos): main, productor de --pipeline y
+ * vistas de --outputs no comparten CPUs. close = CPUs consecutivas del tramo,
+ * spread = repartidas en él. El hilo que llama (tid 0) no se fija: conserva la
+ * máscara del proceso y los hilos que cree después (productor, vistas,
+ * codificador, escritor del log) la heredan entera. Si OMP_PROC_BIND está
+ * definido se respeta el runtime. Retorna cuántos hilos quedaron fijados.
+ */
+static int team_bind(BindPolicy bind, int team, int teams)
+{
+    if (team_ncpu < 0)
+    {
+        cpu_set_t allowed;
+        team_ncpu = 0;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed))
+                    team_cpus[team_ncpu++] = c;
+    }
+    if (bind == BIND_NONE || getenv("OMP_PROC_BIND") || team_ncpu == 0)
+        return 0;
+    // Tramo del equipo; con más equipos que CPUs, una CPU por equipo (en ronda)
+    const int per = team_ncpu / teams;
+    const int first = per > 0 ? team * per : team % team_ncpu;
+    const int ncpu = per > 0 ? (team == teams - 1 ? team_ncpu - first : per) : 1;
+    const int *cpus = team_cpus + first;
+    int bound = 0;
+#pragma omp parallel reduction(+ : bound)
+    {
+        int tid = omp_get_thread_num(), nth = omp_get_num_threads();
+        if (tid > 0)
+        {
+            int slot = bind == BIND_SPREAD && nth < ncpu ? (int)((long long)tid * ncpu / nth) : tid % ncpu;
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpus[slot], &one);
+            bound += sched_setaffinity(0, sizeof(one), &one) == 0;
+        }
+    }
+    return bound;
+}
+
+/** Equipos OpenMP de la corrida: main, el productor de --pipeline y uno por vista extra de --outputs. */
+static int team_count(const Config *cfg)
+{
+    return 1 + (cfg->pipeline ? 1 : 0) + (cfg->outputs - 1);
+}
+#endif
+
+/**
+ * Configura el equipo OpenMP del hilo que llama: número de hilos, política
+ * de reparto (--schedule/--chunk) y afinidad (--bind) sobre el tramo de CPUs
+ * del equipo `team` (0 = main, 1 = productor, luego las vistas; de
+ * team_count). Son ICV por hilo, así que main, el productor del pipeline y
+ * cada vista la llaman una vez al arrancar; main primero. Retorna los hilos
+ * fijados a una CPU (0 si no hubo afinidad).
+ */
+static int team_setup(const Config *cfg, int threads, int team)
+{
+#ifdef _OPENMP
+    static const omp_sched_t kinds[SCHED_COUNT] = {omp_sched_static, omp_sched_dynamic, omp_sched_guided};
+    omp_set_num_threads(threads);
+    omp_set_schedule(kinds[cfg->schedule], cfg->chunk); // chunk < 1 => default del runtime
+#if defined(__linux__)
+    return team_bind(cfg->bind, team, team_count(cfg));
+#else
+    (void)team;
+    return 0;
+#endif
+#else
+    (void)cfg;
+    (void)threads;
+    (void)team;
+    return 0;
+#endif
+}
+
+// ------------------------ Arena de partículas ------------------------
+
+/* Atractores, orbitadores, su inicialización y la física viven en mandala_core. */
+
+#define ARENA_HUGE_PAGE ((size_t)2 << 20) // Página grande típica (THP x86-64/ARM64)
+
+/*
+ * ParticleArena: un solo bloque para todos los arreglos por partícula (los
+ * campos SoA de Orbiters y el Precomp del frame), repartido por arena_push en
+ * trozos alineados a ORB_ALIGN. En POSIX se reserva con mmap: las páginas
+ * quedan sin tocar (y en cero) hasta la primera escritura, y Linux las asigna
+ * al nodo NUMA del hilo que las escribe primero. Con huge=1 el bloque se
+ * alinea a 2 MB y se marca con madvise(MADV_HUGEPAGE) para reducir fallos de
+ * TLB con N grande. Sin mmap (Windows) se usa memoria alineada del heap.
+ */
+typedef struct
+{
+    unsigned char *base; // Inicio alineado del bloque
+    size_t size, used;   // Capacidad / bytes ya repartidos
+    void *map;           // Mapeo original (munmap) o bloque del heap
+    size_t map_size;
+    int mapped;          // 1 = mmap, 0 = heap
+    int huge;            // 1 = se pidió MADV_HUGEPAGE con éxito
+} ParticleArena;
+
+/** Bytes que ocupa un trozo de arena_push (redondeado a ORB_ALIGN). */
+static size_t arena_chunk(size_t bytes)
+{
+    return (bytes + ORB_ALIGN - 1) / ORB_ALIGN * ORB_ALIGN;
+}
+
+/** Reserva la arena de `bytes` bytes; huge pide páginas grandes. false si no hay memoria. */
+static bool arena_create(ParticleArena *a, size_t bytes, bool huge)
+{
+    memset(a, 0, sizeof(*a));
+    bytes = arena_chunk(bytes);
+#if !defined(_WIN32)
+    size_t extra = huge ? ARENA_HUGE_PAGE : 0; // Holgura para alinear a página grande
+    void *m = mmap(NULL, bytes + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m != MAP_FAILED)
+    {
+        uintptr_t b = (uintptr_t)m;
+        if (huge)
+            b = (b + ARENA_HUGE_PAGE - 1) & ~(uintptr_t)(ARENA_HUGE_PAGE - 1);
+        a->map = m;
+        a->map_size = bytes + extra;
+        a->mapped = 1;
+        a->base = (unsigned char *)b;
+        a->size = bytes;
+#ifdef MADV_HUGEPAGE
+        if (huge)
+            a->huge = madvise(a->base, bytes, MADV_HUGEPAGE) == 0;
+#endif
+        return true;
+    }
+#else
+    (void)huge;
+#endif
+#if defined(_WIN32)
+    a->map = _aligned_malloc(bytes, ORB_ALIGN);
+#else
+    a->map = aligned_alloc(ORB_ALIGN, bytes);
+#endif
+    if (!a->map)
+        return false;
+    a->base = (unsigned char *)a->map;
+    a->size = bytes;
+    return true;
+}
+
+/** Trozo de `bytes` alineado a ORB_ALIGN, sin inicializar; NULL si no cabe. */
+static void *arena_push(ParticleArena *a, size_t bytes)
+{
+    bytes = arena_chunk(bytes);
+    if (bytes > a->size - a->used)
+        return NULL;
+    void *p = a->base + a->used;
+    a->used += bytes;
+    return p;
+}
+
+/** Libera la arena completa (todos sus trozos); acepta una arena vacía. */
+static void arena_destroy(ParticleArena *a)
+{
+    if (!a->map)
+        return;
+#if !defined(_WIN32)
+    if (a->mapped)
+        munmap(a->map, a->map_size);
+    else
+        free(a->map);
+#else
+    _aligned_free(a->map);
+#endif
+    memset(a, 0, sizeof(*a));
+}
+
+/**
+ * Reparte los arreglos SoA para n partículas desde la arena, sin tocarlos:
+ * init_orbiters hace la primera escritura (incluido el relleno) en paralelo.
+ * Retorna false si la arena no alcanza.
+ */
+static bool orbiters_alloc(Orbiters *o, int n, ParticleArena *arena)
+{
+    void *mem = arena_push(arena, orbiters_bytes(n));
+    if (!mem)
+        return false;
+    orbiters_bind(o, n, mem);
+    return true;
+}
+
+// ------------------------ Rejilla uniforme (CellBins) ------------------------
+
+/*
+ * CellBins: índice de ítems por celda de una rejilla uniforme gx x gy. Tras
+ * cell_bins_build, items[start[c] .. start[c+1]) son los ítems que tocan la
+ * celda c (índice fila-mayor), en orden creciente de ítem. Lo usan la
+ * interacción entre partículas (ParticleGrid) y el binning por tiles del
+ * rasterizador por CPU.
+ */
+typedef struct
+{
+    int gx, gy;       // Celdas por eje
+    int *start;       // gx * gy + 1 offsets en items
+    int *counts;      // hilos * celdas: conteo y luego cursor de cada hilo
+    int counts_cap;   // Enteros reservados en counts
+    Uint32 *items;    // Ítems ordenados por celda
+    size_t items_cap;
+} CellBins;
+
+/** Celdas [c0x..c1x] x [c0y..c1y] que toca el ítem; false si no toca ninguna. */
+typedef bool (*CellRangeFn)(const void *ctx, int item, int *c0x, int *c1x, int *c0y, int *c1y);
+
+/** Libera los arreglos de b (tolera arreglos NULL). */
+static void cell_bins_free(CellBins *b)
+{
+    free(b->start);
+    free(b->counts);
+    free(b->items);
+    memset(b, 0, sizeof(*b));
+}
+
+/** Fija la rejilla en gx x gy celdas (vacías). false si no hay memoria. */
+static bool cell_bins_resize(CellBins *b, int gx, int gy)
+{
+    if (b->start && b->gx == gx && b->gy == gy)
+        return true;
+    free(b->start);
+    b->gx = gx;
+    b->gy = gy;
+    b->start = (int *)calloc((size_t)gx * gy + 1, sizeof(int));
+    return b->start != NULL;
+}
+
+/**
+ * Reparte nitems ítems en celdas con counting sort estable: cada hilo cuenta
+ * su rango contiguo de ítems, un prefijo (hilo-mayor dentro de cada celda) da
+ * los cursores y cada hilo escribe sus ítems sin locks. El orden dentro de
+ * cada celda no depende del número de hilos. Si no hay memoria para los
+ * ítems deja todas las celdas vacías y retorna false. FAST_INLINE: con range
+ * constante en la llamada, el compilador resuelve la llamada indirecta.
+ */
+FAST_INLINE bool cell_bins_build(CellBins *b, int nitems, CellRangeFn range, const void *ctx)
+{
+    const int ncells = b->gx * b->gy;
+    int maxth = 1;
+#ifdef _OPENMP
+    maxth = omp_get_max_threads();
+#endif
+    if (b->counts_cap < maxth * ncells)
+    {
+        int *c = (int *)realloc(b->counts, sizeof(int) * (size_t)maxth * ncells);
+        if (!c)
+        {
+            memset(b->start, 0, sizeof(int) * ((size_t)ncells + 1));
+            return false;
+        }
+        b->counts = c;
+        b->counts_cap = maxth * ncells;
+    }
+    bool ok = true;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        int tid = 0, nth = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nth = omp_get_num_threads();
+#endif
+        int s0 = (int)((long long)nitems * tid / nth), s1 = (int)((long long)nitems * (tid + 1) / nth);
+        int *cnt = b->counts + (size_t)tid * ncells;
+        memset(cnt, 0, sizeof(int) * (size_t)ncells);
+        int c0x, c1x, c0y, c1y;
+        for (int s = s0; s < s1; ++s)
+            if (range(ctx, s, &c0x, &c1x, &c0y, &c1y))
+                for (int cy = c0y; cy <= c1y; ++cy)
+                    for (int cx = c0x; cx <= c1x; ++cx)
+                        cnt[cy * b->gx + cx]++;
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            size_t total = 0;
+            for (int c = 0; c < ncells; ++c)
+            {
+                b->start[c] = (int)total;
+                for (int h = 0; h < nth; ++h)
+                {
+                    int k = b->counts[(size_t)h * ncells + c];
+                    b->counts[(size_t)h * ncells + c] = (int)total;
+                    total += (size_t)k;
+                }
+            }
+            b->start[ncells] = (int)total;
+            if (total > b->items_cap)
+            {
+                Uint32 *it = (Uint32 *)realloc(b->items, sizeof(Uint32) * total);
+                if (it)
+                {
+                    b->items = it;
+                    b->items_cap = total;
+                }
+                else
+                {
+                    memset(b->start, 0, sizeof(int) * ((size_t)ncells + 1));
+                    ok = false;
+                }
+            }
+        }
+        if (ok)
+        {
+            for (int s = s0; s < s1; ++s)
+                if (range(ctx, s, &c0x, &c1x, &c0y, &c1y))
+                    for (int cy = c0y; cy <= c1y; ++cy)
+                        for (int cx = c0x; cx <= c1x; ++cx)
+                            b->items[cnt[cy * b->gx + cx]++] = (Uint32)s;
+        }
+    }
+    return ok;
+}
+
+/*
+ * ParticleGrid: rejilla de celdas de lado R (radio de interacción) sobre el
+ * mundo W x H, reconstruida cada frame. Cada partícula cae en una sola celda
+ * (las de fuera del mundo se acotan al borde, lo que conserva la vecindad
+ * 3x3) y sx/sy guardan las posiciones en el orden de items, así los vecinos
+ * de una fila de celdas se leen como un tramo contiguo.
+ */
+typedef struct
+{
+    CellBins bins;
+    const Orbiters *o; // Partículas del frame en construcción
+    float R, invR;     // Radio de interacción y su inverso
+    float *sx, *sy;    // Posiciones ordenadas por celda (n)
+} ParticleGrid;
+
+/** Celda acotada de la coordenada v (NaN => 0). */
+static inline int grid_coord(float v, float invR, int g)
+{
+    float c = v * invR;
+    if (!(c >= 0.0f))
+        return 0;
+    return c >= (float)(g - 1) ? g - 1 : (int)c;
+}
+
+/** CellRangeFn de ParticleGrid: la celda única de la partícula i. */
+static inline bool grid_cell_range(const void *ctx, int i, int *c0x, int *c1x, int *c0y, int *c1y)
+{
+    const ParticleGrid *g = (const ParticleGrid *)ctx;
+    *c0x = *c1x = grid_coord(g->o->x[i], g->invR, g->bins.gx);
+    *c0y = *c1y = grid_coord(g->o->y[i], g->invR, g->bins.gy);
+    return true;
+}
+
+/** Libera la rejilla; acepta NULL. */
+static void grid_free(ParticleGrid *g)
+{
+    if (!g)
+        return;
+    cell_bins_free(&g->bins);
+    free(g->sx);
+    free(g->sy);
+    free(g);
+}
+
+/** Crea la rejilla para n partículas en un mundo W x H con radio R; NULL si falta memoria. */
+static ParticleGrid *grid_create(int W, int H, float R, int n)
+{
+    ParticleGrid *g = (ParticleGrid *)calloc(1, sizeof(ParticleGrid));
+    if (!g)
+        return NULL;
+    g->R = R;
+    g->invR = 1.0f / R;
+    g->sx = (float *)malloc(sizeof(float) * (size_t)n);
+    g->sy = (float *)malloc(sizeof(float) * (size_t)n);
+    if (!g->sx || !g->sy || !cell_bins_resize(&g->bins, (int)ceilf(W * g->invR), (int)ceilf(H * g->invR)))
+    {
+        grid_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+/**
+ * Repulsión/cohesión de corto alcance entre partículas: para d < R el
+ * perfil K·(1-q)·(1-2q), q = d/R, empuja para q < 1/2 y atrae para q > 1/2
+ * (cero en el contacto de equilibrio y en R). Suma la aceleración a vx/vy
+ * antes de integrar. Reconstruye la rejilla, copia posiciones en orden de
+ * celda y recorre por filas de celdas: las 3 celdas vecinas de cada fila
+ * son un tramo contiguo de sx/sy, así que solo se visitan 3 tramos por
+ * partícula en vez de N. Las sumas siguen el orden de items, independiente
+ * del número de hilos. false si no hubo memoria (el frame no interactúa).
+ */
+static bool interact_particles(ParticleGrid *g, Orbiters *o, float K, float dt)
+{
+    g->o = o;
+    if (!cell_bins_build(&g->bins, o->n, grid_cell_range, g))
+        return false;
+    const Uint32 *restrict items = g->bins.items;
+    const int *start = g->bins.start;
+    const int gx = g->bins.gx, gy = g->bins.gy;
+    float *restrict sx = g->sx, *restrict sy = g->sy;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < o->n; ++k)
+    {
+        sx[k] = o->x[items[k]];
+        sy[k] = o->y[items[k]];
+    }
+    const float R2 = g->R * g->R, invR = g->invR, Kdt = K * dt;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int cy = 0; cy < gy; ++cy)
+    {
+        int ry0 = cy > 0 ? cy - 1 : 0, ry1 = cy < gy - 1 ? cy + 1 : gy - 1;
+        for (int cx = 0; cx < gx; ++cx)
+        {
+            int cx0 = cx > 0 ? cx - 1 : 0, cx1 = cx < gx - 1 ? cx + 1 : gx - 1;
+            for (int a = start[cy * gx + cx]; a < start[cy * gx + cx + 1]; ++a)
+            {
+                const float xi = sx[a], yi = sy[a];
+                float fx = 0.0f, fy = 0.0f;
+                for (int ry = ry0; ry <= ry1; ++ry)
+                {
+                    int b0 = start[ry * gx + cx0], b1 = start[ry * gx + cx1 + 1];
+#ifdef _OPENMP
+#pragma omp simd reduction(+ : fx, fy)
+#endif
+                    for (int b = b0; b < b1; ++b)
+                    {
+                        float dx = xi - sx[b], dy = yi - sy[b];
+                        float d2 = dx * dx + dy * dy;
+                        float d = sqrtf(d2);
+                        float q = d * invR;
+                        // d2 == 0 descarta la propia partícula (y solapes exactos)
+                        float f = (d2 < R2 && d2 > 0.0f) ? (1.0f - q) * (1.0f - 2.0f * q) / d : 0.0f;
+                        fx += f * dx;
+                        fy += f * dy;
+                    }
+                }
+                const Uint32 i = items[a];
+                o->vx[i] += Kdt * fx;
+                o->vy[i] += Kdt * fy;
+            }
+        }
+    }
+    return true;
+}
+
+// ------------------------ Paletas y colores ------------------------
+
+/**
+ * PaletteDesc: todo lo que depende de la paleta. particle_hsv se usa en la
+ * ruta escalar; [sat_lo, sat_hi] y val acotan lo que puede producir para
+ * construir la ColorLUT; attr_hue es el tono base de los atractores.
+ */
+typedef struct
+{
+    const char *name;
+    ParticleHsvFn particle_hsv;
+    float sat_lo, sat_hi; // Rango de sat antes de sat_mul
+    float val;            // Brillo constante de la paleta
+    float attr_hue;       // Tono base de atractores
+} PaletteDesc;
+
+static const PaletteDesc PALETTES[PALETTE_COUNT] = {
+    {"neon", neon_particle_hsv, 0.85f, 0.85f, 1.00f, 0.0f},
+    {"ocean", ocean_particle_hsv, 0.45f, 0.85f, 0.95f, 190.0f},
+};
+
+/** Color de atractores según paleta (neon/ocean) con leve modulación temporal. */
+static void palette_attractor_color(PaletteId pal, int k, float t, Uint8 *r, Uint8 *g, Uint8 *b)
+{
+    float hue = PALETTES[pal].attr_hue + 20.0f * k + 10.0f * sinf(0.37f * t + k);
     hsv2rgb(fmodf(hue, 360.0f), 0.40f, 0.90f, r, g, b);
 }
 
-/** Tinte de fondo por paleta + alpha de “fade” para arrastre global. */
-static RGBA palette_bg_tint(const Config *cfg, float t)
+/** Tinte de fondo por paleta + alpha de “fade” para arrastre global. */
+static RGBA palette_bg_tint(const Config *cfg, float t)
+{
+    Uint8 r = 0, g = 0, b = 0, a = (Uint8)cfg->bg_alpha;
+    if (cfg->palette_id == PALETTE_OCEAN)
+        hsv2rgb(210.0f + 6.0f * sinf(0.10f * t), 0.25f, 0.16f, &r, &g, &b);
+    else
+        hsv2rgb(200.0f, 0.10f, 0.14f, &r, &g, &b);
+    RGBA out = {r, g, b, a};
+    return out;
+}
+
+/*
+ * ColorLUT: tabla hue→RGB de la paleta activa, construida una vez al inicio
+ * (sat_mul y val son constantes durante la corrida). LUT_HUES tonos por
+ * vuelta y hasta LUT_SAT_BUCKETS cubetas de saturación sobre el rango que la
+ * paleta puede producir (neon usa 1). Cada entrada empaqueta r | g<<8 | b<<16.
+ * Error de cuantización: < 0.5 niveles por tono y ≤ 2 por saturación.
+ */
+#define LUT_HUES 4096 // Potencia de 2: el índice envuelve con & (LUT_HUES-1)
+#define LUT_SAT_BUCKETS 32
+
+typedef struct
+{
+    Uint32 rgb[LUT_SAT_BUCKETS * LUT_HUES];
+    float sat_lo;    // Saturación (ya con sat_mul) de la cubeta 0
+    float sat_scale; // Cubetas por unidad de saturación
+    int buckets;     // Cubetas usadas [1..LUT_SAT_BUCKETS]
+} ColorLUT;
+
+/** Satura x a [0,1]. */
+static float clamp01(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+
+/** Construye la tabla de cfg->palette_id; NULL si falla la reserva. */
+static ColorLUT *color_lut_create(const Config *cfg)
+{
+    ColorLUT *lut = (ColorLUT *)malloc(sizeof(ColorLUT));
+    if (!lut)
+        return NULL;
+    const PaletteDesc *pd = &PALETTES[cfg->palette_id];
+    float lo = clamp01(pd->sat_lo * cfg->sat_mul), hi = clamp01(pd->sat_hi * cfg->sat_mul);
+    lut->buckets = hi > lo ? LUT_SAT_BUCKETS : 1;
+    lut->sat_lo = lo;
+    lut->sat_scale = hi > lo ? (float)(LUT_SAT_BUCKETS - 1) / (hi - lo) : 0.0f;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int sb = 0; sb < lut->buckets; ++sb)
+    {
+        float sat = lut->buckets > 1 ? lo + (float)sb / lut->sat_scale : lo;
+        for (int j = 0; j < LUT_HUES; ++j)
+        {
+            Uint8 r, g, b;
+            hsv2rgb(((float)j + 0.5f) * (360.0f / LUT_HUES), sat, pd->val, &r, &g, &b);
+            lut->rgb[sb * LUT_HUES + j] = (Uint32)r | ((Uint32)g << 8) | ((Uint32)b << 16);
+        }
+    }
+    return lut;
+}
+
+/**
+ * Índice/color de (hue, sat) con sat ya multiplicada y saturada.
+ * hue en (-360, 360): se desplaza una vuelta y envuelve con máscara, sin ramas.
+ * lut_index recibe los campos sueltos para que los bucles simd los fijen fuera.
+ */
+static inline Uint32 lut_index(float hue, float sat, float sat_lo, float sat_scale, float smax)
+{
+    int hi = (int)((hue + 360.0f) * (LUT_HUES / 360.0f)) & (LUT_HUES - 1);
+    float sf = (sat - sat_lo) * sat_scale + 0.5f; // Clamp en float: min/max enteros piden SSE4.1
+    int si = (int)(sf < 0.0f ? 0.0f : (sf > smax ? smax : sf));
+    return (Uint32)(si * LUT_HUES + hi);
+}
+
+static inline Uint32 color_lut_lookup(const ColorLUT *lut, float hue, float sat)
+{
+    return lut->rgb[lut_index(hue, sat, lut->sat_lo, lut->sat_scale, (float)(lut->buckets - 1))];
+}
+
+/**
+ * Color de partícula por paleta con control de saturación global.
+ * Con lut != NULL sustituye hsv2rgb por color_lut_lookup.
+ */
+static void particle_color(const Config *cfg, const ColorLUT *lut, int i, float t, Uint8 *r, Uint8 *g, Uint8 *b)
+{
+    float hue, sat, val;
+    PALETTES[cfg->palette_id].particle_hsv(i, t, &hue, &sat, &val);
+    sat = clamp01(sat * cfg->sat_mul);
+    if (lut)
+    {
+        Uint32 c = color_lut_lookup(lut, hue, sat);
+        *r = (Uint8)(c & 0xFF);
+        *g = (Uint8)((c >> 8) & 0xFF);
+        *b = (Uint8)((c >> 16) & 0xFF);
+        return;
+    }
+    hsv2rgb(hue, sat, val, r, g, b);
+}
+
+/**
+ * Parte de --self-test: para cada paleta (con el sat_mul de cfg) compara
+ * particle_color con y sin ColorLUT sobre muestras (i, t). Cota: 2 niveles.
+ */
+static int color_lut_self_test(const Config *cfg)
+{
+    int fails = 0;
+    for (int p = 0; p < PALETTE_COUNT; ++p)
+    {
+        Config c = *cfg;
+        c.palette_id = (PaletteId)p;
+        ColorLUT *lut = color_lut_create(&c);
+        if (!lut)
+            return 1;
+        int emax = 0;
+        for (int i = 0; i < 20000; ++i)
+            for (int k = 0; k < 16; ++k)
+            {
+                float t = 0.37f * (float)k + 0.001f * (float)i;
+                Uint8 r0, g0, b0, r1, g1, b1;
+                particle_color(&c, NULL, i, t, &r0, &g0, &b0);
+                particle_color(&c, lut, i, t, &r1, &g1, &b1);
+                int d[3] = {abs(r0 - r1), abs(g0 - g1), abs(b0 - b1)};
+                for (int ch = 0; ch < 3; ++ch)
+                    if (d[ch] > emax)
+                        emax = d[ch];
+            }
+        free(lut);
+        bool ok = emax <= 2;
+        fails += ok ? 0 : 1;
+        printf("color-lut %s: max|dif|=%d niveles (cota 2) %s\n", PALETTES[p].name, emax, ok ? "OK" : "FALLA");
+    }
+    return fails ? 1 : 0;
+}
+
+// ------------------------ Pre-cálculo para dibujo ------------------------
+
+/**
+ * Precomp: datos precomputados por partícula para reducir trabajo en el bucle
+ * de dibujo. Incluye:
+ *   - deltas relativos al centro (actual y previo),
+ *   - radio del punto (pr),
+ *   - color actual (r,g,b).
+ * Los splats de densidad de --lod 1 reutilizan el struct (radio LOD_SPLAT_R,
+ * w = partículas que agrega). Se reescribe entero cada frame: por defecto
+ * ocupa 12 bytes (deltas int16 en 1/PC_FIX px, color y radio en una palabra);
+ * -DPRECOMP_FLOAT vuelve a los 24 bytes en floats para comparar. Escritura y
+ * lectura pasan siempre por pc_store / pc_store_splat / pc_load.
+ */
+#ifdef PRECOMP_FLOAT
+typedef struct
+{
+    float dx0, dy0, dxp, dyp; // Pos actuales y previas relativas al centro
+    int pr;                   // Radio de punto [1..3]
+    Uint8 r, g, b;            // Color actual
+    Uint8 w;                  // Splat de --lod 1: partículas agregadas (saturado a 255); 0 en partículas
+} Precomp;
+
+#define PC_WORLD_W_MAX INT_MAX // Sin tope de ancho de mundo
+#else
+#define PC_FIX 8.0f          // Deltas en 1/8 px: ±4096 px desde el centro (sobra para 8K con HiDPI)
+#define PC_WORLD_W_MAX 8192  // Ancho de mundo que cubren los deltas (2·32767/PC_FIX px)
+
+typedef struct
+{
+    Sint16 dx0, dy0, dxp, dyp; // Pos actuales y previas relativas al centro (1/PC_FIX px)
+    Uint32 rgbp;               // r | g<<8 | b<<16 | pr<<24 (splat: w en vez de pr)
+} Precomp;
+
+/** Delta en px a int16 de punto fijo, redondeado y saturado (sin ramas, vectorizable). */
+static inline Sint16 pc_fix(float v)
+{
+    float q = v * PC_FIX;
+    q = q < -32767.0f ? -32767.0f : (q > 32767.0f ? 32767.0f : q);
+    return (Sint16)((int)(q + 32768.5f) - 32768); // Positivo: truncar = floor
+}
+#endif
+
+/* Precomp decodificado para las etapas de dibujo. */
+typedef struct
+{
+    float dx0, dy0, dxp, dyp;
+    int pr;        // Radio (partículas; en splats usar LOD_SPLAT_R)
+    Uint8 r, g, b;
+    Uint8 w;       // Partículas agregadas (solo splats)
+} PcVals;
+
+/** Escribe una partícula: deltas en px, radio [1..3] y color rgb = r | g<<8 | b<<16. */
+static inline void pc_store(Precomp *p, float dx0, float dy0, float dxp, float dyp, int pr, Uint32 rgb)
+{
+#ifdef PRECOMP_FLOAT
+    p->dx0 = dx0;
+    p->dy0 = dy0;
+    p->dxp = dxp;
+    p->dyp = dyp;
+    p->pr = pr;
+    p->r = (Uint8)(rgb & 0xFF);
+    p->g = (Uint8)((rgb >> 8) & 0xFF);
+    p->b = (Uint8)((rgb >> 16) & 0xFF);
+#else
+    p->dx0 = pc_fix(dx0);
+    p->dy0 = pc_fix(dy0);
+    p->dxp = pc_fix(dxp);
+    p->dyp = pc_fix(dyp);
+    p->rgbp = (rgb & 0xFFFFFFu) | ((Uint32)pr << 24);
+#endif
+}
+
+/** Escribe un splat de --lod 1 en (dx, dy) que agrega w partículas. */
+static inline void pc_store_splat(Precomp *p, float dx, float dy, Uint32 rgb, int w)
+{
+    const Uint8 wq = (Uint8)(w < 255 ? w : 255);
+#ifdef PRECOMP_FLOAT
+    pc_store(p, dx, dy, dx, dy, 0, rgb);
+    p->w = wq;
+#else
+    pc_store(p, dx, dy, dx, dy, wq, rgb);
+#endif
+}
+
+/** Lee un Precomp (deltas en px). */
+static inline PcVals pc_load(const Precomp *p)
+{
+    PcVals v;
+#ifdef PRECOMP_FLOAT
+    v.dx0 = p->dx0;
+    v.dy0 = p->dy0;
+    v.dxp = p->dxp;
+    v.dyp = p->dyp;
+    v.pr = p->pr;
+    v.r = p->r;
+    v.g = p->g;
+    v.b = p->b;
+    v.w = p->w;
+#else
+    const float k = 1.0f / PC_FIX;
+    v.dx0 = (float)p->dx0 * k;
+    v.dy0 = (float)p->dy0 * k;
+    v.dxp = (float)p->dxp * k;
+    v.dyp = (float)p->dyp * k;
+    v.pr = (int)(p->rgbp >> 24);
+    v.r = (Uint8)(p->rgbp & 0xFF);
+    v.g = (Uint8)((p->rgbp >> 8) & 0xFF);
+    v.b = (Uint8)((p->rgbp >> 16) & 0xFF);
+    v.w = (Uint8)v.pr;
+#endif
+    return v;
+}
+
+static void precomp_zero_range(void *ctx, int i0, int i1)
+{
+    memset((Precomp *)ctx + i0, 0, sizeof(Precomp) * (size_t)(i1 - i0));
+}
+
+/**
+ * Primera escritura de pc[0..n) con el mismo reparto por bloques que
+ * precalc_particles, para que cada página de la arena quede en el nodo del
+ * hilo que la reescribe en cada frame.
+ */
+static void precomp_first_touch(const Executor *ex, Precomp *pc, int n)
+{
+    ex->for_blocks(n, SIM_BLOCK, precomp_zero_range, pc);
+}
+
+/** Adelanto de firma: expansión a vértices (sección de lotes de geometría). */
+typedef struct SpriteBatch SpriteBatch;
+static void batch_emit_range(SpriteBatch *b, const Precomp *pc, int i0, int i1, int jbase);
+
+/**
+ * Variante vectorizable de precalc_range para --fast-math 1|2: misma fórmula
+ * de tamaño y de color de particle_color, pero con fast_sinf, fast_fmodf,
+ * redondeo por (int)(x+0.5) (x>0) y color por color_lut_lookup (use_lut) o
+ * hsv2rgb_branchless, sin ramas por partícula.
+ */
+FAST_INLINE void precalc_range_fast(const Config *cfg, const ColorLUT *lut, const Orbiters *o, float t, float cx, float cy, Precomp *out,
+                                    int i0, int i1, const int fm, const bool ocean, const bool use_lut)
+{
+    const float ps = cfg->point_scale, sat_mul = cfg->sat_mul;
+    const float *restrict x = o->x, *restrict y = o->y, *restrict px = o->px, *restrict py = o->py;
+    const float *restrict vx = o->vx, *restrict vy = o->vy;
+    const float *restrict sb = o->size_base, *restrict sa = o->size_amp;
+    const float *restrict ss = o->size_speed, *restrict sp = o->size_phase;
+    // Campos de la tabla en locales: las escrituras Uint8 en out podrían aliasarlos
+    const Uint32 *restrict lrgb = use_lut ? lut->rgb : NULL;
+    const float lsat_lo = use_lut ? lut->sat_lo : 0.0f, lsat_scale = use_lut ? lut->sat_scale : 0.0f;
+    const float lsmax = use_lut ? (float)(lut->buckets - 1) : 0.0f;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (int i = i0; i < i1; ++i)
+    {
+        float spd = sqrtf(vx[i] * vx[i] + vy[i] * vy[i]);
+        float breath = 0.5f + 0.5f * fast_sinf(ss[i] * t + sp[i], fm);
+        float prf = sb[i] * ps + sa[i] * ps * breath + vminf(2.0f, spd * 0.015f) + 0.5f;
+        int pr = (int)vminf(3.0f, vmaxf(1.0f, prf)); // prf > 0: truncar = floor
+        float fi = (float)i, hue, sat, val;
+        if (ocean)
+        {
+            hue = 180.0f + fast_fmodf(fi * 3.5f + 18.0f * fast_sinf(0.21f * t + fi * 0.05f, fm), 40.0f);
+            sat = 0.65f + 0.20f * fast_sinf(0.13f * t + fi * 0.09f, fm);
+            val = 0.95f;
+        }
+        else
+        {
+            hue = fast_fmodf(fi * 137.508f + 90.0f * fast_sinf(0.23f * t + fi * 0.031f, fm), 360.0f);
+            hue += hue < 0.0f ? 360.0f : 0.0f;
+            sat = 0.85f;
+            val = 1.00f;
+        }
+        sat = vminf(1.0f, vmaxf(0.0f, sat * sat_mul));
+        Uint32 c;
+        if (use_lut)
+        {
+            c = lrgb[lut_index(hue, sat, lsat_lo, lsat_scale, lsmax)];
+        }
+        else
+        {
+            float r, g, b;
+            hsv2rgb_branchless(hue, sat, val, &r, &g, &b);
+            c = (Uint32)unit_to_u8(r) | ((Uint32)unit_to_u8(g) << 8) | ((Uint32)unit_to_u8(b) << 16);
+        }
+        pc_store(&out[i], x[i] - cx, y[i] - cy, px[i] - cx, py[i] - cy, pr, c);
+    }
+}
+
+/** Despacha paleta y tabla como constantes para un modo fm dado. */
+FAST_INLINE void precalc_range_fast_mode(const Config *cfg, const ColorLUT *lut, const Orbiters *o, float t, float cx, float cy, Precomp *out,
+                                         int i0, int i1, const int fm)
+{
+    bool ocean = cfg->palette_id == PALETTE_OCEAN;
+    if (lut && ocean)
+        precalc_range_fast(cfg, lut, o, t, cx, cy, out, i0, i1, fm, true, true);
+    else if (lut)
+        precalc_range_fast(cfg, lut, o, t, cx, cy, out, i0, i1, fm, false, true);
+    else if (ocean)
+        precalc_range_fast(cfg, lut, o, t, cx, cy, out, i0, i1, fm, true, false);
+    else
+        precalc_range_fast(cfg, lut, o, t, cx, cy, out, i0, i1, fm, false, false);
+}
+
+/**
+ * Precalcula deltas, radios y colores de las partículas [i0,i1).
+ * lut != NULL: color por tabla (--color-lut 1); NULL: HSV por partícula.
+ */
+static void precalc_range(const Config *cfg, const ColorLUT *lut, const Orbiters *o, float t, float cx, float cy, Precomp *out, int i0, int i1)
+{
+    // Modo, paleta y tabla como constantes en cada llamada: el bucle queda sin ramas
+    if (cfg->fast_math == FASTMATH_FAST)
+    {
+        precalc_range_fast_mode(cfg, lut, o, t, cx, cy, out, i0, i1, FASTMATH_FAST);
+        return;
+    }
+    if (cfg->fast_math == FASTMATH_ACCURATE)
+    {
+        precalc_range_fast_mode(cfg, lut, o, t, cx, cy, out, i0, i1, FASTMATH_ACCURATE);
+        return;
+    }
+    for (int i = i0; i < i1; ++i)
+    {
+        float dx0 = o->x[i] - cx, dy0 = o->y[i] - cy;
+        float dxp = o->px[i] - cx, dyp = o->py[i] - cy;
+        int pr = particle_radius(o, i, t, cfg->point_scale, NULL);
+        Uint8 rr, gg, bb;
+        particle_color(cfg, lut, i, t, &rr, &gg, &bb);
+        pc_store(&out[i], dx0, dy0, dxp, dyp, pr, (Uint32)rr | ((Uint32)gg << 8) | ((Uint32)bb << 16));
+    }
+}
+
+/** Argumentos de los bloques de pre-cálculo (solo o fusionado con la física). */
+typedef struct
+{
+    const Config *cfg;
+    const ColorLUT *lut;
+    Orbiters *o;
+    const float *atx, *aty;
+    float dt, t, cx, cy;
+    Precomp *out;
+    SpriteBatch *emit;
+} PrecalcJob;
+
+static void precalc_block(void *ctx, int i0, int i1)
+{
+    const PrecalcJob *j = (const PrecalcJob *)ctx;
+    precalc_range(j->cfg, j->lut, j->o, j->t, j->cx, j->cy, j->out, i0, i1);
+    if (j->emit)
+        batch_emit_range(j->emit, j->out, i0, i1, 0);
+}
+
+/** Bloque [i0,i1) de cap: integra todo (incluido el relleno) y pre-calcula lo que es < n. */
+static void fused_block(void *ctx, int i0, int i1)
+{
+    const PrecalcJob *j = (const PrecalcJob *)ctx;
+    integrate_range(j->o, j->atx, j->aty, j->dt, i0, i1, j->cfg->fast_math);
+    int i1n = i1 < j->o->n ? i1 : j->o->n;
+    if (i0 >= i1n)
+        return;
+    precalc_range(j->cfg, j->lut, j->o, j->t, j->cx, j->cy, j->out, i0, i1n);
+    if (j->emit)
+        batch_emit_range(j->emit, j->out, i0, i1n, 0);
+}
+
+/**
+ * Precalcula deltas, radios y colores por partícula (paralelizable).
+ * Reduce el costo durante el render al reusar estos valores. Con emit != NULL
+ * cada bloque además expande sus copias a los vértices de emit.
+ */
+static void precalc_particles(const Executor *ex, const Config *cfg, const ColorLUT *lut, const Orbiters *o, float t, float cx, float cy,
+                              Precomp *out, SpriteBatch *emit)
+{
+    PrecalcJob j = {cfg, lut, (Orbiters *)o, NULL, NULL, 0.0f, t, cx, cy, out, emit};
+    ex->for_blocks(o->n, SIM_BLOCK, precalc_block, &j);
+}
+
+/**
+ * Modo fusionado: una sola región paralela por frame. Cada hilo integra un
+ * bloque de SIM_BLOCK partículas y enseguida escribe su Precomp, mientras
+ * esos datos siguen en L1; evita releer el SoA y un fork/join extra. Con
+ * emit != NULL también expande el bloque a vértices en la misma pasada.
+ */
+static void update_precalc_fused(const Executor *ex, const Config *cfg, const ColorLUT *lut, Orbiters *o, const Attractors *a, float dt,
+                                 float t, float cx, float cy, Precomp *out, SpriteBatch *emit)
+{
+    PrecalcJob j = {cfg, lut, o, a->cx, a->cy, dt, t, cx, cy, out, emit};
+    ex->for_blocks(o->cap, SIM_BLOCK, fused_block, &j);
+}
+
+// ------------------------ Sprites: discos y halos ------------------------
+
+/** Alpha del texel (x,y) del disco de radio r (lado 2r+1): 255 dentro, 0 fuera. */
+static inline Uint8 disc_alpha(int r, int x, int y)
+{
+    int dx = x - r, dy = y - r;
+    return (dx * dx + dy * dy <= r * r) ? 255 : 0;
+}
+
+/** Alpha del texel (x,y) del halo radial D x D (falloff ~ t^1.8). */
+static inline Uint8 radial_alpha(int D, int x, int y)
+{
+    float dx = x - (D - 1) * 0.5f;
+    float dy = y - (D - 1) * 0.5f;
+    float r = sqrtf(dx * dx + dy * dy);
+    float t = fmaxf(0.0f, 1.0f - r / (D * 0.5f));
+    return (Uint8)(255.0f * powf(t, 1.8f));
+}
+
+/** Rasteriza un disco blanco de radio r (lado 2r+1) en p; fuera, alpha 0. */
+static void fill_disc(Uint32 *p, int pitch, const SDL_PixelFormat *fmt, int r)
+{
+    int D = r * 2 + 1;
+    Uint32 on = SDL_MapRGBA(fmt, 255, 255, 255, 255);
+    Uint32 off = SDL_MapRGBA(fmt, 255, 255, 255, 0);
+    for (int y = 0; y < D; ++y)
+        for (int x = 0; x < D; ++x)
+            p[y * pitch + x] = disc_alpha(r, x, y) ? on : off;
+}
+
+/** Rasteriza el halo radial blanco D x D (falloff ~ t^1.8) en p. */
+static void fill_radial(Uint32 *p, int pitch, const SDL_PixelFormat *fmt, int D)
+{
+    for (int y = 0; y < D; ++y)
+        for (int x = 0; x < D; ++x)
+            p[y * pitch + x] = SDL_MapRGBA(fmt, 255, 255, 255, radial_alpha(D, x, y));
+}
+
+/**
+ * Genera textura de disco RGBA (radio r) para dibujar puntos vía GPU.
+ * Usa superficie temporal y la convierte en textura, con blend habilitado.
+ */
+static SDL_Texture *make_disc_texture(SDL_Renderer *ren, int r)
+{
+    int D = r * 2 + 1;
+    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, D, D, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!s)
+        return NULL;
+    fill_disc((Uint32 *)s->pixels, s->pitch / 4, s->format, r);
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, s);
+    SDL_FreeSurface(s);
+    if (tex)
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    return tex;
+}
+
+/**
+ * Genera textura radial RGBA (D x D) para halos suaves (falloff ~ t^1.8).
+ * Se colorea y modula alpha por partícula en tiempo de dibujo.
+ */
+static SDL_Texture *make_radial_texture(SDL_Renderer *ren, int D)
+{
+    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, D, D, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!s)
+        return NULL;
+    fill_radial((Uint32 *)s->pixels, s->pitch / 4, s->format, D);
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, s);
+    SDL_FreeSurface(s);
+    if (tex)
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    return tex;
+}
+
+// ------------------------ Lotes de geometría (SDL_RenderGeometry) ------------------------
+
+/*
+ * Capas de --batch 1, en orden de dibujo. Cada capa acumula quads con color
+ * por vértice (equivale a ColorMod/AlphaMod) y se envía con un solo
+ * SDL_RenderGeometry por frame (o por tanda si el frame excede el buffer).
+ */
+typedef enum
+{
+    LAYER_TRAIL = 0, // Estela larga: quad de 1 px sin textura
+    LAYER_TAIL,      // Colitas: TAIL_QUADS discos por copia
+    LAYER_HALO,      // Halo radial (glow)
+    LAYER_NUCLEUS,   // Núcleo
+    LAYER_COUNT
+} SpriteLayer;
+
+#define TAIL_QUADS 2            // Colitas por copia
+#define BATCH_MIN_SLOTS 32768   // Copias por tanda mínimas (buffer inicial)
+#define BATCH_BUDGET_MB 512     // Tope del buffer de vértices del frame completo
+#define ATLAS_PAD 2             // Borde transparente entre sprites (filtrado lineal)
+#define ATLAS_RADIAL 32         // Lado del halo radial en el atlas
+
+/* Quads por copia en cada capa (orden de SpriteLayer). */
+static const int LAYER_QUADS[LAYER_COUNT] = {1, TAIL_QUADS, 1, 1};
+
+/*
+ * Clases de la lista de dibujo de --lod 1, en su orden: primero las
+ * partículas con solo núcleo, luego las completas y al final los splats de
+ * densidad. Así cada capa dibuja un tramo contiguo de la lista.
+ */
+typedef struct
+{
+    int nuc, full, splat;
+} LodCounts;
+
+#define LOD_SPLAT_R 18   // Radio (px) del splat de densidad de una celda
+#define LOD_SPLAT_DIV 16 // Alpha del splat = nucA * partículas / LOD_SPLAT_DIV (acotado)
+
+/* Parámetros de expansión de un frame: simetrías, espejo, muestreo y alphas. */
+typedef struct
+{
+    int symN, mirN, copies; // Rotaciones, espejos (1|2) y copias por partícula
+    int step;               // Dibuja 1 de cada step partículas (render_frac; 1 con --lod)
+    int nuc, full, splat;   // Lista de dibujo: [solo núcleo][completas][splats] (draw_params_list)
+    int trail, glow_on;
+    float cx, cy;
+    float cosA[8], sinA[8];
+    Uint8 trailA, haloA, nucA, tailA[TAIL_QUADS + 1];
+} DrawParams;
+
+/*
+ * SpriteBatch: atlas con los discos r=1..5 y el halo radial (una textura para
+ * todas las capas) y un buffer de vértices por capa. La copia (m, mir) de la
+ * j-ésima partícula dibujada ocupa el slot j * copias + m * espejos + mir, y en
+ * cada capa los quads slot * LAYER_QUADS[l] .. +LAYER_QUADS[l]-1: los hilos
+ * escriben rangos disjuntos sin sincronizarse.
+ */
+typedef struct SpriteBatch
+{
+    SDL_Texture *atlas;
+    int owns_atlas;             // 0 = atlas prestado (batch_create_shared)
+    SDL_FRect disc_uv[6];       // UV normalizadas del disco de radio r (índice = r)
+    SDL_FRect radial_uv;        // UV normalizadas del halo
+    SDL_Vertex *v[LAYER_COUNT]; // 4 * cap_slots * LAYER_QUADS[l] vértices por capa
+    int *idx;                   // 6 * cap_slots * TAIL_QUADS índices (0,1,2, 2,3,0 por quad)
+    int cap_slots;              // Copias que caben en los buffers
+    DrawParams dp;              // Parámetros del frame (batch_begin_frame)
+    int ndraw;                  // Partículas dibujadas en el frame
+    int ready;                  // 1 = el pre-cálculo ya emitió todo el frame
+    const Executor *ex;         // Reparto de batch_emit_list (batch_begin_frame)
+} SpriteBatch;
+
+/** Destruye el atlas y libera buffers; acepta NULL. */
+static void batch_free(SpriteBatch *b)
+{
+    if (!b)
+        return;
+    if (b->atlas && b->owns_atlas)
+        SDL_DestroyTexture(b->atlas);
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        free(b->v[l]);
+    free(b->idx);
+    free(b);
+}
+
+/**
+ * Garantiza buffers para `slots` copias (crece, nunca encoge). Falla sin
+ * tocar los buffers si pasa de BATCH_MIN_SLOTS y excede BATCH_BUDGET_MB, o si
+ * no hay memoria.
+ */
+static bool batch_reserve(SpriteBatch *b, int slots)
+{
+    if (slots <= b->cap_slots)
+        return true;
+    size_t per_slot = sizeof(int) * 6 * TAIL_QUADS;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        per_slot += sizeof(SDL_Vertex) * 4 * (size_t)LAYER_QUADS[l];
+    if (slots > BATCH_MIN_SLOTS && (size_t)slots * per_slot > (size_t)BATCH_BUDGET_MB << 20)
+        return false;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+    {
+        SDL_Vertex *nv = (SDL_Vertex *)realloc(b->v[l], sizeof(SDL_Vertex) * 4 * (size_t)LAYER_QUADS[l] * (size_t)slots);
+        if (!nv)
+            return false;
+        b->v[l] = nv;
+    }
+    int *ni = (int *)realloc(b->idx, sizeof(int) * 6 * TAIL_QUADS * (size_t)slots);
+    if (!ni)
+        return false;
+    b->idx = ni;
+    for (int q = b->cap_slots * TAIL_QUADS; q < slots * TAIL_QUADS; ++q)
+    {
+        int *ix = b->idx + 6 * (size_t)q;
+        ix[0] = 4 * q;
+        ix[1] = 4 * q + 1;
+        ix[2] = 4 * q + 2;
+        ix[3] = 4 * q + 2;
+        ix[4] = 4 * q + 3;
+        ix[5] = 4 * q;
+    }
+    b->cap_slots = slots;
+    return true;
+}
+
+/**
+ * Superficie RGBA32 del atlas: discos r=1..5 en fila y luego el halo,
+ * separados por ATLAS_PAD de blanco transparente. Deja sus UV normalizadas
+ * en disc_uv[1..5] y *radial_uv; NULL sin memoria.
+ */
+static SDL_Surface *atlas_surface(SDL_FRect disc_uv[6], SDL_FRect *radial_uv)
+{
+    int W = ATLAS_PAD, H = ATLAS_RADIAL + 2 * ATLAS_PAD;
+    for (int r = 1; r <= 5; ++r)
+        W += 2 * r + 1 + ATLAS_PAD;
+    W += ATLAS_RADIAL + ATLAS_PAD;
+    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, W, H, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!s)
+        return NULL;
+    Uint32 *p = (Uint32 *)s->pixels;
+    int pitch = s->pitch / 4;
+    Uint32 clear = SDL_MapRGBA(s->format, 255, 255, 255, 0);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+            p[y * pitch + x] = clear;
+    int x0 = ATLAS_PAD;
+    for (int r = 1; r <= 5; ++r)
+    {
+        int D = 2 * r + 1;
+        fill_disc(p + ATLAS_PAD * pitch + x0, pitch, s->format, r);
+        disc_uv[r] = (SDL_FRect){(float)x0 / W, (float)ATLAS_PAD / H, (float)D / W, (float)D / H};
+        x0 += D + ATLAS_PAD;
+    }
+    fill_radial(p + ATLAS_PAD * pitch + x0, pitch, s->format, ATLAS_RADIAL);
+    *radial_uv = (SDL_FRect){(float)x0 / W, (float)ATLAS_PAD / H, (float)ATLAS_RADIAL / W, (float)ATLAS_RADIAL / H};
+    return s;
+}
+
+/** Crea el atlas (atlas_surface) y reserva BATCH_MIN_SLOTS copias. NULL si algo falla. */
+static SpriteBatch *batch_create(SDL_Renderer *ren)
+{
+    SpriteBatch *b = (SpriteBatch *)calloc(1, sizeof(SpriteBatch));
+    if (!b)
+        return NULL;
+    SDL_Surface *s = atlas_surface(b->disc_uv, &b->radial_uv);
+    if (!s)
+    {
+        batch_free(b);
+        return NULL;
+    }
+    b->atlas = SDL_CreateTextureFromSurface(ren, s);
+    b->owns_atlas = 1;
+    SDL_FreeSurface(s);
+    if (!b->atlas || !batch_reserve(b, BATCH_MIN_SLOTS))
+    {
+        batch_free(b);
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(b->atlas, SDL_BLENDMODE_BLEND);
+    return b;
+}
+
+/**
+ * Segundo juego de buffers que reutiliza el atlas de src (no lo destruye):
+ * lo usa el doble buffer de --pipeline 1. NULL si no hay memoria.
+ */
+static SpriteBatch *batch_create_shared(const SpriteBatch *src)
+{
+    SpriteBatch *b = (SpriteBatch *)calloc(1, sizeof(SpriteBatch));
+    if (!b)
+        return NULL;
+    b->atlas = src->atlas;
+    memcpy(b->disc_uv, src->disc_uv, sizeof(b->disc_uv));
+    b->radial_uv = src->radial_uv;
+    if (!batch_reserve(b, BATCH_MIN_SLOTS))
+    {
+        batch_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+/**
+ * Parámetros de expansión de un frame (simetrías, espejo, muestreo y alphas
+ * por copia); los comparten SpriteBatch y el rasterizador por CPU.
+ */
+static void draw_params_init(DrawParams *dp, const Config *cfg, int symN, int mirror, float cx, float cy)
+{
+    if (symN < 1)
+        symN = 1;
+    if (symN > 8)
+        symN = 8;
+    for (int m = 0; m < symN; ++m)
+    {
+        float ang = 2.0f * (float)M_PI * (float)m / (float)symN;
+        dp->cosA[m] = cosf(ang);
+        dp->sinA[m] = sinf(ang);
+    }
+    dp->symN = symN;
+    dp->mirN = mirror ? 2 : 1;
+    dp->copies = symN * dp->mirN;
+    dp->cx = cx;
+    dp->cy = cy;
+    dp->trail = cfg->trail == TRAIL_LINES ? 1 : 0;
+    dp->glow_on = cfg->glow ? 1 : 0;
+    dp->step = (cfg->lod || cfg->render_frac >= 0.999f) ? 1 : (int)lroundf(1.0f / cfg->render_frac);
+    if (dp->step < 1)
+        dp->step = 1;
+
+    // Alphas constantes en el frame (dependen solo de copias y glow)
+    float alpha_div = (float)dp->copies;
+    float a_scale = dp->glow_on ? 1.0f : 0.6f;
+    dp->trailA = (Uint8)fmaxf(4.0f, (90.0f * a_scale) / alpha_div);
+    Uint8 tailA0 = (Uint8)fmaxf(3.0f, (34.0f * a_scale) / alpha_div);
+    dp->haloA = dp->glow_on ? (Uint8)fmaxf(8.0f, 50.0f / alpha_div) : 0;
+    dp->nucA = (Uint8)fmaxf(70.0f, (185.0f + 50.0f * 0.5f) / alpha_div);
+    for (int c = 1; c <= TAIL_QUADS; ++c)
+        dp->tailA[c] = (Uint8)fmaxf(3.0f, (float)tailA0 / (float)c);
+}
+
+/**
+ * Fija la lista de dibujo del frame: con lc, sus tres clases; sin lc, una de
+ * cada dp->step de las n partículas, todas completas. Retorna su largo.
+ */
+static int draw_params_list(DrawParams *dp, int n, const LodCounts *lc)
+{
+    if (lc)
+    {
+        dp->nuc = lc->nuc;
+        dp->full = lc->full;
+        dp->splat = lc->splat;
+    }
+    else
+    {
+        dp->nuc = 0;
+        dp->full = (n + dp->step - 1) / dp->step;
+        dp->splat = 0;
+    }
+    return dp->nuc + dp->full + dp->splat;
+}
+
+/**
+ * Tramo [*j0,*j1) de la lista de dibujo que aporta a la capa l: estela y
+ * colitas solo las completas, el núcleo también las de solo núcleo y el halo
+ * las completas (si glow) más los splats.
+ */
+static inline void draw_layer_range(const DrawParams *dp, int l, int *j0, int *j1)
+{
+    const int end_full = dp->nuc + dp->full;
+    *j0 = l == LAYER_NUCLEUS ? 0 : dp->nuc;
+    *j1 = end_full;
+    if (l == LAYER_TRAIL && !dp->trail)
+        *j1 = *j0;
+    if (l == LAYER_HALO)
+    {
+        if (!dp->glow_on)
+            *j0 = end_full;
+        *j1 = end_full + dp->splat;
+    }
+}
+
+/** Alpha por copia de un splat que agrega w partículas. */
+static inline Uint8 splat_alpha(const DrawParams *dp, int w)
+{
+    int a = dp->nucA * w / LOD_SPLAT_DIV;
+    return (Uint8)(a < 8 ? 8 : (a > 200 ? 200 : a));
+}
+
+/**
+ * Fija los parámetros de expansión del frame y reserva el buffer completo
+ * (ndraw * copias slots). Retorna b->ready: 1 si el pre-cálculo puede emitir
+ * todo el frame; 0 si excede el presupuesto (render emite por tandas).
+ */
+static int batch_begin_frame(SpriteBatch *b, const Config *cfg, int n, int symN, int mirror, float cx, float cy)
+{
+    DrawParams *dp = &b->dp;
+    draw_params_init(dp, cfg, symN, mirror, cx, cy);
+    b->ex = executor_get(cfg->exec == EXEC_STEAL ? EXEC_STEAL : EXEC_OPENMP); // --exec serial no toca el render
+    b->ndraw = draw_params_list(dp, n, NULL);
+    b->ready = batch_reserve(b, b->ndraw * dp->copies) ? 1 : 0;
+    return b->ready;
+}
+
+/** Escribe un quad alineado a ejes (x,y,w,h) con UV uv y color c en v[0..3]. */
+static inline void batch_quad(SDL_Vertex *v, float x, float y, float w, float h, const SDL_FRect *uv, SDL_Color c)
+{
+    v[0].position = (SDL_FPoint){x, y};
+    v[1].position = (SDL_FPoint){x + w, y};
+    v[2].position = (SDL_FPoint){x + w, y + h};
+    v[3].position = (SDL_FPoint){x, y + h};
+    v[0].tex_coord = (SDL_FPoint){uv->x, uv->y};
+    v[1].tex_coord = (SDL_FPoint){uv->x + uv->w, uv->y};
+    v[2].tex_coord = (SDL_FPoint){uv->x + uv->w, uv->y + uv->h};
+    v[3].tex_coord = (SDL_FPoint){uv->x, uv->y + uv->h};
+    v[0].color = v[1].color = v[2].color = v[3].color = c;
+}
+
+/** Escribe el segmento (x0,y0)-(x1,y1) como quad de 1 px de ancho (sin textura). */
+static inline void batch_line(SDL_Vertex *v, float x0, float y0, float x1, float y1, SDL_Color c)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    float len = sqrtf(dx * dx + dy * dy);
+    float nx = 0.5f, ny = 0.0f; // Segmento degenerado: punto de 1 px
+    if (len > 1e-4f)
+    {
+        nx = -dy / len * 0.5f;
+        ny = dx / len * 0.5f;
+    }
+    v[0].position = (SDL_FPoint){x0 + nx, y0 + ny};
+    v[1].position = (SDL_FPoint){x1 + nx, y1 + ny};
+    v[2].position = (SDL_FPoint){x1 - nx, y1 - ny};
+    v[3].position = (SDL_FPoint){x0 - nx, y0 - ny};
+    for (int k = 0; k < 4; ++k)
+    {
+        v[k].tex_coord = (SDL_FPoint){0.0f, 0.0f};
+        v[k].color = c;
+    }
+}
+
+/**
+ * Expande simetrías/espejo y colitas de las partículas dibujadas en [i0,i1)
+ * (múltiplos de dp.step) a sus slots, relativos a la partícula jbase. Según
+ * su clase en la lista (draw_params_list) escribe todas las capas, solo el
+ * núcleo o, si es splat, solo su quad de halo. Solo escribe slots propios: se
+ * puede llamar en paralelo con rangos disjuntos.
+ */
+static void batch_emit_range(SpriteBatch *b, const Precomp *pc, int i0, int i1, int jbase)
+{
+    const DrawParams *dp = &b->dp;
+    const int copies = dp->copies, mirN = dp->mirN, step = dp->step;
+    const float cx = dp->cx, cy = dp->cy;
+    int first = ((i0 + step - 1) / step) * step;
+    const int end_full = dp->nuc + dp->full;
+    for (int i = first; i < i1; i += step)
+    {
+        int j = i / step - jbase;
+        const bool splat = i / step >= end_full, full = !splat && i / step >= dp->nuc;
+        const PcVals pv = pc_load(&pc[i]);
+        Uint8 rr = pv.r, gg = pv.g, bb = pv.b;
+        float dx0 = pv.dx0, dy0 = pv.dy0;
+        float dxp = pv.dxp, dyp = pv.dyp;
+        int pr = pv.pr;
+        if (splat)
+        {
+            const float sr = (float)LOD_SPLAT_R;
+            const SDL_Color sc = {rr, gg, bb, splat_alpha(dp, pv.w)};
+            for (int m = 0; m < dp->symN; ++m)
+            {
+                float xr = cx + dx0 * dp->cosA[m] - dy0 * dp->sinA[m];
+                float yr = cy + dx0 * dp->sinA[m] + dy0 * dp->cosA[m];
+                for (int mir = 0; mir < mirN; ++mir)
+                {
+                    float X = mir ? (2.0f * cx - xr) : xr;
+                    batch_quad(b->v[LAYER_HALO] + 4 * (size_t)(j * copies + m * mirN + mir), X - sr, yr - sr, sr * 2.0f, sr * 2.0f,
+                               &b->radial_uv, sc);
+                }
+            }
+            continue;
+        }
+        if (pr < 1)
+            pr = 1;
+        if (pr > 3)
+            pr = 3;
+
+        for (int m = 0; m < dp->symN; ++m)
+        {
+            float xr = cx + dx0 * dp->cosA[m] - dy0 * dp->sinA[m];
+            float yr = cy + dx0 * dp->sinA[m] + dy0 * dp->cosA[m];
+            float xpr = cx + dxp * dp->cosA[m] - dyp * dp->sinA[m];
+            float ypr = cy + dxp * dp->sinA[m] + dyp * dp->cosA[m];
+
+            for (int mir = 0; mir < mirN; ++mir)
+            {
+                int slot = j * copies + m * mirN + mir;
+                float X = mir ? (2.0f * cx - xr) : xr;
+                float Y = yr;
+                float XP = mir ? (2.0f * cx - xpr) : xpr;
+                float YP = ypr;
+
+                if (dp->trail && full)
+                    batch_line(b->v[LAYER_TRAIL] + 4 * (size_t)slot, XP, YP, X, Y, (SDL_Color){rr, gg, bb, dp->trailA});
+
+                float ddx = X - XP, ddy = Y - YP;
+                for (int c = 1; c <= TAIL_QUADS && full; ++c)
+                {
+                    float tpos = (float)c / 4.0f;
+                    float cxp = X - ddx * tpos, cyp = Y - ddy * tpos;
+                    int pr2 = (pr - c >= 1) ? (pr - c) : 1;
+                    float D2 = (float)(pr2 * 2 + 1);
+                    batch_quad(b->v[LAYER_TAIL] + 4 * ((size_t)slot * TAIL_QUADS + c - 1), cxp - pr2, cyp - pr2, D2, D2,
+                               &b->disc_uv[pr2], (SDL_Color){rr, gg, bb, dp->tailA[c]});
+                }
+
+                if (dp->haloA > 0 && full)
+                {
+                    float hr = (float)(pr + 2);
+                    batch_quad(b->v[LAYER_HALO] + 4 * (size_t)slot, X - hr, Y - hr, hr * 2.0f, hr * 2.0f,
+                               &b->radial_uv, (SDL_Color){rr, gg, bb, dp->haloA});
+                }
+
+                float D = (float)(pr * 2 + 1);
+                batch_quad(b->v[LAYER_NUCLEUS] + 4 * (size_t)slot, X - pr, Y - pr, D, D,
+                           &b->disc_uv[pr], (SDL_Color){rr, gg, bb, dp->nucA});
+            }
+        }
+    }
+}
+
+/**
+ * Envía las entradas [j0,j1) de la lista ya emitidas (slots relativos a j0):
+ * las capas en orden (estela, colitas, halo, núcleo), cada una con el tramo
+ * de draw_layer_range. La estela usa el blend del renderer (ADD con glow,
+ * como las líneas del modo sprite a sprite). Retorna las llamadas de dibujo.
+ */
+static int batch_flush(SDL_Renderer *ren, SpriteBatch *b, int j0, int j1)
+{
+    const DrawParams *dp = &b->dp;
+    int calls = 0;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+    {
+        int a, z;
+        draw_layer_range(dp, l, &a, &z);
+        a = a > j0 ? a : j0;
+        z = z < j1 ? z : j1;
+        if (a >= z)
+            continue;
+        int q = (z - a) * dp->copies * LAYER_QUADS[l];
+        SDL_Texture *tex = b->atlas;
+        if (l == LAYER_TRAIL)
+        {
+            SDL_SetRenderDrawBlendMode(ren, dp->glow_on ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_BLEND);
+            tex = NULL;
+        }
+        const SDL_Vertex *v = b->v[l] + 4 * (size_t)(a - j0) * dp->copies * LAYER_QUADS[l];
+        SDL_RenderGeometry(ren, tex, v, 4 * q, b->idx, 6 * q);
+        calls++;
+    }
+    return calls;
+}
+
+/** Argumentos de los bloques de batch_emit_list. */
+typedef struct
+{
+    SpriteBatch *b;
+    const Precomp *pc;
+    int n, j0;
+    ProfRegion *r; // Región "vertices" del perfil (NULL sin perfil)
+} EmitJob;
+
+/** Entradas [j0+ja, j0+jb) de la lista: partículas desde (j0+ja)*step. */
+static void emit_block(void *ctx, int ja, int jb)
+{
+    const EmitJob *j = (const EmitJob *)ctx;
+    uint64_t a = j->r ? SDL_GetPerformanceCounter() : 0;
+    const int step = j->b->dp.step;
+    ja += j->j0;
+    jb += j->j0;
+    int i1 = jb * step < j->n ? jb * step : j->n;
+    batch_emit_range(j->b, j->pc, ja * step, i1, j->j0);
+    if (j->r)
+        prof_block(j->r, a, SDL_GetPerformanceCounter());
+}
+
+/**
+ * Emite en paralelo por bloques las entradas [j0,j1) de la lista de pc, con
+ * slots relativos a j0 (deben caber en el buffer), repartidas por b->ex. Con
+ * perfil es la región "vertices".
+ */
+static void batch_emit_list(SpriteBatch *b, const Precomp *pc, int n, int j0, int j1)
+{
+    ProfRegion reg;
+    EmitJob j = {b, pc, n, j0, NULL};
+    if (prof.on)
+    {
+        prof_region_begin(&reg, "vertices");
+        j.r = &reg;
+    }
+    b->ex->for_blocks(j1 - j0, SIM_BLOCK, emit_block, &j);
+    if (j.r)
+        prof_region_end(j.r);
+}
+
+// ------------------------ Nivel de detalle (--lod 1) ------------------------
+
+#define LOD_CELL 32.0f       // Lado (px) de la celda de densidad y de splat
+#define LOD_SPEED_REF 4.0f   // Velocidad (px/frame) que duplica la importancia
+#define LOD_DENSITY_REF 8.0f // Vecinos de celda que la reducen a la mitad
+#define LOD_NUC_GAIN 4.0f    // Prob. de dibujar (núcleo) = LOD_NUC_GAIN * prob. de detalle completo
+
+/* Nivel de una partícula; el orden es el de la lista de dibujo (LodCounts). */
+typedef enum
+{
+    LOD_NUCLEUS = 0, // Solo núcleo
+    LOD_FULL,        // Estela, colitas, halo y núcleo
+    LOD_SPLAT,       // Se suma al splat de densidad de su celda
+    LOD_COUNT
+} LodLevel;
+
+/*
+ * LodState: reemplaza el salto fijo de render_frac por muestreo de
+ * importancia. El pre-cálculo escribe en src; lod_build reparte src en celdas
+ * de LOD_CELL px (CellBins), da a cada partícula la importancia
+ * pr² · (1 + vel/LOD_SPEED_REF) / (1 + vecinos/LOD_DENSITY_REF) y la compara
+ * contra su umbral fijo u[i] (sin parpadeo entre frames): u < λ·imp es
+ * completa, u < LOD_NUC_GAIN·λ·imp solo núcleo y el resto se agrega al splat
+ * de su celda. λ se corrige cada frame para que los quads emitidos sigan el
+ * presupuesto de sprites. Lo posee quien simula (el productor con --pipeline 1).
+ */
+typedef struct
+{
+    CellBins bins;   // Partículas por celda (orden de índice dentro de cada una)
+    Precomp *src;    // Pre-cálculo completo del frame (n)
+    float *u;        // Umbral fijo por partícula en [0,1) (RNG_STREAM_LOD)
+    Uint8 *level;    // LodLevel del frame por partícula
+    int *cell;       // LOD_COUNT por celda: conteos y luego cursores en la lista
+    float hw, hh;    // Centro del mundo (src es relativo a él)
+    float lambda;    // Escala de la probabilidad de detalle (controlador)
+    int n;
+} LodState;
+
+/** Libera el estado; acepta NULL. */
+static void lod_free(LodState *L)
+{
+    if (!L)
+        return;
+    cell_bins_free(&L->bins);
+    free(L->src);
+    free(L->u);
+    free(L->level);
+    free(L->cell);
+    free(L);
+}
+
+/** Crea el estado para n partículas en un mundo W x H; NULL si falta memoria. */
+static LodState *lod_create(const Executor *ex, int W, int H, int n, uint32_t seed)
+{
+    LodState *L = (LodState *)calloc(1, sizeof(LodState));
+    if (!L)
+        return NULL;
+    L->n = n;
+    L->hw = W * 0.5f;
+    L->hh = H * 0.5f;
+    L->lambda = 1.0f;
+    int gx = (int)ceilf(W / LOD_CELL), gy = (int)ceilf(H / LOD_CELL);
+    L->src = (Precomp *)malloc(sizeof(Precomp) * (size_t)n);
+    L->u = (float *)malloc(sizeof(float) * (size_t)n);
+    L->level = (Uint8 *)malloc((size_t)n);
+    L->cell = (int *)malloc(sizeof(int) * LOD_COUNT * (size_t)gx * gy);
+    if (!L->src || !L->u || !L->level || !L->cell || !cell_bins_resize(&L->bins, gx, gy))
+    {
+        lod_free(L);
+        return NULL;
+    }
+    precomp_first_touch(ex, L->src, n);
+    for (int i = 0; i < n; ++i)
+        L->u[i] = rng_u01(seed, RNG_STREAM_LOD, (uint32_t)i, 0);
+    return L;
+}
+
+/** CellRangeFn de LodState: la celda (acotada al mundo) de src[i]. */
+static inline bool lod_cell_range(const void *ctx, int i, int *c0x, int *c1x, int *c0y, int *c1y)
+{
+    const LodState *L = (const LodState *)ctx;
+    const PcVals p = pc_load(&L->src[i]);
+    *c0x = *c1x = grid_coord(p.dx0 + L->hw, 1.0f / LOD_CELL, L->bins.gx);
+    *c0y = *c1y = grid_coord(p.dy0 + L->hh, 1.0f / LOD_CELL, L->bins.gy);
+    return true;
+}
+
+/** Quads por copia de una partícula completa (los de solo núcleo y splats usan 1). */
+static int lod_quads_full(TrailMode trail, int glow)
+{
+    return (trail == TRAIL_LINES ? 1 : 0) + TAIL_QUADS + (glow ? 1 : 0) + 1;
+}
+
+/**
+ * Construye en out la lista de dibujo del frame a partir de src: clasifica
+ * por celda (en paralelo), prefija los conteos de las tres clases y copia
+ * cada partícula a su tramo; por celda con splats escribe un Precomp en su
+ * centroide, con color medio y w = partículas agregadas. Después ajusta λ
+ * hacia budget quads (copies copias, qfull quads por copia completa). La
+ * lista ocupa a lo sumo n entradas. Sin memoria para el binning, todas quedan
+ * completas en orden.
+ */
+static void lod_build(LodState *L, float budget, int copies, int qfull, Precomp *out, LodCounts *lc)
+{
+    const int n = L->n;
+    if (!cell_bins_build(&L->bins, n, lod_cell_range, L))
+    {
+        memcpy(out, L->src, sizeof(Precomp) * (size_t)n);
+        *lc = (LodCounts){0, n, 0};
+        return;
+    }
+    const int ncells = L->bins.gx * L->bins.gy;
+    const int *start = L->bins.start;
+    const Uint32 *items = L->bins.items;
+    const float lambda = L->lambda;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 8)
+#endif
+    for (int c = 0; c < ncells; ++c)
+    {
+        int k[LOD_COUNT] = {0, 0, 0};
+        const float dens = 1.0f / (1.0f + (float)(start[c + 1] - start[c]) * (1.0f / LOD_DENSITY_REF));
+        for (int s = start[c]; s < start[c + 1]; ++s)
+        {
+            const int i = (int)items[s];
+            const PcVals p = pc_load(&L->src[i]);
+            float vx = p.dx0 - p.dxp, vy = p.dy0 - p.dyp;
+            float imp = (float)(p.pr * p.pr) * (1.0f + sqrtf(vx * vx + vy * vy) * (1.0f / LOD_SPEED_REF)) * dens;
+            float pf = lambda * imp, u = L->u[i];
+            LodLevel lv = u < pf ? LOD_FULL : (u < LOD_NUC_GAIN * pf ? LOD_NUCLEUS : LOD_SPLAT);
+            L->level[i] = (Uint8)lv;
+            k[lv]++;
+        }
+        for (int l = 0; l < LOD_COUNT; ++l)
+            L->cell[(size_t)c * LOD_COUNT + l] = k[l];
+    }
+
+    // Prefijo por clase en orden de celda: [núcleo][completas][un splat por celda]
+    int tot[LOD_COUNT] = {0, 0, 0};
+    for (int c = 0; c < ncells; ++c)
+    {
+        tot[LOD_NUCLEUS] += L->cell[(size_t)c * LOD_COUNT + LOD_NUCLEUS];
+        tot[LOD_FULL] += L->cell[(size_t)c * LOD_COUNT + LOD_FULL];
+    }
+    int cur[LOD_COUNT] = {0, tot[LOD_NUCLEUS], tot[LOD_NUCLEUS] + tot[LOD_FULL]};
+    for (int c = 0; c < ncells; ++c)
+    {
+        int *k = L->cell + (size_t)c * LOD_COUNT;
+        int has_splat = k[LOD_SPLAT] > 0;
+        for (int l = 0; l < LOD_COUNT; ++l)
+        {
+            int cnt = l == LOD_SPLAT ? has_splat : k[l];
+            k[l] = cur[l];
+            cur[l] += cnt;
+        }
+    }
+    lc->nuc = tot[LOD_NUCLEUS];
+    lc->full = tot[LOD_FULL];
+    lc->splat = cur[LOD_SPLAT] - lc->nuc - lc->full;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 8)
+#endif
+    for (int c = 0; c < ncells; ++c)
+    {
+        int *k = L->cell + (size_t)c * LOD_COUNT;
+        int ns = 0, sr = 0, sg = 0, sb = 0;
+        float sx = 0.0f, sy = 0.0f;
+        for (int s = start[c]; s < start[c + 1]; ++s)
+        {
+            const int i = (int)items[s];
+            const Precomp *p = &L->src[i];
+            if (L->level[i] != LOD_SPLAT)
+            {
+                out[k[L->level[i]]++] = *p;
+                continue;
+            }
+            const PcVals v = pc_load(p);
+            ns++;
+            sx += v.dx0;
+            sy += v.dy0;
+            sr += v.r;
+            sg += v.g;
+            sb += v.b;
+        }
+        if (ns > 0)
+            pc_store_splat(&out[k[LOD_SPLAT]], sx / (float)ns, sy / (float)ns,
+                           (Uint32)(sr / ns) | ((Uint32)(sg / ns) << 8) | ((Uint32)(sb / ns) << 16), ns);
+    }
+
+    // Controlador: λ multiplicativo hacia el presupuesto (acotado por frame)
+    double quads = (double)copies * ((double)lc->full * qfull + lc->nuc + lc->splat);
+    double r = quads > 0.0 ? (double)budget / quads : 2.0;
+    r = r < 0.5 ? 0.5 : (r > 2.0 ? 2.0 : r);
+    L->lambda = fminf(1e4f, fmaxf(1e-4f, (float)(lambda * r)));
+}
+
+/**
+ * Cambia la lista del frame de b por la de lc (ya compactada, a lo sumo las
+ * n entradas reservadas en batch_begin_frame) y, si el buffer la admite, la
+ * emite completa en paralelo.
+ */
+static void batch_set_list(SpriteBatch *b, const Precomp *pc, const LodCounts *lc)
+{
+    b->ndraw = draw_params_list(&b->dp, 0, lc);
+    if (b->ready)
+        batch_emit_list(b, pc, b->ndraw, 0, b->ndraw);
+}
+
+// ------------------------ Instancias en GPU (--backend gl) ------------------------
+
+/*
+ * --backend gl dibuja con shaders propios sobre el contexto OpenGL del
+ * renderer "opengl" de SDL: SDL_RenderFlush vacía la cola de SDL (el fade ya
+ * quedó en el destino), se dibuja en el mismo framebuffer (ventana o rt de
+ * SSAA) y se restaura el estado GL que SDL cachea. Así SSAA, --record,
+ * guías y present siguen siendo de SDL. Cada partícula dibujada sube un
+ * GlInstance; simetrías, espejo, colitas y halo salen del vertex shader
+ * (gl_VertexID = quad de la copia, gl_InstanceID = partícula).
+ */
+
+/*
+ * GlInstance: registro por partícula dibujada, sin importar --sym/--mirror:
+ * posición actual y previa relativas al centro y color más radio; en un
+ * splat de --lod 1 el último byte lleva w (partículas agregadas). Con el
+ * Precomp empaquetado es el propio Precomp (12 bytes, deltas int16): el
+ * buffer se llena con una copia. Con -DPRECOMP_FLOAT se reempaqueta a 20 bytes.
+ */
+#ifdef PRECOMP_FLOAT
+typedef struct
+{
+    float dx0, dy0, dxp, dyp;
+    Uint8 r, g, b, pr;
+} GlInstance;
+
+#define GL_POS_TYPE GL_FLOAT
+#define GL_POS_SCALE 1.0f
+#define GL_COL_OFFSET offsetof(GlInstance, r)
+#else
+typedef Precomp GlInstance;
+
+#define GL_POS_TYPE GL_SHORT
+#define GL_POS_SCALE (1.0f / PC_FIX)
+#define GL_COL_OFFSET offsetof(GlInstance, rgbp) // r, g, b, pr en orden de bytes (little-endian)
+#endif
+
+#define GL_LAYER_SPLAT LAYER_COUNT // Capa extra del shader: halo de splat (--lod 1)
+
+/* Funciones GL usadas, cargadas con SDL_GL_GetProcAddress (sin enlazar libGL). */
+#define GL_API(X)                                                                                     \
+    X(void, GetIntegerv, (GLenum, GLint *))                                                           \
+    X(const GLubyte *, GetString, (GLenum))                                                           \
+    X(GLboolean, IsEnabled, (GLenum))                                                                 \
+    X(void, Enable, (GLenum))                                                                         \
+    X(void, Disable, (GLenum))                                                                        \
+    X(void, BlendFuncSeparate, (GLenum, GLenum, GLenum, GLenum))                                      \
+    X(void, GenTextures, (GLsizei, GLuint *))                                                         \
+    X(void, BindTexture, (GLenum, GLuint))                                                            \
+    X(void, DeleteTextures, (GLsizei, const GLuint *))                                                \
+    X(void, TexImage2D, (GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void *)) \
+    X(void, TexParameteri, (GLenum, GLenum, GLint))                                                   \
+    X(void, PixelStorei, (GLenum, GLint))                                                             \
+    X(void, ActiveTexture, (GLenum))                                                                  \
+    X(GLuint, CreateShader, (GLenum))                                                                 \
+    X(void, ShaderSource, (GLuint, GLsizei, const GLchar *const *, const GLint *))                    \
+    X(void, CompileShader, (GLuint))                                                                  \
+    X(void, GetShaderiv, (GLuint, GLenum, GLint *))                                                   \
+    X(void, GetShaderInfoLog, (GLuint, GLsizei, GLsizei *, GLchar *))                                 \
+    X(void, DeleteShader, (GLuint))                                                                   \
+    X(GLuint, CreateProgram, (void))                                                                  \
+    X(void, AttachShader, (GLuint, GLuint))                                                           \
+    X(void, LinkProgram, (GLuint))                                                                    \
+    X(void, GetProgramiv, (GLuint, GLenum, GLint *))                                                  \
+    X(void, GetProgramInfoLog, (GLuint, GLsizei, GLsizei *, GLchar *))                                \
+    X(void, DeleteProgram, (GLuint))                                                                  \
+    X(void, UseProgram, (GLuint))                                                                     \
+    X(GLint, GetUniformLocation, (GLuint, const GLchar *))                                            \
+    X(void, Uniform1i, (GLint, GLint))                                                                \
+    X(void, Uniform1f, (GLint, GLfloat))                                                              \
+    X(void, Uniform2f, (GLint, GLfloat, GLfloat))                                                     \
+    X(void, Uniform1fv, (GLint, GLsizei, const GLfloat *))                                            \
+    X(void, Uniform4fv, (GLint, GLsizei, const GLfloat *))                                            \
+    X(void, GenVertexArrays, (GLsizei, GLuint *))                                                     \
+    X(void, BindVertexArray, (GLuint))                                                                \
+    X(void, DeleteVertexArrays, (GLsizei, const GLuint *))                                            \
+    X(void, GenBuffers, (GLsizei, GLuint *))                                                          \
+    X(void, BindBuffer, (GLenum, GLuint))                                                             \
+    X(void, DeleteBuffers, (GLsizei, const GLuint *))                                                 \
+    X(void, BufferData, (GLenum, GLsizeiptr, const void *, GLenum))                                   \
+    X(void *, MapBufferRange, (GLenum, GLintptr, GLsizeiptr, GLbitfield))                             \
+    X(GLboolean, UnmapBuffer, (GLenum))                                                               \
+    X(void, VertexAttribPointer, (GLuint, GLint, GLenum, GLboolean, GLsizei, const void *))           \
+    X(void, EnableVertexAttribArray, (GLuint))                                                        \
+    X(void, VertexAttribDivisor, (GLuint, GLuint))                                                    \
+    X(void, DrawArraysInstanced, (GLenum, GLint, GLsizei, GLsizei))
+
+#define GL_API_FIELD(ret, name, args) ret(APIENTRY *name) args;
+typedef struct
+{
+    GL_API(GL_API_FIELD)
+} GlApi;
+#undef GL_API_FIELD
+
+/*
+ * Vertex shader: el quad q = gl_VertexID / 6 de la instancia es la copia
+ * q / u_quads (rotación m, espejo mir) y, en colitas, el disco c = q % u_quads + 1.
+ * Repite la geometría de batch_emit_range; u_flip sigue la convención de SDL
+ * (y hacia arriba en render targets, hacia abajo en la ventana).
+ */
+static const char *GL_VERT_SRC =
+    "layout(location = 0) in vec2 a_pos;\n"
+    "layout(location = 1) in vec2 a_prev;\n"
+    "layout(location = 2) in vec4 a_col;\n"
+    "uniform int u_layer, u_quads, u_mirN, u_nuca;\n"
+    "uniform vec2 u_center, u_view;\n"
+    "uniform float u_flip, u_splat_r;\n"
+    "uniform float u_cos[8], u_sin[8], u_alpha[5];\n"
+    "uniform vec4 u_disc[4], u_radial;\n"
+    "out vec2 v_uv;\n"
+    "out vec4 v_col;\n"
+    "const vec2 CORNER[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),\n"
+    "                               vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));\n"
+    "vec2 rot(vec2 d, int m) { return vec2(d.x * u_cos[m] - d.y * u_sin[m], d.x * u_sin[m] + d.y * u_cos[m]); }\n"
+    "void main()\n"
+    "{\n"
+    "    int q = gl_VertexID / 6, copy = q / u_quads, c = q % u_quads + 1, m = copy / u_mirN;\n"
+    "    vec2 k = CORNER[gl_VertexID % 6];\n"
+    "    vec2 r0 = rot(a_pos * POS_SCALE, m), rp = rot(a_prev * POS_SCALE, m);\n"
+    "    if (copy % u_mirN == 1) { r0.x = -r0.x; rp.x = -rp.x; }\n"
+    "    vec2 X = u_center + r0, XP = u_center + rp, pos;\n"
+    "    int pr = clamp(int(a_col.w), 1, 3);\n"
+    "    vec4 uv = vec4(0.0);\n"
+    "    float alpha;\n"
+    "    if (u_layer == 0)\n"
+    "    {\n"
+    "        vec2 d = X - XP;\n"
+    "        float len = length(d);\n"
+    "        vec2 nrm = len > 1e-4 ? vec2(-d.y, d.x) / len * 0.5 : vec2(0.5, 0.0);\n"
+    "        pos = mix(XP, X, k.x) + nrm * (1.0 - 2.0 * k.y);\n"
+    "        alpha = u_alpha[0];\n"
+    "    }\n"
+    "    else if (u_layer == 1)\n"
+    "    {\n"
+    "        int pr2 = max(pr - c, 1);\n"
+    "        pos = X - (X - XP) * (float(c) / 4.0) - float(pr2) + k * float(pr2 * 2 + 1);\n"
+    "        uv = u_disc[pr2];\n"
+    "        alpha = u_alpha[c];\n"
+    "    }\n"
+    "    else if (u_layer == 2)\n"
+    "    {\n"
+    "        float hr = float(pr + 2);\n"
+    "        pos = X - hr + k * (2.0 * hr);\n"
+    "        uv = u_radial;\n"
+    "        alpha = u_alpha[3];\n"
+    "    }\n"
+    "    else if (u_layer == 3)\n"
+    "    {\n"
+    "        pos = X - float(pr) + k * float(pr * 2 + 1);\n"
+    "        uv = u_disc[pr];\n"
+    "        alpha = u_alpha[4];\n"
+    "    }\n"
+    "    else\n"
+    "    {\n"
+    "        pos = X - u_splat_r + k * (2.0 * u_splat_r);\n"
+    "        uv = u_radial;\n"
+    "        alpha = float(clamp(u_nuca * int(a_col.w) / LOD_SPLAT_DIV, 8, 200)) / 255.0;\n"
+    "    }\n"
+    "    v_uv = uv.xy + k * uv.zw;\n"
+    "    v_col = vec4(a_col.rgb / 255.0, alpha);\n"
+    "    gl_Position = vec4(pos.x / u_view.x * 2.0 - 1.0, u_flip * (1.0 - pos.y / u_view.y * 2.0), 0.0, 1.0);\n"
+    "}\n";
+
+/* Fragment shader: color por vértice modulado por el atlas (como SDL_RenderGeometry). */
+static const char *GL_FRAG_SRC =
+    "in vec2 v_uv;\n"
+    "in vec4 v_col;\n"
+    "uniform sampler2D u_atlas;\n"
+    "uniform int u_textured;\n"
+    "out vec4 o_color;\n"
+    "void main() { o_color = u_textured != 0 ? v_col * texture(u_atlas, v_uv) : v_col; }\n";
+
+/* Uniforms del programa, en el orden de GL_UNIFORM_NAMES. */
+typedef enum
+{
+    GU_LAYER = 0,
+    GU_QUADS,
+    GU_MIRN,
+    GU_NUCA,
+    GU_CENTER,
+    GU_VIEW,
+    GU_FLIP,
+    GU_SPLAT_R,
+    GU_COS,
+    GU_SIN,
+    GU_ALPHA,
+    GU_DISC,
+    GU_RADIAL,
+    GU_TEXTURED,
+    GU_ATLAS,
+    GU_COUNT
+} GlUniform;
+
+static const char *const GL_UNIFORM_NAMES[GU_COUNT] = {
+    "u_layer", "u_quads", "u_mirN", "u_nuca", "u_center", "u_view", "u_flip", "u_splat_r",
+    "u_cos", "u_sin", "u_alpha", "u_disc", "u_radial", "u_textured", "u_atlas"};
+
+/*
+ * GlSprites: programa, VAO con los atributos por instancia, buffer de
+ * instancias (crece, se huerfaniza cada frame) y atlas propio (mismas UV que
+ * SpriteBatch).
+ */
+typedef struct
+{
+    GlApi gl;
+    GLuint prog, vao, vbo, atlas;
+    GLint u[GU_COUNT];
+    size_t vbo_bytes;     // Capacidad actual del buffer de instancias
+    SDL_FRect disc_uv[6]; // UV del disco de radio r (índice = r)
+    SDL_FRect radial_uv;
+    DrawParams dp; // Parámetros del frame (draw_params_init)
+} GlSprites;
+
+/* Estado GL que SDL cachea y que --backend gl toca; se restaura tras dibujar. */
+typedef struct
+{
+    GLint prog, vao, buf, tex, active, unpack_row;
+    GLint src_rgb, dst_rgb, src_a, dst_a;
+    GLboolean blend;
+} GlSaved;
+
+static void gl_save(const GlApi *gl, GlSaved *s)
+{
+    gl->GetIntegerv(GL_CURRENT_PROGRAM, &s->prog);
+    gl->GetIntegerv(GL_VERTEX_ARRAY_BINDING, &s->vao);
+    gl->GetIntegerv(GL_ARRAY_BUFFER_BINDING, &s->buf);
+    gl->GetIntegerv(GL_ACTIVE_TEXTURE, &s->active);
+    gl->ActiveTexture(GL_TEXTURE0);
+    gl->GetIntegerv(GL_TEXTURE_BINDING_2D, &s->tex);
+    gl->GetIntegerv(GL_UNPACK_ROW_LENGTH, &s->unpack_row);
+    gl->GetIntegerv(GL_BLEND_SRC_RGB, &s->src_rgb);
+    gl->GetIntegerv(GL_BLEND_DST_RGB, &s->dst_rgb);
+    gl->GetIntegerv(GL_BLEND_SRC_ALPHA, &s->src_a);
+    gl->GetIntegerv(GL_BLEND_DST_ALPHA, &s->dst_a);
+    s->blend = gl->IsEnabled(GL_BLEND);
+}
+
+static void gl_restore(const GlApi *gl, const GlSaved *s)
+{
+    gl->UseProgram((GLuint)s->prog);
+    gl->BindVertexArray((GLuint)s->vao);
+    gl->BindBuffer(GL_ARRAY_BUFFER, (GLuint)s->buf);
+    gl->BindTexture(GL_TEXTURE_2D, (GLuint)s->tex);
+    gl->ActiveTexture((GLenum)s->active);
+    gl->PixelStorei(GL_UNPACK_ROW_LENGTH, s->unpack_row);
+    gl->BlendFuncSeparate((GLenum)s->src_rgb, (GLenum)s->dst_rgb, (GLenum)s->src_a, (GLenum)s->dst_a);
+    if (s->blend)
+        gl->Enable(GL_BLEND);
+    else
+        gl->Disable(GL_BLEND);
+}
+
+/** Compila un shader (#version y constantes + src); 0 con el log en stderr si falla. */
+static GLuint gl_compile(const GlApi *gl, GLenum kind, const char *src)
+{
+    char head[160];
+    snprintf(head, sizeof(head), "#version 330 core\n#define POS_SCALE %.9f\n#define LOD_SPLAT_DIV %d\n", GL_POS_SCALE, LOD_SPLAT_DIV);
+    const GLchar *parts[2] = {head, src};
+    GLuint sh = gl->CreateShader(kind);
+    gl->ShaderSource(sh, 2, parts, NULL);
+    gl->CompileShader(sh);
+    GLint ok = 0;
+    gl->GetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+    if (!ok)
+    {
+        char log[1024] = {0};
+        gl->GetShaderInfoLog(sh, sizeof(log) - 1, NULL, log);
+        fprintf(stderr, "--backend gl: error en el %s shader:\n%s\n", kind == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+        gl->DeleteShader(sh);
+        return 0;
+    }
+    return sh;
+}
+
+/** Libera programa, buffers y atlas (con el contexto de ren activo); acepta NULL. */
+static void gl_sprites_free(GlSprites *g)
+{
+    if (!g)
+        return;
+    const GlApi *gl = &g->gl;
+    if (g->vbo)
+        gl->DeleteBuffers(1, &g->vbo);
+    if (g->vao)
+        gl->DeleteVertexArrays(1, &g->vao);
+    if (g->atlas)
+        gl->DeleteTextures(1, &g->atlas);
+    if (g->prog)
+        gl->DeleteProgram(g->prog);
+    free(g);
+}
+
+/**
+ * Prepara --backend gl sobre ren: exige el renderer "opengl" con contexto
+ * 3.3+ (instancing y GLSL 330), carga las funciones, compila el programa y
+ * sube el atlas. NULL con el motivo en stderr si algo falla.
+ */
+static GlSprites *gl_sprites_create(SDL_Renderer *ren)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(ren, &info) != 0)
+        info.name = "?";
+    if (strcmp(info.name, "opengl") != 0)
+    {
+        fprintf(stderr, "--backend gl: requiere el renderer \"opengl\" de SDL (hay \"%s\"; headless usa software)\n", info.name);
+        return NULL;
+    }
+    GlSprites *g = (GlSprites *)calloc(1, sizeof(GlSprites));
+    if (!g)
+        return NULL;
+    GlApi *gl = &g->gl;
+    bool ok = true;
+#define GL_API_LOAD(ret, name, args) ok = ok && (gl->name = (ret(APIENTRY *) args)SDL_GL_GetProcAddress("gl" #name)) != NULL;
+    GL_API(GL_API_LOAD)
+#undef GL_API_LOAD
+    GLint major = 0, minor = 0;
+    if (ok)
+    {
+        gl->GetIntegerv(GL_MAJOR_VERSION, &major);
+        gl->GetIntegerv(GL_MINOR_VERSION, &minor);
+    }
+    if (!ok || major * 10 + minor < 33)
+    {
+        fprintf(stderr, "--backend gl: el contexto de SDL no es OpenGL 3.3+ (%s)\n",
+                ok ? (const char *)gl->GetString(GL_VERSION) : "faltan funciones");
+        free(g);
+        return NULL;
+    }
+
+    SDL_RenderFlush(ren);
+    GlSaved saved;
+    gl_save(gl, &saved);
+    GLuint vs = gl_compile(gl, GL_VERTEX_SHADER, GL_VERT_SRC), fs = gl_compile(gl, GL_FRAGMENT_SHADER, GL_FRAG_SRC);
+    if (vs && fs)
+    {
+        g->prog = gl->CreateProgram();
+        gl->AttachShader(g->prog, vs);
+        gl->AttachShader(g->prog, fs);
+        gl->LinkProgram(g->prog);
+        GLint linked = 0;
+        gl->GetProgramiv(g->prog, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            char log[1024] = {0};
+            gl->GetProgramInfoLog(g->prog, sizeof(log) - 1, NULL, log);
+            fprintf(stderr, "--backend gl: error al enlazar:\n%s\n", log);
+            ok = false;
+        }
+    }
+    else
+    {
+        ok = false;
+    }
+    if (vs)
+        gl->DeleteShader(vs);
+    if (fs)
+        gl->DeleteShader(fs);
+
+    SDL_Surface *s = ok ? atlas_surface(g->disc_uv, &g->radial_uv) : NULL;
+    if (s)
+    {
+        for (int k = 0; k < GU_COUNT; ++k)
+            g->u[k] = gl->GetUniformLocation(g->prog, GL_UNIFORM_NAMES[k]);
+        gl->GenTextures(1, &g->atlas);
+        gl->BindTexture(GL_TEXTURE_2D, g->atlas);
+        gl->PixelStorei(GL_UNPACK_ROW_LENGTH, s->pitch / 4);
+        gl->TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, s->w, s->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, s->pixels);
+        gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        SDL_FreeSurface(s);
+
+        // Atributos por instancia (divisor 1); los punteros se rebasan por capa en gl_draw_range
+        gl->GenVertexArrays(1, &g->vao);
+        gl->GenBuffers(1, &g->vbo);
+        gl->BindVertexArray(g->vao);
+        gl->BindBuffer(GL_ARRAY_BUFFER, g->vbo);
+        for (GLuint a = 0; a < 3; ++a)
+        {
+            gl->EnableVertexAttribArray(a);
+            gl->VertexAttribDivisor(a, 1);
+        }
+    }
+    else if (ok)
+    {
+        ok = false;
+        fprintf(stderr, "--backend gl: sin memoria para el atlas\n");
+    }
+    gl_restore(gl, &saved);
+    if (!ok)
+    {
+        gl_sprites_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+/* Modos de SDL: BLEND (alpha sobre destino) y ADD (suma ponderada por alpha, destino conserva su alpha). */
+static void gl_blend(const GlApi *gl, SDL_BlendMode mode)
+{
+    if (mode == SDL_BLENDMODE_ADD)
+        gl->BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ZERO, GL_ONE);
+    else
+        gl->BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/** Dibuja la capa layer de las instancias [j0,j1): una llamada instanciada (retorna 1, o 0 si no hay). */
+static int gl_draw_range(const GlSprites *g, int layer, int j0, int j1)
+{
+    if (j0 >= j1)
+        return 0;
+    const GlApi *gl = &g->gl;
+    const DrawParams *dp = &g->dp;
+    const int quads = layer < LAYER_COUNT ? LAYER_QUADS[layer] : 1;
+    const char *base = (const char *)((size_t)j0 * sizeof(GlInstance));
+    gl->VertexAttribPointer(0, 2, GL_POS_TYPE, GL_FALSE, sizeof(GlInstance), base + offsetof(GlInstance, dx0));
+    gl->VertexAttribPointer(1, 2, GL_POS_TYPE, GL_FALSE, sizeof(GlInstance), base + offsetof(GlInstance, dxp));
+    gl->VertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GlInstance), base + GL_COL_OFFSET);
+    gl->Uniform1i(g->u[GU_LAYER], layer);
+    gl->Uniform1i(g->u[GU_QUADS], quads);
+    gl->Uniform1i(g->u[GU_TEXTURED], layer != LAYER_TRAIL);
+    gl_blend(gl, layer == LAYER_TRAIL && dp->glow_on ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_BLEND);
+    gl->DrawArraysInstanced(GL_TRIANGLES, 0, 6 * dp->copies * quads, j1 - j0);
+    return 1;
+}
+
+/** Empaqueta la lista de dibujo (una de cada dp->step entradas de pc) en dst. */
+static void gl_pack(GlInstance *dst, const Precomp *pc, const DrawParams *dp, int ndraw)
+{
+    const int step = dp->step;
+#ifndef PRECOMP_FLOAT
+    if (step == 1)
+    {
+        memcpy(dst, pc, sizeof(Precomp) * (size_t)ndraw);
+        return;
+    }
+#else
+    const int end_full = dp->nuc + dp->full;
+#endif
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int j = 0; j < ndraw; ++j)
+    {
+#ifdef PRECOMP_FLOAT
+        const PcVals v = pc_load(&pc[(size_t)j * step]);
+        dst[j] = (GlInstance){v.dx0, v.dy0, v.dxp, v.dyp, v.r, v.g, v.b, j >= end_full ? v.w : (Uint8)v.pr};
+#else
+        dst[j] = pc[(size_t)j * step];
+#endif
+    }
+}
+
+/**
+ * Dibuja la lista de pc (n entradas; lc != NULL: lista de --lod 1) con
+ * simetrías symN sobre el destino actual de ren: sube ndraw GlInstance y
+ * lanza una llamada instanciada por capa, en el orden de batch_flush.
+ * Retorna las llamadas de dibujo.
+ */
+static int gl_draw(SDL_Renderer *ren, GlSprites *g, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, int symN,
+                    int W, int H)
+{
+    DrawParams *dp = &g->dp;
+    draw_params_init(dp, cfg, symN, cfg->mirror, W * 0.5f, H * 0.5f);
+    const int ndraw = draw_params_list(dp, n, lc);
+    if (ndraw <= 0)
+        return 0;
+    const GlApi *gl = &g->gl;
+    int calls = 0;
+    SDL_RenderFlush(ren);
+    GlSaved saved;
+    gl_save(gl, &saved);
+    gl->UseProgram(g->prog);
+    gl->BindVertexArray(g->vao);
+    gl->BindBuffer(GL_ARRAY_BUFFER, g->vbo);
+
+    // Buffer huérfano en cada frame: el driver no espera al frame anterior
+    size_t bytes = sizeof(GlInstance) * (size_t)ndraw;
+    if (bytes > g->vbo_bytes)
+        g->vbo_bytes = bytes;
+    gl->BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)g->vbo_bytes, NULL, GL_STREAM_DRAW);
+    GlInstance *dst = (GlInstance *)gl->MapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes,
+                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst)
+    {
+        gl_pack(dst, pc, dp, ndraw);
+        gl->UnmapBuffer(GL_ARRAY_BUFFER);
+
+        float alpha[5] = {dp->trailA / 255.0f, dp->tailA[1] / 255.0f, dp->tailA[2] / 255.0f, dp->haloA / 255.0f, dp->nucA / 255.0f};
+        float disc[16] = {0}, radial[4] = {g->radial_uv.x, g->radial_uv.y, g->radial_uv.w, g->radial_uv.h};
+        for (int r = 1; r <= 3; ++r)
+            memcpy(&disc[4 * r], &g->disc_uv[r], sizeof(SDL_FRect));
+        gl->Uniform1i(g->u[GU_MIRN], dp->mirN);
+        gl->Uniform1i(g->u[GU_NUCA], dp->nucA);
+        gl->Uniform2f(g->u[GU_CENTER], dp->cx, dp->cy);
+        gl->Uniform2f(g->u[GU_VIEW], (float)W, (float)H);
+        gl->Uniform1f(g->u[GU_FLIP], SDL_GetRenderTarget(ren) ? -1.0f : 1.0f);
+        gl->Uniform1f(g->u[GU_SPLAT_R], (float)LOD_SPLAT_R);
+        gl->Uniform1fv(g->u[GU_COS], dp->symN, dp->cosA);
+        gl->Uniform1fv(g->u[GU_SIN], dp->symN, dp->sinA);
+        gl->Uniform1fv(g->u[GU_ALPHA], 5, alpha);
+        gl->Uniform4fv(g->u[GU_DISC], 4, disc);
+        gl->Uniform4fv(g->u[GU_RADIAL], 1, radial);
+        gl->Uniform1i(g->u[GU_ATLAS], 0);
+        gl->BindTexture(GL_TEXTURE_2D, g->atlas);
+        gl->Enable(GL_BLEND);
+
+        // Capas como batch_flush; el halo separa partículas (radio) y splats (w)
+        const int end_full = dp->nuc + dp->full;
+        for (int l = 0; l < LAYER_COUNT; ++l)
+        {
+            int a, z;
+            draw_layer_range(dp, l, &a, &z);
+            calls += gl_draw_range(g, l, a, z < end_full ? z : end_full);
+            if (l == LAYER_HALO)
+                calls += gl_draw_range(g, GL_LAYER_SPLAT, a > end_full ? a : end_full, z);
+        }
+    }
+    gl_restore(gl, &saved);
+    return calls;
+}
+
+// ------------------------ Dibujo de partículas (GPU) ------------------------
+
+/**
+ * Dibuja todas las partículas con simetría y espejo, usando:
+ *   - sprites de discos (núcleo y colitas),
+ *   - sprite radial para halo (si glow),
+ *   - líneas de estela larga opcionales.
+ * Respeta cfg.render_frac (salta partículas para acelerar) y ajusta alphas
+ * según la cantidad de copias (simetrías * espejos). Con lc != NULL, pc es
+ * la lista de dibujo de --lod 1 (n entradas, sin salto): las de solo núcleo
+ * omiten estela, colitas y halo, y los splats se dibujan con el halo radial.
+ * Retorna las llamadas de dibujo (una por sprite o línea).
+ */
+static int draw_particles(SDL_Renderer *ren, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, int symN, int mirror, float cx, float cy,
+                           SDL_Texture **discs, SDL_Texture *radial)
+{
+    float cosA[8], sinA[8];
+    if (symN < 1)
+        symN = 1;
+    if (symN > 8)
+        symN = 8;
+    for (int m = 0; m < symN; ++m)
+    {
+        float ang = 2.0f * (float)M_PI * (float)m / (float)symN;
+        cosA[m] = cosf(ang);
+        sinA[m] = sinf(ang);
+    }
+    float alpha_div = (float)((mirror ? 2 : 1) * symN);
+    int glow_on = cfg->glow ? 1 : 0;
+
+    // Paso de muestreo para omitir partículas (solo dibujo) manteniendo la física completa
+    int step = (lc || cfg->render_frac >= 0.999f) ? 1 : (int)lroundf(1.0f / cfg->render_frac);
+    if (step < 1)
+        step = 1;
+    const int lod_nuc = lc ? lc->nuc : 0, lod_end_full = lc ? lc->nuc + lc->full : n;
+    int calls = 0;
+
+    for (int i = 0; i < n; i += step)
+    {
+        const PcVals pv = pc_load(&pc[i]);
+        Uint8 rr = pv.r, gg = pv.g, bb = pv.b;
+        float dx0 = pv.dx0, dy0 = pv.dy0;
+        float dxp = pv.dxp, dyp = pv.dyp;
+        int pr = pv.pr;
+
+        // Alphas base ajustados por cantidad de copias y glow
+        float a_scale = glow_on ? 1.0f : 0.6f;
+        Uint8 trailA = (Uint8)fmaxf(4.0f, (90.0f * a_scale) / alpha_div);
+        Uint8 tailA0 = (Uint8)fmaxf(3.0f, (34.0f * a_scale) / alpha_div);
+        Uint8 haloA = glow_on ? (Uint8)fmaxf(8.0f, 50.0f / alpha_div) : 0;
+        Uint8 nucA = (Uint8)fmaxf(70.0f, (185.0f + 50.0f * 0.5f) / alpha_div);
+
+        if (i >= lod_end_full)
+        {
+            // Splat de densidad: un halo radial por copia
+            int a = nucA * pv.w / LOD_SPLAT_DIV;
+            pr = LOD_SPLAT_R;
+            SDL_SetTextureColorMod(radial, rr, gg, bb);
+            SDL_SetTextureAlphaMod(radial, (Uint8)(a < 8 ? 8 : (a > 200 ? 200 : a)));
+            for (int m = 0; m < symN; ++m)
+            {
+                float xr = cx + dx0 * cosA[m] - dy0 * sinA[m];
+                float yr = cy + dx0 * sinA[m] + dy0 * cosA[m];
+                for (int mir = 0; mir < (mirror ? 2 : 1); ++mir)
+                {
+                    float X = mir ? (2.0f * cx - xr) : xr;
+                    SDL_FRect srct = {X - (float)pr, yr - (float)pr, (float)(pr * 2), (float)(pr * 2)};
+                    SDL_RenderCopyF(ren, radial, NULL, &srct);
+                    calls++;
+                }
+            }
+            continue;
+        }
+        const bool full = i >= lod_nuc;
+        if (pr < 1)
+            pr = 1;
+        if (pr > 3)
+            pr = 3;
+
+        SDL_Texture *dot = discs[pr];
+
+        // Repite por cada rotación de simetría y espejo vertical opcional
+        for (int m = 0; m < symN; ++m)
+        {
+            float xr = cx + dx0 * cosA[m] - dy0 * sinA[m];
+            float yr = cy + dx0 * sinA[m] + dy0 * cosA[m];
+            float xpr = cx + dxp * cosA[m] - dyp * sinA[m];
+            float ypr = cy + dxp * sinA[m] + dyp * cosA[m];
+
+            for (int mir = 0; mir < (mirror ? 2 : 1); ++mir)
+            {
+                float X = mir ? (2.0f * cx - xr) : xr;
+                float Y = yr;
+                float XP = mir ? (2.0f * cx - xpr) : xpr;
+                float YP = ypr;
+
+                // Estela larga opcional (línea)
+                if (cfg->trail == TRAIL_LINES && full)
+                {
+                    SDL_SetRenderDrawBlendMode(ren, glow_on ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_BLEND);
+                    SDL_SetRenderDrawColor(ren, rr, gg, bb, trailA);
+                    SDL_RenderDrawLine(ren, (int)lroundf(XP), (int)lroundf(YP), (int)lroundf(X), (int)lroundf(Y));
+                    calls++;
+                }
+
+                // Colitas de 2 discos (puntos intermedios entre pos previa y actual)
+                float ddx = X - XP, ddy = Y - YP;
+                for (int c = 1; c <= 2 && full; ++c)
+                {
+                    float tpos = (float)c / 4.0f;
+                    float cxp = X - ddx * tpos, cyp = Y - ddy * tpos;
+                    Uint8 ca = (Uint8)fmaxf(3.0f, (float)tailA0 / (float)c);
+                    int pr2 = (pr - c >= 1) ? (pr - c) : 1;
+                    SDL_SetTextureColorMod(discs[pr2], rr, gg, bb);
+                    SDL_SetTextureAlphaMod(discs[pr2], ca);
+                    SDL_FRect rct = {(float)(cxp - pr2), (float)(cyp - pr2), (float)(pr2 * 2 + 1), (float)(pr2 * 2 + 1)};
+                    SDL_RenderCopyF(ren, discs[pr2], NULL, &rct);
+                    calls++;
+                }
+
+                // Halo radial (si glow activo)
+                if (haloA > 0 && full)
+                {
+                    SDL_SetTextureColorMod(radial, rr, gg, bb);
+                    SDL_SetTextureAlphaMod(radial, haloA);
+                    float hr = (float)(pr + 2);
+                    SDL_FRect hrct = {(float)(X - hr), (float)(Y - hr), hr * 2.0f, hr * 2.0f};
+                    SDL_RenderCopyF(ren, radial, NULL, &hrct);
+                    calls++;
+                }
+
+                // Núcleo del punto
+                SDL_SetTextureColorMod(dot, rr, gg, bb);
+                SDL_SetTextureAlphaMod(dot, nucA);
+                SDL_FRect rct = {(float)(X - pr), (float)(Y - pr), (float)(pr * 2 + 1), (float)(pr * 2 + 1)};
+                SDL_RenderCopyF(ren, dot, NULL, &rct);
+                calls++;
+            }
+        }
+    }
+    return calls;
+}
+
+/**
+ * Versión por lotes de draw_particles (--batch 1), con los parámetros de
+ * batch_begin_frame. Si el pre-cálculo ya emitió el frame (b->ready) solo
+ * envía; si no cupo en el presupuesto, emite por tandas de cap_slots copias,
+ * cada una en paralelo por bloques, y envía tras cada tanda. Retorna las
+ * llamadas de dibujo.
+ */
+static int draw_particles_batched(SDL_Renderer *ren, const Precomp *pc, int n, SpriteBatch *b)
+{
+    if (b->ready)
+        return batch_flush(ren, b, 0, b->ndraw);
+    const int per_batch = b->cap_slots / b->dp.copies;
+    int calls = 0;
+    for (int j0 = 0; j0 < b->ndraw; j0 += per_batch)
+    {
+        int j1 = j0 + per_batch < b->ndraw ? j0 + per_batch : b->ndraw;
+        batch_emit_list(b, pc, n, j0, j1);
+        calls += batch_flush(ren, b, j0, j1);
+    }
+    return calls;
+}
+
+/** Guías de atractores (--show-attractors): rectángulo aditivo por atractor (una llamada cada uno); x0 = borde izquierdo de la vista. */
+static void draw_attractors(SDL_Renderer *ren, const Config *cfg, const float *atx, const float *aty, int na, float x0, float t)
+{
+    for (int k = 0; k < na; ++k)
+    {
+        Uint8 rr, gg, bb;
+        palette_attractor_color(cfg->palette_id, k, t, &rr, &gg, &bb);
+        SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_ADD);
+        SDL_SetRenderDrawColor(ren, rr, gg, bb, 24);
+        SDL_FRect rct = {atx[k] - x0 - 14, aty[k] - 14, 28, 28};
+        SDL_RenderDrawRectF(ren, &rct);
+    }
+}
+
+/**
+ * Renderiza un frame completo:
+ *  1) Aplica fade con tinte de fondo por paleta (con --trail 2 es lo único
+ *     que produce la estela: decae lo acumulado en el destino persistente).
+ *  2) Dibuja partículas con simetrías y espejo (instanciadas si gl != NULL;
+ *     por lotes si batch != NULL, y en ese caso simetrías, centro y lista
+ *     salen de batch_begin_frame y batch_set_list). lc != NULL: pc es la
+ *     lista de dibujo de --lod 1.
+ *  3) Opcional: dibuja guías/rectángulos de atractores.
+ * W x H es la vista y x0 su columna en el mundo (--outputs: cfg->outputs
+ * vistas contiguas de W px; con una sola, x0 = 0 y el centro es el de la vista).
+ * Retorna las llamadas de dibujo del frame.
+ */
+static int render_frame(SDL_Renderer *ren, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, const float *atx, const float *aty, int na,
+                         int W, int H, float x0, float t, int draw_sym, SDL_Texture **discs, SDL_Texture *radial, SpriteBatch *batch,
+                         GlSprites *gl)
+{
+    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+    SDL_Rect full = {0, 0, W, H};
+    RGBA tint = palette_bg_tint(cfg, t);
+    SDL_SetRenderDrawColor(ren, tint.r, tint.g, tint.b, tint.a);
+    SDL_RenderFillRect(ren, &full);
+    int calls = 1;
+
+    if (gl)
+        calls += gl_draw(ren, gl, cfg, pc, n, lc, draw_sym, W, H);
+    else if (batch)
+        calls += draw_particles_batched(ren, pc, n, batch);
+    else
+        calls += draw_particles(ren, cfg, pc, n, lc, draw_sym, cfg->mirror, (float)(cfg->outputs * W) * 0.5f - x0, H * 0.5f, discs, radial);
+
+    if (cfg->show_attractors)
+    {
+        draw_attractors(ren, cfg, atx, aty, na, x0, t);
+        calls += na;
+    }
+    return calls;
+}
+
+// ------------------------ Rasterizador por CPU (--backend cpu) ------------------------
+
+#define CPU_TILE 64 // Lado del tile (px del framebuffer); cada tile lo compone un solo hilo
+
+/* x / 255 redondeado para x en [0, 255*255] (mezcla en enteros). */
+#define DIV255(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+#define SWAR_LO 0x00FF00FFu // Bytes 0 y 2 de un píxel de 32 bits (dos canales por operación)
+
+/*
+ * CpuRaster: framebuffer RGBA32 de (outW*ssaa) x (outH*ssaa) que persiste
+ * entre frames (el fade acumula la estela, como el render target de SDL),
+ * máscaras alpha de los mismos sprites que make_disc_texture/make_radial_texture
+ * y bins por tile (CellBins con celdas de CPU_TILE px): los ítems del tile t
+ * son los slots (j * copias + copia, como en SpriteBatch) que lo tocan, en
+ * orden de dibujo. El supersampling no sale de la CPU: se reduce aquí antes de subir.
+ */
+typedef struct
+{
+    int W, H;                 // Salida (outW x outH)
+    int scale, FW, FH;        // Factor SSAA y tamaño del framebuffer
+    Uint32 *fb;               // FW * FH píxeles; bytes R,G,B,A en memoria (RGBA32)
+    Uint8 *out;               // W * H * 4 tras reducir SSAA (NULL si scale == 1)
+    CellBins bins;            // Slots por tile (bins.gx x bins.gy tiles)
+    DrawParams dp;            // Parámetros del frame (draw_params_init)
+    int ndraw;                // Partículas dibujadas en el frame
+    Uint8 disc_a[6][11 * 11]; // Máscaras de disco r=1..5 (lado 2r+1)
+    Uint8 radial_a[ATLAS_RADIAL * ATLAS_RADIAL];
+    SDL_Texture *tex;         // Textura streaming W x H (SDL_UpdateTexture)
+} CpuRaster;
+
+/** Libera framebuffer, bins y textura; acepta NULL. */
+static void cpu_raster_free(CpuRaster *cr)
+{
+    if (!cr)
+        return;
+    if (cr->tex)
+        SDL_DestroyTexture(cr->tex);
+    free(cr->fb);
+    free(cr->out);
+    cell_bins_free(&cr->bins);
+    free(cr);
+}
+
+/**
+ * Reserva el framebuffer para el factor newk (1..4) si cambió; el contenido
+ * arranca en negro. Si no hay memoria cae a 1 (como set_ssaa). Deja en *ssaa,
+ * *RW y *RH el factor y tamaño efectivos; false si ni siquiera cupo 1x.
+ */
+static bool cpu_raster_set_ssaa(CpuRaster *cr, int newk, int *ssaa, int *RW, int *RH)
+{
+    if (newk < 1)
+        newk = 1;
+    if (newk > 4)
+        newk = 4;
+    if (cr->fb && newk == cr->scale)
+        return true;
+    for (;;)
+    {
+        free(cr->fb);
+        free(cr->out);
+        cr->scale = newk;
+        cr->FW = cr->W * newk;
+        cr->FH = cr->H * newk;
+        cr->fb = (Uint32 *)calloc((size_t)cr->FW * cr->FH, 4);
+        cr->out = newk > 1 ? (Uint8 *)malloc((size_t)cr->W * cr->H * 4) : NULL;
+        bool bins_ok = cell_bins_resize(&cr->bins, (cr->FW + CPU_TILE - 1) / CPU_TILE, (cr->FH + CPU_TILE - 1) / CPU_TILE);
+        if (cr->fb && (newk == 1 || cr->out) && bins_ok)
+            break;
+        if (newk == 1)
+            return false;
+        fprintf(stderr, "Sin memoria para framebuffer SSAA=%d (%dx%d). Sin SSAA.\n", newk, cr->FW, cr->FH);
+        newk = 1;
+    }
+    *ssaa = cr->scale;
+    *RW = cr->FW;
+    *RH = cr->FH;
+    return true;
+}
+
+/**
+ * Crea el rasterizador para una salida W x H: máscaras de sprites y textura
+ * streaming. El framebuffer se reserva con cpu_raster_set_ssaa. NULL si falla.
+ */
+static CpuRaster *cpu_raster_create(SDL_Renderer *ren, int W, int H)
+{
+    CpuRaster *cr = (CpuRaster *)calloc(1, sizeof(CpuRaster));
+    if (!cr)
+        return NULL;
+    cr->W = W;
+    cr->H = H;
+    for (int r = 1; r <= 5; ++r)
+    {
+        int D = r * 2 + 1;
+        for (int y = 0; y < D; ++y)
+            for (int x = 0; x < D; ++x)
+                cr->disc_a[r][y * D + x] = disc_alpha(r, x, y);
+    }
+    for (int y = 0; y < ATLAS_RADIAL; ++y)
+        for (int x = 0; x < ATLAS_RADIAL; ++x)
+            cr->radial_a[y * ATLAS_RADIAL + x] = radial_alpha(ATLAS_RADIAL, x, y);
+    cr->tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, W, H);
+    if (!cr->tex)
+    {
+        cpu_raster_free(cr);
+        return NULL;
+    }
+    return cr;
+}
+
+/** Posición actual y previa de la copia `copy` de p (misma fórmula que batch_emit_range). */
+static inline void cpu_copy_pos(const DrawParams *dp, const PcVals *p, int copy, float *X, float *Y, float *XP, float *YP)
+{
+    int m = copy / dp->mirN, mir = copy - m * dp->mirN;
+    float xr = dp->cx + p->dx0 * dp->cosA[m] - p->dy0 * dp->sinA[m];
+    float yr = dp->cy + p->dx0 * dp->sinA[m] + p->dy0 * dp->cosA[m];
+    float xpr = dp->cx + p->dxp * dp->cosA[m] - p->dyp * dp->sinA[m];
+    float ypr = dp->cy + p->dxp * dp->sinA[m] + p->dyp * dp->cosA[m];
+    *X = mir ? (2.0f * dp->cx - xr) : xr;
+    *Y = yr;
+    *XP = mir ? (2.0f * dp->cx - xpr) : xpr;
+    *YP = ypr;
+}
+
+/** Radio de núcleo acotado a [1,3] (igual que el dibujo por SDL). */
+static inline int cpu_pr(const PcVals *p)
+{
+    return p->pr < 1 ? 1 : (p->pr > 3 ? 3 : p->pr);
+}
+
+/**
+ * Rango de tiles [*t0x,*t1x] x [*t0y,*t1y] que toca el slot (estela, colitas y
+ * halo caben en la caja de X,XP ± pr+3; un splat en X ± LOD_SPLAT_R+1). false si
+ * queda fuera de pantalla.
+ */
+static inline bool cpu_slot_tiles(const CpuRaster *cr, const Precomp *pc, int slot, int *t0x, int *t1x, int *t0y, int *t1y)
+{
+    const DrawParams *dp = &cr->dp;
+    int j = slot / dp->copies;
+    const PcVals pv = pc_load(&pc[(size_t)j * dp->step]);
+    float X, Y, XP, YP;
+    cpu_copy_pos(dp, &pv, slot - j * dp->copies, &X, &Y, &XP, &YP);
+    float ext = (float)(j >= dp->nuc + dp->full ? LOD_SPLAT_R + 1 : cpu_pr(&pv) + 3), s = (float)cr->scale;
+    float x0 = (fminf(X, XP) - ext) * s, x1 = (fmaxf(X, XP) + ext) * s;
+    float y0 = (fminf(Y, YP) - ext) * s, y1 = (fmaxf(Y, YP) + ext) * s;
+    if (!(x1 >= 0.0f && y1 >= 0.0f && x0 < (float)cr->FW && y0 < (float)cr->FH))
+        return false; // También descarta NaN
+    *t0x = x0 < 0.0f ? 0 : (int)x0 / CPU_TILE;
+    *t0y = y0 < 0.0f ? 0 : (int)y0 / CPU_TILE;
+    *t1x = x1 >= (float)(cr->FW - 1) ? cr->bins.gx - 1 : (int)x1 / CPU_TILE;
+    *t1y = y1 >= (float)(cr->FH - 1) ? cr->bins.gy - 1 : (int)y1 / CPU_TILE;
+    return true;
+}
+
+/** Contexto de cpu_slot_range: rasterizador y pre-cálculo del frame. */
+typedef struct
+{
+    const CpuRaster *cr;
+    const Precomp *pc;
+} CpuBinCtx;
+
+/** CellRangeFn del binning por tiles (cpu_slot_tiles). */
+static inline bool cpu_slot_range(const void *ctx, int slot, int *t0x, int *t1x, int *t0y, int *t1y)
+{
+    const CpuBinCtx *c = (const CpuBinCtx *)ctx;
+    return cpu_slot_tiles(c->cr, c->pc, slot, t0x, t1x, t0y, t1y);
+}
+
+/** Empaqueta (r,g,b,255) con el orden de bytes del framebuffer. */
+static inline Uint32 px_pack(int r, int g, int b)
+{
+    Uint8 c[4] = {(Uint8)r, (Uint8)g, (Uint8)b, 255};
+    Uint32 v;
+    memcpy(&v, c, 4);
+    return v;
+}
+
+/**
+ * Mezcla normal (SDL_BLENDMODE_BLEND) del color empaquetado c con alpha a
+ * sobre *p: dos canales por multiplicación de 32 bits, redondeo como DIV255.
+ */
+static inline void px_blend(Uint32 *p, Uint32 c, Uint32 a)
+{
+    Uint32 d = *p, ia = 255u - a;
+    Uint32 lo = (c & SWAR_LO) * a + (d & SWAR_LO) * ia + 0x00800080u;
+    Uint32 hi = ((c >> 8) & SWAR_LO) * a + ((d >> 8) & SWAR_LO) * ia + 0x00800080u;
+    lo = ((lo + ((lo >> 8) & SWAR_LO)) >> 8) & SWAR_LO;
+    hi = ((hi + ((hi >> 8) & SWAR_LO)) >> 8) & SWAR_LO;
+    *p = lo | (hi << 8);
+}
+
+/** Mezcla aditiva saturada (SDL_BLENDMODE_ADD) de (r,g,b,a) sobre el píxel p. */
+static inline void px_add(Uint8 *p, int r, int g, int b, int a)
+{
+    int v0 = p[0] + DIV255(r * a), v1 = p[1] + DIV255(g * a), v2 = p[2] + DIV255(b * a);
+    p[0] = (Uint8)(v0 > 255 ? 255 : v0);
+    p[1] = (Uint8)(v1 > 255 ? 255 : v1);
+    p[2] = (Uint8)(v2 > 255 ? 255 : v2);
+}
+
+/* Rectángulo de recorte (tile) en píxeles del framebuffer: [x0,x1) x [y0,y1). */
+typedef struct
+{
+    int x0, y0, x1, y1;
+} CpuClip;
+
+/**
+ * Compone el sprite `mask` (md x md) escalado al cuadrado (qx,qy,side) en
+ * coordenadas lógicas, muestreo al vecino más cercano, modulado por color y
+ * alpha y recortado al tile.
+ */
+static inline void cpu_blit(const CpuRaster *cr, const CpuClip *c, float qx, float qy, float side,
+                            const Uint8 *mask, int md, Uint32 col, int a)
+{
+    const float s = (float)cr->scale;
+    float fx = qx * s, fy = qy * s, fs = side * s;
+    int px0 = (int)ceilf(fx - 0.5f), px1 = (int)ceilf(fx + fs - 0.5f);
+    int py0 = (int)ceilf(fy - 0.5f), py1 = (int)ceilf(fy + fs - 0.5f);
+    if (px0 < c->x0)
+        px0 = c->x0;
+    if (py0 < c->y0)
+        py0 = c->y0;
+    if (px1 > c->x1)
+        px1 = c->x1;
+    if (py1 > c->y1)
+        py1 = c->y1;
+    if (px0 >= px1)
+        return;
+    // Columna de textura por píxel: se calcula una vez por sprite (ancho <= CPU_TILE)
+    const float inv = (float)md / fs;
+    Uint8 ucol[CPU_TILE];
+    for (int px = px0; px < px1; ++px)
+    {
+        int u = (int)(((float)px + 0.5f - fx) * inv);
+        ucol[px - px0] = (Uint8)(u < 0 ? 0 : (u >= md ? md - 1 : u));
+    }
+    for (int py = py0; py < py1; ++py)
+    {
+        int v = (int)(((float)py + 0.5f - fy) * inv);
+        v = v < 0 ? 0 : (v >= md ? md - 1 : v);
+        const Uint8 *row = mask + v * md;
+        Uint32 *dst = cr->fb + (size_t)py * cr->FW + px0;
+        for (int k = 0; k < px1 - px0; ++k)
+        {
+            int ma = row[ucol[k]];
+            if (ma)
+                px_blend(dst + k, col, (Uint32)DIV255(ma * a));
+        }
+    }
+}
+
+/**
+ * Estela (XP,YP)-(X,Y): DDA sobre el eje mayor con un tramo de `scale` px en
+ * el eje menor (1 px lógico de ancho, cada píxel se toca una vez), recortada
+ * al tile. Blend aditivo con glow, como las líneas del modo SDL.
+ */
+static inline void cpu_line(const CpuRaster *cr, const CpuClip *c, float XP, float YP, float X, float Y,
+                            int r, int g, int b, int a, int add)
+{
+    const int s = cr->scale;
+    float x0 = XP * s, y0 = YP * s, dx = (X - XP) * s, dy = (Y - YP) * s;
+    bool xmajor = fabsf(dx) >= fabsf(dy);
+    float len = xmajor ? fabsf(dx) : fabsf(dy);
+    int n = len >= 1.0f ? (int)ceilf(len) : 1;
+    if (n > 4 * (cr->FW + cr->FH))
+        return; // Salto anómalo: no vale recorrerlo
+    for (int k = 0; k < n; ++k)
+    {
+        float f = (float)k / (float)n;
+        int mx = (int)floorf(x0 + dx * f), my = (int)floorf(y0 + dy * f);
+        int ax0 = mx, ax1 = mx + 1, ay0 = my, ay1 = my + 1;
+        if (xmajor)
+        {
+            ay0 = (int)floorf(y0 + dy * f - 0.5f * s + 0.5f);
+            ay1 = ay0 + s;
+        }
+        else
+        {
+            ax0 = (int)floorf(x0 + dx * f - 0.5f * s + 0.5f);
+            ax1 = ax0 + s;
+        }
+        if (ax0 < c->x0)
+            ax0 = c->x0;
+        if (ay0 < c->y0)
+            ay0 = c->y0;
+        if (ax1 > c->x1)
+            ax1 = c->x1;
+        if (ay1 > c->y1)
+            ay1 = c->y1;
+        for (int py = ay0; py < ay1; ++py)
+        {
+            Uint32 *dst = cr->fb + (size_t)py * cr->FW + ax0;
+            for (int px = ax0; px < ax1; ++px, ++dst)
+            {
+                if (add)
+                    px_add((Uint8 *)dst, r, g, b, a);
+                else
+                    px_blend(dst, px_pack(r, g, b), (Uint32)a);
+            }
+        }
+    }
+}
+
+/**
+ * Compone el tile t: fade con el tinte de fondo y luego las capas en el
+ * orden de --batch 1 (estela, colitas, halo, núcleo) para sus slots.
+ */
+static void cpu_raster_tile(const CpuRaster *cr, const Precomp *pc, int t, RGBA tint)
+{
+    const DrawParams *dp = &cr->dp;
+    CpuClip c;
+    c.x0 = (t % cr->bins.gx) * CPU_TILE;
+    c.y0 = (t / cr->bins.gx) * CPU_TILE;
+    c.x1 = c.x0 + CPU_TILE < cr->FW ? c.x0 + CPU_TILE : cr->FW;
+    c.y1 = c.y0 + CPU_TILE < cr->FH ? c.y0 + CPU_TILE : cr->FH;
+
+    if (tint.a > 0)
+    {
+        const Uint32 tc = px_pack(tint.r, tint.g, tint.b);
+        for (int py = c.y0; py < c.y1; ++py)
+        {
+            Uint32 *dst = cr->fb + (size_t)py * cr->FW;
+            for (int px = c.x0; px < c.x1; ++px)
+                px_blend(dst + px, tc, tint.a);
+        }
+    }
+
+    const Uint32 *it = cr->bins.items + cr->bins.start[t];
+    const int cnt = cr->bins.start[t + 1] - cr->bins.start[t];
+    const int end_full = dp->nuc + dp->full;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+    {
+        int lo, hi;
+        draw_layer_range(dp, l, &lo, &hi);
+        if (lo >= hi)
+            continue;
+        for (int k = 0; k < cnt; ++k)
+        {
+            int slot = (int)it[k], j = slot / dp->copies;
+            if (j < lo || j >= hi)
+                continue;
+            const PcVals pv = pc_load(&pc[(size_t)j * dp->step]);
+            const PcVals *p = &pv;
+            float X, Y, XP, YP;
+            cpu_copy_pos(dp, p, slot - j * dp->copies, &X, &Y, &XP, &YP);
+            int pr = cpu_pr(p);
+            Uint32 col = px_pack(p->r, p->g, p->b);
+            if (j >= end_full)
+            {
+                float sr = (float)LOD_SPLAT_R;
+                cpu_blit(cr, &c, X - sr, Y - sr, sr * 2.0f, cr->radial_a, ATLAS_RADIAL, col, splat_alpha(dp, p->w));
+            }
+            else if (l == LAYER_TRAIL)
+            {
+                cpu_line(cr, &c, XP, YP, X, Y, p->r, p->g, p->b, dp->trailA, dp->glow_on);
+            }
+            else if (l == LAYER_TAIL)
+            {
+                float ddx = X - XP, ddy = Y - YP;
+                for (int q = 1; q <= TAIL_QUADS; ++q)
+                {
+                    float tpos = (float)q / 4.0f;
+                    int pr2 = (pr - q >= 1) ? (pr - q) : 1;
+                    cpu_blit(cr, &c, X - ddx * tpos - pr2, Y - ddy * tpos - pr2, (float)(pr2 * 2 + 1),
+                             cr->disc_a[pr2], pr2 * 2 + 1, col, dp->tailA[q]);
+                }
+            }
+            else if (l == LAYER_HALO)
+            {
+                float hr = (float)(pr + 2);
+                cpu_blit(cr, &c, X - hr, Y - hr, hr * 2.0f, cr->radial_a, ATLAS_RADIAL, col, dp->haloA);
+            }
+            else
+            {
+                cpu_blit(cr, &c, X - pr, Y - pr, (float)(pr * 2 + 1), cr->disc_a[pr], pr * 2 + 1, col, dp->nucA);
+            }
+        }
+    }
+}
+
+/**
+ * Rasteriza un frame en el framebuffer: parámetros de dibujo, binning y
+ * composición de tiles en paralelo (schedule dynamic: la carga por tile
+ * depende de cuántas partículas caen en él). lc != NULL: pc es la lista de
+ * dibujo de --lod 1 con n entradas. Con perfil, los tiles son la región "tiles".
+ */
+static void cpu_raster_frame(CpuRaster *cr, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, int draw_sym, float t)
+{
+    draw_params_init(&cr->dp, cfg, draw_sym, cfg->mirror, cr->W * 0.5f, cr->H * 0.5f);
+    cr->ndraw = draw_params_list(&cr->dp, n, lc);
+    CpuBinCtx ctx = {cr, pc};
+    // Sin memoria para items: tiles vacíos, este frame solo hace el fade
+    cell_bins_build(&cr->bins, cr->ndraw * cr->dp.copies, cpu_slot_range, &ctx);
+    RGBA tint = palette_bg_tint(cfg, t);
+    const int ntiles = cr->bins.gx * cr->bins.gy;
+    ProfRegion reg, *r = NULL;
+    if (prof.on)
+    {
+        prof_region_begin(&reg, "tiles");
+        r = &reg;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int k = 0; k < ntiles; ++k)
+    {
+        uint64_t a = r ? SDL_GetPerformanceCounter() : 0;
+        cpu_raster_tile(cr, pc, k, tint);
+        if (r)
+            prof_block(r, a, SDL_GetPerformanceCounter());
+    }
+    if (r)
+        prof_region_end(r);
+}
+
+/** Imagen de salida W x H: el framebuffer o su reducción SSAA. */
+static const Uint8 *cpu_raster_image(const CpuRaster *cr)
+{
+    return cr->scale > 1 ? cr->out : (const Uint8 *)cr->fb;
+}
+
+/**
+ * Reduce el SSAA (promedio de caja scale x scale, en paralelo por filas),
+ * sube la imagen con SDL_UpdateTexture y la copia al backbuffer.
+ */
+static void cpu_raster_present(SDL_Renderer *ren, CpuRaster *cr)
+{
+    const int s = cr->scale;
+    if (s > 1)
+    {
+        const int W = cr->W, FW = cr->FW, area = s * s;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int y = 0; y < cr->H; ++y)
+        {
+            Uint8 *dst = cr->out + (size_t)y * W * 4;
+            for (int x = 0; x < W; ++x)
+            {
+                int acc[3] = {0, 0, 0};
+                for (int sy = 0; sy < s; ++sy)
+                {
+                    const Uint8 *src = (const Uint8 *)(cr->fb + (size_t)(y * s + sy) * FW + (size_t)x * s);
+                    for (int sx = 0; sx < s; ++sx, src += 4)
+                    {
+                        acc[0] += src[0];
+                        acc[1] += src[1];
+                        acc[2] += src[2];
+                    }
+                }
+                dst[4 * x + 0] = (Uint8)(acc[0] / area);
+                dst[4 * x + 1] = (Uint8)(acc[1] / area);
+                dst[4 * x + 2] = (Uint8)(acc[2] / area);
+                dst[4 * x + 3] = 255;
+            }
+        }
+    }
+    SDL_UpdateTexture(cr->tex, NULL, cpu_raster_image(cr), cr->W * 4);
+    SDL_RenderCopy(ren, cr->tex, NULL, NULL);
+}
+
+/** Guarda la última imagen de salida como PPM binario (P6). false si falla. */
+static bool cpu_raster_dump(const CpuRaster *cr, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+    fprintf(fp, "P6\n%d %d\n255\n", cr->W, cr->H);
+    const Uint8 *img = cpu_raster_image(cr);
+    for (size_t k = 0; k < (size_t)cr->W * cr->H; ++k)
+        fwrite(img + 4 * k, 1, 3, fp);
+    return fclose(fp) == 0;
+}
+
+// ------------------------ SSAA (Render Target escalado) ------------------------
+
+/**
+ * Configura (crea/destruye) el render target para SSAA al cambiar el factor.
+ * Ajusta RW,RH según outW/outH y ssaa. Si falla creación, cae a ssaa=1.
+ * Con keep_rt también hay RT con factor 1 (--record lee desde texturas;
+ * --trail 2 acumula la estela en él).
+ */
+static void set_ssaa(SDL_Renderer *ren, int outW, int outH, int newk, bool keep_rt,
+                     int *ssaa, SDL_Texture **rt, int *RW, int *RH)
+{
+    if (newk < 1)
+        newk = 1;
+    if (newk > 4)
+        newk = 4;
+    if (*rt && newk == *ssaa)
+        return; // No hace nada si ya coincide
+
+    if (*rt) // Destruye RT previo si existía
+    {
+        SDL_DestroyTexture(*rt);
+        *rt = NULL;
+    }
+    *ssaa = newk;
+    *RW = outW * (*ssaa);
+    *RH = outH * (*ssaa);
+    if (*ssaa > 1 || keep_rt)
+    {
+        *rt = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, *RW, *RH);
+        if (!*rt && *ssaa > 1)
+        {
+            fprintf(stderr, "No se pudo crear RT SSAA=%d (%dx%d). Sin SSAA.\n", *ssaa, *RW, *RH);
+            *ssaa = 1;
+            *RW = outW;
+            *RH = outH;
+            if (keep_rt)
+                *rt = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, *RW, *RH);
+        }
+    }
+    if (*rt) // Arranca en negro: con keep_rt el contenido persiste entre frames
+    {
+        SDL_SetRenderTarget(ren, *rt);
+        SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+        SDL_RenderClear(ren);
+        SDL_SetRenderTarget(ren, NULL);
+    }
+}
+
+// ------------------------ Grabación (--record) ------------------------
+
+#define REC_LAG 2   // Frames entre la copia a staging y su lectura (renderer de SDL)
+#define REC_SLOTS 4 // Imágenes en cola hacia el hilo codificador
+#define REC_FPS 60  // Cuadros por segundo declarados en el Y4M (1 / HEADLESS_DT)
+
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/* Destino de --record según la ruta. */
+typedef enum
+{
+    REC_Y4M = 0, // Archivo (o FIFO) YUV4MPEG2 4:2:0
+    REC_PIPE,    // "|comando": Y4M por la entrada estándar del comando (p. ej. ffmpeg)
+    REC_PPM      // Ruta con "%d": un PPM (P6) por frame
+} RecordKind;
+
+/*
+ * Recorder: anillo de REC_SLOTS imágenes RGBA32 W x H entre el hilo de render
+ * y un hilo codificador, con el traspaso por semáforos de Pipeline (free_sem /
+ * full_sem, mismo orden de slots en ambos lados). Con el renderer de SDL cada
+ * frame se copia en la GPU a una de REC_LAG + 1 texturas staging y se lee
+ * REC_LAG frames después, antes de emitir el frame nuevo: la lectura espera
+ * solo a frames ya presentados (SDL2 no expone PBOs). Con --backend cpu la
+ * imagen ya está en memoria y solo se copia. Con ventana, si la cola está
+ * llena el frame se descarta en vez de esperar al disco.
+ */
+typedef struct
+{
+    int W, H;
+    RecordKind kind;
+    char path[256];                  // Destino (patrón printf con REC_PPM)
+    FILE *fp;                        // Y4M o tubería (NULL con REC_PPM)
+    Uint8 *img[REC_SLOTS];           // Imágenes RGBA32 en cola
+    bool last[REC_SLOTS];            // Marca de fin para el codificador
+    Uint8 *work;                     // Planos YUV o filas RGB (solo el codificador)
+    SDL_Texture *stage[REC_LAG + 1]; // Staging del renderer de SDL (NULL con --backend cpu)
+    int staged, read;                // Frames copiados a staging y ya leídos
+    int put, frames, dropped;        // Próximo slot; frames encolados y descartados
+    bool block;                      // Sin descartes (headless/determinista): espera slot libre
+    SDL_sem *free_sem, *full_sem;
+    SDL_Thread *thread;
+    SDL_atomic_t failed;             // El codificador no pudo escribir
+} Recorder;
+
+/** true si path tiene exactamente una conversión %d (con ancho opcional) y nada más. */
+static bool record_pattern_ok(const char *path)
+{
+    int convs = 0;
+    for (const char *c = path; *c; ++c)
+    {
+        if (*c != '%')
+            continue;
+        if (c[1] == '%')
+        {
+            ++c;
+            continue;
+        }
+        ++c;
+        while (isdigit((unsigned char)*c))
+            ++c;
+        if (*c != 'd')
+            return false;
+        ++convs;
+    }
+    return convs == 1;
+}
+
+/** Escribe un PPM (P6) por frame; work guarda la imagen sin alpha. */
+static bool record_write_ppm(Recorder *r, const Uint8 *img, int idx)
+{
+    char name[300];
+    snprintf(name, sizeof(name), r->path, idx);
+    const size_t px = (size_t)r->W * r->H;
+    for (size_t k = 0; k < px; ++k)
+    {
+        r->work[3 * k + 0] = img[4 * k + 0];
+        r->work[3 * k + 1] = img[4 * k + 1];
+        r->work[3 * k + 2] = img[4 * k + 2];
+    }
+    FILE *fp = fopen(name, "wb");
+    if (!fp)
+        return false;
+    fprintf(fp, "P6\n%d %d\n255\n", r->W, r->H);
+    bool ok = fwrite(r->work, 3, px, fp) == px;
+    return (fclose(fp) == 0) && ok;
+}
+
+/**
+ * Escribe un FRAME Y4M: luma BT.601 de rango completo por píxel y croma del
+ * promedio de cada bloque 2x2 (4:2:0 "jpeg"; con W o H impar el último bloque
+ * repite la fila/columna del borde).
+ */
+static bool record_write_y4m(Recorder *r, const Uint8 *img)
+{
+    const int W = r->W, H = r->H, CW = (W + 1) / 2, CH = (H + 1) / 2;
+    Uint8 *Y = r->work, *U = Y + (size_t)W * H, *V = U + (size_t)CW * CH;
+    for (size_t k = 0; k < (size_t)W * H; ++k)
+    {
+        const Uint8 *p = img + 4 * k;
+        Y[k] = (Uint8)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+    }
+    for (int cy = 0; cy < CH; ++cy)
+    {
+        const int y0 = 2 * cy, y1 = y0 + 1 < H ? y0 + 1 : y0;
+        for (int cx = 0; cx < CW; ++cx)
+        {
+            const int x0 = 2 * cx, x1 = x0 + 1 < W ? x0 + 1 : x0;
+            const Uint8 *q[4] = {img + 4 * ((size_t)y0 * W + x0), img + 4 * ((size_t)y0 * W + x1),
+                                 img + 4 * ((size_t)y1 * W + x0), img + 4 * ((size_t)y1 * W + x1)};
+            int R = 0, G = 0, B = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                R += q[i][0];
+                G += q[i][1];
+                B += q[i][2];
+            }
+            // Suma de 4 muestras: >> 10 en vez de >> 8; el offset vuelve no negativo el desplazamiento
+            int cb = (-43 * R - 85 * G + 128 * B + (128 << 10) + 512) >> 10;
+            int cr = (128 * R - 107 * G - 21 * B + (128 << 10) + 512) >> 10;
+            U[(size_t)cy * CW + cx] = (Uint8)(cb > 255 ? 255 : cb);
+            V[(size_t)cy * CW + cx] = (Uint8)(cr > 255 ? 255 : cr);
+        }
+    }
+    const size_t bytes = (size_t)W * H + 2 * (size_t)CW * CH;
+    return fputs("FRAME\n", r->fp) >= 0 && fwrite(r->work, 1, bytes, r->fp) == bytes;
+}
+
+/** Hilo codificador: consume imágenes en orden hasta la marca de fin. */
+static int record_encoder(void *arg)
+{
+    Recorder *r = (Recorder *)arg;
+    for (int k = 0, idx = 0;; k = (k + 1) % REC_SLOTS)
+    {
+        SDL_SemWait(r->full_sem);
+        if (r->last[k])
+            break;
+        if (!SDL_AtomicGet(&r->failed))
+        {
+            bool ok = r->kind == REC_PPM ? record_write_ppm(r, r->img[k], idx) : record_write_y4m(r, r->img[k]);
+            if (!ok)
+                SDL_AtomicSet(&r->failed, 1);
+        }
+        ++idx;
+        SDL_SemPost(r->free_sem);
+    }
+    return 0;
+}
+
+/** Libera el grabador sin esperar al codificador (usar record_finish si arrancó). */
+static void record_free(Recorder *r)
+{
+    if (!r)
+        return;
+    if (r->fp)
+    {
+        if (r->kind == REC_PIPE)
+            pclose(r->fp);
+        else
+            fclose(r->fp);
+    }
+    for (int k = 0; k < REC_SLOTS; ++k)
+        free(r->img[k]);
+    for (int k = 0; k <= REC_LAG; ++k)
+        if (r->stage[k])
+            SDL_DestroyTexture(r->stage[k]);
+    free(r->work);
+    if (r->free_sem)
+        SDL_DestroySemaphore(r->free_sem);
+    if (r->full_sem)
+        SDL_DestroySemaphore(r->full_sem);
+    free(r);
+}
+
+/**
+ * Abre el destino de path para imágenes W x H, reserva el anillo (y las
+ * texturas staging si ren != NULL) y arranca el codificador. block: esperar
+ * un slot libre en vez de descartar. NULL (con mensaje) si algo falla.
+ */
+static Recorder *record_create(SDL_Renderer *ren, const char *path, int W, int H, bool block)
+{
+    Recorder *r = (Recorder *)calloc(1, sizeof(Recorder));
+    if (!r)
+        return NULL;
+    r->W = W;
+    r->H = H;
+    r->block = block;
+    snprintf(r->path, sizeof(r->path), "%s", path);
+    r->kind = path[0] == '|' ? REC_PIPE : strchr(path, '%') ? REC_PPM : REC_Y4M;
+    if (r->kind == REC_PPM && !record_pattern_ok(path))
+    {
+        fprintf(stderr, "--record: el patrón '%s' debe tener una sola conversión %%d\n", path);
+        record_free(r);
+        return NULL;
+    }
+    if (r->kind != REC_PPM)
+    {
+        r->fp = r->kind == REC_PIPE ? popen(path + 1, "w") : fopen(path, "wb");
+        if (!r->fp)
+        {
+            fprintf(stderr, "--record: no se pudo abrir '%s'\n", path);
+            record_free(r);
+            return NULL;
+        }
+        fprintf(r->fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", W, H, REC_FPS);
+    }
+    bool ok = (r->work = (Uint8 *)malloc((size_t)W * H * 3)) != NULL;
+    for (int k = 0; k < REC_SLOTS && ok; ++k)
+        ok = (r->img[k] = (Uint8 *)malloc((size_t)W * H * 4)) != NULL;
+    for (int k = 0; ren && k <= REC_LAG && ok; ++k)
+        ok = (r->stage[k] = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, W, H)) != NULL;
+    r->free_sem = SDL_CreateSemaphore(REC_SLOTS);
+    r->full_sem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&r->failed, 0);
+    if (ok && r->free_sem && r->full_sem)
+        r->thread = SDL_CreateThread(record_encoder, "record", r);
+    if (!r->thread)
+    {
+        fprintf(stderr, "--record: sin memoria o sin hilo para grabar %dx%d\n", W, H);
+        record_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+/** Toma el próximo slot libre (esperando si block); NULL => descartar el frame. */
+static Uint8 *record_acquire(Recorder *r)
+{
+    if (r->block)
+        SDL_SemWait(r->free_sem);
+    else if (SDL_SemTryWait(r->free_sem) != 0)
+    {
+        r->dropped++;
+        return NULL;
+    }
+    return r->img[r->put];
+}
+
+/** Publica el slot tomado con record_acquire al codificador. */
+static void record_commit(Recorder *r)
+{
+    r->put = (r->put + 1) % REC_SLOTS;
+    r->frames++;
+    SDL_SemPost(r->full_sem);
+}
+
+/** --backend cpu: encola una copia de la imagen de salida (RGBA32, W x H). */
+static void record_image(Recorder *r, const Uint8 *img)
+{
+    Uint8 *dst = record_acquire(r);
+    if (!dst)
+        return;
+    memcpy(dst, img, (size_t)r->W * r->H * 4);
+    record_commit(r);
+}
+
+/** Lee la textura staging del frame r->read y la encola (o la descarta). */
+static void record_read_one(SDL_Renderer *ren, Recorder *r)
+{
+    SDL_Texture *st = r->stage[r->read % (REC_LAG + 1)];
+    r->read++;
+    Uint8 *dst = record_acquire(r);
+    if (!dst)
+        return;
+    SDL_SetRenderTarget(ren, st);
+    SDL_RenderReadPixels(ren, NULL, SDL_PIXELFORMAT_RGBA32, dst, r->W * 4);
+    SDL_SetRenderTarget(ren, NULL);
+    record_commit(r);
+}
+
+/** Renderer de SDL, antes de emitir el frame: lee el de hace REC_LAG frames. */
+static void record_readback(SDL_Renderer *ren, Recorder *r)
+{
+    while (r->staged - r->read >= REC_LAG)
+        record_read_one(ren, r);
+}
+
+/**
+ * Renderer de SDL, en lugar de copiar rt al backbuffer: lo copia (y reduce)
+ * a la siguiente textura staging y de ahí al backbuffer.
+ */
+static void record_resolve(SDL_Renderer *ren, Recorder *r, SDL_Texture *rt)
+{
+    SDL_Texture *st = r->stage[r->staged % (REC_LAG + 1)];
+    SDL_SetRenderTarget(ren, st);
+    SDL_RenderCopy(ren, rt, NULL, NULL);
+    SDL_SetRenderTarget(ren, NULL);
+    SDL_RenderCopy(ren, st, NULL, NULL);
+    r->staged++;
+}
+
+/**
+ * Lee los frames pendientes en staging, marca el fin, espera al codificador,
+ * informa cuántos frames se grabaron y libera. Acepta NULL.
+ */
+static void record_finish(SDL_Renderer *ren, Recorder *r)
+{
+    if (!r)
+        return;
+    r->block = true; // Al cerrar no se descarta nada
+    while (r->read < r->staged)
+        record_read_one(ren, r);
+    SDL_SemWait(r->free_sem);
+    r->last[r->put] = true;
+    SDL_SemPost(r->full_sem);
+    SDL_WaitThread(r->thread, NULL);
+    if (SDL_AtomicGet(&r->failed))
+        fprintf(stderr, "--record: error al escribir '%s'\n", r->path);
+    else
+        printf("Grabación: %d frames (%d descartados) en '%s'\n", r->frames, r->dropped, r->path);
+    record_free(r);
+}
+
+// ------------------------ Instantáneas y repetición (--save-state / --replay) ------------------------
+
+#define SNAP_MAGIC "SSNAPv1"         // 8 bytes con el NUL
+#define SNAP_ALIGN ((size_t)64 << 10) // Alineación de secciones mapeables (cubre páginas de 4/16/64 KB)
+
+/* Contenido de un archivo de instantánea. */
+typedef enum
+{
+    SNAP_STATE = 1, // Config + atractores + Orbiters (--save-state / --load-state)
+    SNAP_FRAMES     // Config + Precomp por frame (--save-frames / --replay)
+} SnapKind;
+
+/*
+ * SnapHeader: cabecera de ambos tipos de archivo, en el orden de bytes y con
+ * los tamaños del binario que lo escribió (config_bytes y precomp_bytes lo
+ * comprueban). Las secciones van en offsets absolutos: la de Orbiters está
+ * alineada a SNAP_ALIGN y es la copia literal del comienzo de la
+ * ParticleArena (orbiters_alloc es su primer arena_push), así que reanudar es
+ * mapearla en la arena sin parsear nada.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t kind;          // SnapKind
+    uint32_t config_bytes;  // sizeof(Config)
+    uint32_t precomp_bytes; // sizeof(Precomp)
+    int32_t n, attractors, attr_k;
+    int32_t width, height;  // Mundo (backbuffer) en que se grabó
+    uint32_t seed;
+    int32_t lod;            // --lod del stream (lista de dibujo compacta)
+    int32_t frames;         // Frames simulados (estado) o grabados (stream)
+    double t;               // Tiempo de simulación al guardar (estado)
+    uint64_t config_off;    // Config literal (referencia; se restaura solo el mundo)
+    uint64_t att_off;       // Attractors.mem (10 * attractors floats)
+    uint64_t orb_off;       // Estado: bloque de Orbiters (orbiters_bytes(n))
+    uint64_t index_off;     // Stream: offset (uint64_t) de cada SnapFrame
+} SnapHeader;
+
+/*
+ * SnapFrame: registro de un frame del stream, alineado a ORB_ALIGN; le siguen
+ * atx[attractors], aty[attractors] y count Precomp: la lista que dibujó el
+ * frame (con lod, las clases nuc/full/splat de LodCounts).
+ */
+typedef struct
+{
+    float t;        // Tiempo de simulación del frame
+    int32_t sym;    // Simetrías con que se dibujó
+    int32_t count;  // Entradas de Precomp
+    int32_t nuc, full, splat;
+    int32_t pad[2];
+} SnapFrame;
+
+/* Archivo de instantánea mapeado completo (solo lectura). */
+typedef struct
+{
+    const unsigned char *map; // NULL => sin archivo
+    size_t size;
+    const SnapHeader *h;
+    int fd;                   // -1 sin mmap (copia en el heap)
+} SnapMap;
+
+/* Escritura incremental de un stream de frames (--save-frames). */
+typedef struct
+{
+    FILE *fp;
+    SnapHeader h;
+    uint64_t *index; // Offset de cada frame
+    int cap;
+    uint64_t off;    // Próximo offset libre
+} SnapWriter;
+
+/** Redondea x hacia arriba a múltiplo de a. */
+static uint64_t snap_round(uint64_t x, uint64_t a)
+{
+    return (x + a - 1) / a * a;
+}
+
+/** Rellena con ceros hasta el offset `to` (fp está en `from`). */
+static bool snap_pad(FILE *fp, uint64_t from, uint64_t to)
+{
+    static const unsigned char zeros[256] = {0};
+    while (from < to)
+    {
+        size_t k = to - from < sizeof(zeros) ? (size_t)(to - from) : sizeof(zeros);
+        if (fwrite(zeros, 1, k, fp) != k)
+            return false;
+        from += k;
+    }
+    return true;
+}
+
+/** Cabecera común con el mundo de cfg; las secciones las fija quien escribe. */
+static void snap_header_init(SnapHeader *h, SnapKind kind, const Config *cfg, int W, int H)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SNAP_MAGIC, sizeof(h->magic));
+    h->kind = (uint32_t)kind;
+    h->config_bytes = (uint32_t)sizeof(Config);
+    h->precomp_bytes = (uint32_t)sizeof(Precomp);
+    h->n = cfg->n;
+    h->attractors = cfg->attractors;
+    h->attr_k = cfg->attr_k;
+    h->width = W;
+    h->height = H;
+    h->seed = cfg->seed;
+    h->lod = cfg->lod;
+    h->config_off = snap_round(sizeof(SnapHeader), ORB_ALIGN);
+}
+
+/**
+ * Guarda el mundo (Config, atractores y el bloque de Orbiters tal como está
+ * en la arena) tras `frames` frames en el tiempo t. Escribe "<path>.tmp" y
+ * solo si todo salió bien (con fsync) lo renombra sobre path: una escritura
+ * fallida no destruye la instantánea anterior. false si falla la escritura.
+ */
+static bool snap_save_state(const char *path, const Config *cfg, const Attractors *att, const ParticleArena *arena,
+                            int W, int H, int frames, double t)
+{
+    SnapHeader h;
+    snap_header_init(&h, SNAP_STATE, cfg, W, H);
+    h.frames = frames;
+    h.t = t;
+    h.att_off = snap_round(h.config_off + sizeof(Config), ORB_ALIGN);
+    h.orb_off = snap_round(h.att_off + sizeof(float) * 10 * (size_t)att->n, SNAP_ALIGN);
+    const size_t orb_bytes = orbiters_bytes(cfg->n);
+    char tmp[sizeof(cfg->save_state) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 && snap_pad(fp, sizeof(h), h.config_off) &&
+              fwrite(cfg, sizeof(Config), 1, fp) == 1 && snap_pad(fp, h.config_off + sizeof(Config), h.att_off) &&
+              fwrite(att->mem, sizeof(float) * 10, (size_t)att->n, fp) == (size_t)att->n &&
+              snap_pad(fp, h.att_off + sizeof(float) * 10 * (size_t)att->n, h.orb_off) &&
+              fwrite(arena->base, 1, orb_bytes, fp) == orb_bytes &&
+              snap_pad(fp, h.orb_off + orb_bytes, snap_round(h.orb_off + orb_bytes, SNAP_ALIGN)); // Mapeable por páginas enteras
+    ok = fflush(fp) == 0 && ok;
+#if !defined(_WIN32)
+    ok = ok && fsync(fileno(fp)) == 0;
+#endif
+    ok = (fclose(fp) == 0) && ok;
+#if defined(_WIN32)
+    if (ok)
+        remove(path); // rename no reemplaza en Windows
+#endif
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+        remove(tmp);
+    return ok;
+}
+
+/** Desmapea y cierra; acepta un SnapMap vacío. */
+static void snap_close(SnapMap *m)
+{
+    if (!m->map)
+        return;
+#if !defined(_WIN32)
+    if (m->fd >= 0)
+    {
+        munmap((void *)m->map, m->size);
+        close(m->fd);
+    }
+    else
+#endif
+        free((void *)m->map);
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+}
+
+/** Comprueba que [off, off+bytes) cae dentro del archivo. */
+static bool snap_in_file(const SnapMap *m, uint64_t off, uint64_t bytes)
+{
+    return off <= m->size && bytes <= m->size - off;
+}
+
+/** Frame k del stream y sus atractores (sin copiar: apuntan al mapeo). */
+static const SnapFrame *snap_frame(const SnapMap *m, int k, const float **atx, const float **aty, const Precomp **pc)
+{
+    const uint64_t off = ((const uint64_t *)(m->map + m->h->index_off))[k];
+    const SnapFrame *f = (const SnapFrame *)(m->map + off);
+    *atx = (const float *)(f + 1);
+    *aty = *atx + m->h->attractors;
+    *pc = (const Precomp *)(*aty + m->h->attractors);
+    return f;
+}
+
+/**
+ * Mapea path completo (solo lectura; sin mmap se lee al heap) y valida la
+ * cabecera y las secciones del tipo kind, incluido cada frame del stream.
+ * false (con mensaje) si no existe o no corresponde a este binario.
+ */
+static bool snap_open(SnapMap *m, const char *path, SnapKind kind)
+{
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+#if !defined(_WIN32)
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(SnapHeader))
+    {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            m->map = (const unsigned char *)p;
+            m->size = (size_t)st.st_size;
+            m->fd = fd;
+        }
+    }
+    if (!m->map && fd >= 0)
+        close(fd);
+#endif
+    if (!m->map)
+    {
+        // Sin mmap: el archivo completo al heap
+        FILE *fp = fopen(path, "rb");
+        long sz = -1;
+        if (fp && fseek(fp, 0, SEEK_END) == 0 && (sz = ftell(fp)) >= (long)sizeof(SnapHeader) && fseek(fp, 0, SEEK_SET) == 0)
+        {
+            unsigned char *buf = (unsigned char *)malloc((size_t)sz);
+            if (buf && fread(buf, 1, (size_t)sz, fp) == (size_t)sz)
+            {
+                m->map = buf;
+                m->size = (size_t)sz;
+            }
+            else
+                free(buf);
+        }
+        if (fp)
+            fclose(fp);
+    }
+    if (!m->map)
+    {
+        fprintf(stderr, "No se pudo abrir la instantánea '%s'\n", path);
+        return false;
+    }
+    const SnapHeader *h = m->h = (const SnapHeader *)m->map;
+    bool ok = memcmp(h->magic, SNAP_MAGIC, sizeof(h->magic)) == 0 && h->kind == (uint32_t)kind &&
+              h->config_bytes == sizeof(Config) && h->precomp_bytes == sizeof(Precomp) && h->n >= 1 &&
+              h->attractors >= 1 && h->attractors <= ATTR_MAX && h->attr_k >= 1 && h->frames >= 0 &&
+              snap_in_file(m, h->config_off, sizeof(Config));
+    if (ok && kind == SNAP_STATE)
+        ok = h->orb_off % SNAP_ALIGN == 0 && snap_in_file(m, h->att_off, sizeof(float) * 10 * (uint64_t)h->attractors) &&
+             snap_in_file(m, h->orb_off, snap_round(orbiters_bytes(h->n), SNAP_ALIGN));
+    if (ok && kind == SNAP_FRAMES)
+    {
+        ok = h->frames >= 1 && h->index_off % sizeof(uint64_t) == 0 && snap_in_file(m, h->index_off, sizeof(uint64_t) * (uint64_t)h->frames);
+        const uint64_t head = sizeof(SnapFrame) + sizeof(float) * 2 * (uint64_t)h->attractors;
+        for (int k = 0; ok && k < h->frames; ++k)
+        {
+            const uint64_t off = ((const uint64_t *)(m->map + h->index_off))[k];
+            ok = off % ORB_ALIGN == 0 && snap_in_file(m, off, head);
+            const SnapFrame *f = ok ? (const SnapFrame *)(m->map + off) : NULL;
+            ok = ok && f->count >= 0 && f->count <= h->n && f->nuc >= 0 && f->full >= 0 && f->splat >= 0 &&
+                 (h->lod ? f->nuc + f->full + f->splat == f->count : f->count == h->n) &&
+                 snap_in_file(m, off + head, sizeof(Precomp) * (uint64_t)f->count);
+        }
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "'%s' no es una instantánea válida de este binario\n", path);
+        snap_close(m);
+    }
+    return ok;
+}
+
+/**
+ * Reanuda el mundo de m: copia los atractores (ya creados con init_attractors
+ * para el mismo mundo) y mapea el bloque de Orbiters sobre el comienzo de la
+ * arena con MAP_PRIVATE | MAP_FIXED: las páginas se leen del archivo al
+ * tocarlas y las escrituras quedan en memoria (copy-on-write). --save-state
+ * al mismo archivo no lo pisa: escribe otro y lo renombra, y el mapeo sigue
+ * en el inodo anterior. Si la arena no es un mmap o no alcanza a páginas
+ * enteras, lo copia.
+ */
+static void snap_restore(const SnapMap *m, Attractors *att, ParticleArena *arena)
+{
+    const SnapHeader *h = m->h;
+    memcpy(att->mem, m->map + h->att_off, sizeof(float) * 10 * (size_t)att->n);
+    const size_t bytes = orbiters_bytes(h->n);
+#if !defined(_WIN32)
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t len = (size_t)snap_round(bytes, page);
+    if (m->fd >= 0 && arena->mapped && len <= arena->size && page <= SNAP_ALIGN &&
+        mmap(arena->base, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, m->fd, (off_t)h->orb_off) != MAP_FAILED)
+        return;
+#endif
+    memcpy(arena->base, m->map + h->orb_off, bytes);
+}
+
+/** Abre el stream de path con la cabecera provisional (se completa al cerrar). NULL si falla. */
+static SnapWriter *snap_frames_open(const char *path, const Config *cfg, int W, int H)
+{
+    SnapWriter *w = (SnapWriter *)calloc(1, sizeof(SnapWriter));
+    if (!w)
+        return NULL;
+    snap_header_init(&w->h, SNAP_FRAMES, cfg, W, H);
+    w->fp = fopen(path, "wb");
+    if (!w->fp || fwrite(&w->h, sizeof(w->h), 1, w->fp) != 1 || !snap_pad(w->fp, sizeof(w->h), w->h.config_off) ||
+        fwrite(cfg, sizeof(Config), 1, w->fp) != 1)
+    {
+        if (w->fp)
+            fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+    w->off = w->h.config_off + sizeof(Config);
+    return w;
+}
+
+/** Agrega un frame: la lista pc[0..count) que se dibuja, sus clases (lc) y atractores. */
+static bool snap_frames_put(SnapWriter *w, float t, int sym, const Precomp *pc, int count, const LodCounts *lc,
+                            const float *atx, const float *aty, int na)
+{
+    if (w->h.frames == w->cap)
+    {
+        int cap = w->cap ? w->cap * 2 : 256;
+        uint64_t *idx = (uint64_t *)realloc(w->index, sizeof(uint64_t) * (size_t)cap);
+        if (!idx)
+            return false;
+        w->index = idx;
+        w->cap = cap;
+    }
+    const uint64_t at = snap_round(w->off, ORB_ALIGN);
+    SnapFrame f = {t, sym, count, lc ? lc->nuc : 0, lc ? lc->full : count, lc ? lc->splat : 0, {0, 0}};
+    bool ok = snap_pad(w->fp, w->off, at) && fwrite(&f, sizeof(f), 1, w->fp) == 1 &&
+              fwrite(atx, sizeof(float), (size_t)na, w->fp) == (size_t)na &&
+              fwrite(aty, sizeof(float), (size_t)na, w->fp) == (size_t)na &&
+              fwrite(pc, sizeof(Precomp), (size_t)count, w->fp) == (size_t)count;
+    if (!ok)
+        return false;
+    w->index[w->h.frames++] = at;
+    w->off = at + sizeof(f) + sizeof(float) * 2 * (size_t)na + sizeof(Precomp) * (size_t)count;
+    return true;
+}
+
+/** Escribe el índice, completa la cabecera y cierra (también si algo falló). false si falla; acepta NULL. */
+static bool snap_frames_close(SnapWriter *w)
+{
+    if (!w)
+        return true;
+    w->h.index_off = snap_round(w->off, sizeof(uint64_t));
+    bool ok = snap_pad(w->fp, w->off, w->h.index_off) &&
+              fwrite(w->index, sizeof(uint64_t), (size_t)w->h.frames, w->fp) == (size_t)w->h.frames &&
+              fseek(w->fp, 0, SEEK_SET) == 0 && fwrite(&w->h, sizeof(w->h), 1, w->fp) == 1;
+    ok = (fclose(w->fp) == 0) && ok;
+    free(w->index);
+    free(w);
+    return ok;
+}
+
+/**
+ * --replay con --batch 1: lo que en una corrida normal emite el pre-cálculo
+ * (batch_begin_frame + vértices), aquí desde la lista grabada. También la
+ * usan las vistas extra de --outputs, con el centro del mundo en (cx, cy).
+ */
+static void snap_emit_batch(SpriteBatch *b, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, int sym, float cx, float cy)
+{
+    batch_begin_frame(b, cfg, cfg->n, sym, cfg->mirror, cx, cy);
+    if (lc)
+        batch_set_list(b, pc, lc);
+    else if (b->ready)
+        batch_emit_list(b, pc, n, 0, b->ndraw); // Sin cupo: render emite por tandas
+}
+
+// ------------------------ Cómputo en GPU (--gpu 1, OpenCL) ------------------------
+
+/**
+ * Motivo por el que --gpu 1 no aplica a esta configuración (NULL = aplica).
+ * El kernel cubre el camino por defecto: física + expansión a los vértices
+ * de SpriteBatch con color por tabla; lo demás necesita el Precomp en CPU.
+ */
+static const char *gpu_unsupported(const Config *cfg, bool replaying)
+{
+    if (replaying)
+        return "--replay no simula";
+    if (cfg->backend == BACKEND_CPU || !cfg->batch)
+        return "requiere --batch 1 con --backend sdl";
+    if (!cfg->color_lut)
+        return "requiere --color-lut 1";
+    if (cfg->lod)
+        return "no admite --lod 1";
+    if (cfg->pipeline)
+        return "no admite --pipeline 1";
+    if (cfg->interact > 0.0f)
+        return "no admite --interact";
+    if (cfg->save_frames[0] != '\0')
+        return "no admite --save-frames (no hay Precomp en CPU)";
+    if (cfg->outputs > 1)
+        return "no admite --outputs > 1 (las vistas extra leen el Precomp)";
+    return NULL;
+}
+
+#ifdef USE_OPENCL
+
+#define GPU_PRM 32 // Floats por frame: cos[8], sin[8], UV de discos r=1..3 (4 c/u) y UV del halo
+
+/*
+ * Kernel fusionado: un work-item por partícula (hasta cap, el relleno es
+ * inerte) integra el resorte–amortiguador como integrate_range_libm y, si
+ * i < n e i % step == 0, calcula radio y color (particle_radius +
+ * color_lut_lookup) y escribe sus copias en los slots de batch_emit_range.
+ * Vtx reproduce el layout de SDL_Vertex (20 bytes, sin float2 para no
+ * alinear a 8). LUT_HUES y TAIL_QUADS llegan como -D al compilar.
+ */
+static const char *GPU_KERNEL_SRC =
+    "typedef struct { float px, py; uchar r, g, b, a; float tu, tv; } Vtx;\n"
+    "\n"
+    "void vtx_color(__global Vtx *v, uchar4 c)\n"
+    "{\n"
+    "    for (int k = 0; k < 4; ++k) { v[k].r = c.x; v[k].g = c.y; v[k].b = c.z; v[k].a = c.w; }\n"
+    "}\n"
+    "\n"
+    "void quad(__global Vtx *v, float x, float y, float w, float h, __constant float *uv, uchar4 c)\n"
+    "{\n"
+    "    float u0 = uv[0], v0 = uv[1], u1 = uv[0] + uv[2], v1 = uv[1] + uv[3];\n"
+    "    v[0].px = x;     v[0].py = y;     v[0].tu = u0; v[0].tv = v0;\n"
+    "    v[1].px = x + w; v[1].py = y;     v[1].tu = u1; v[1].tv = v0;\n"
+    "    v[2].px = x + w; v[2].py = y + h; v[2].tu = u1; v[2].tv = v1;\n"
+    "    v[3].px = x;     v[3].py = y + h; v[3].tu = u0; v[3].tv = v1;\n"
+    "    vtx_color(v, c);\n"
+    "}\n"
+    "\n"
+    "void line(__global Vtx *v, float x0, float y0, float x1, float y1, uchar4 c)\n"
+    "{\n"
+    "    float dx = x1 - x0, dy = y1 - y0, len = sqrt(dx * dx + dy * dy);\n"
+    "    float nx = 0.5f, ny = 0.0f;\n"
+    "    if (len > 1e-4f) { nx = -dy / len * 0.5f; ny = dx / len * 0.5f; }\n"
+    "    v[0].px = x0 + nx; v[0].py = y0 + ny;\n"
+    "    v[1].px = x1 + nx; v[1].py = y1 + ny;\n"
+    "    v[2].px = x1 - nx; v[2].py = y1 - ny;\n"
+    "    v[3].px = x0 - nx; v[3].py = y0 - ny;\n"
+    "    for (int k = 0; k < 4; ++k) { v[k].tu = 0.0f; v[k].tv = 0.0f; }\n"
+    "    vtx_color(v, c);\n"
+    "}\n"
+    "\n"
+    "__kernel void ss_step(__global float *orb, int fs, int cap, int n, __global const float *ac, int A, float dt, float t,\n"
+    "                      float ps, __global const uint *lut, float sat_lo, float sat_scale, float smax, int ocean,\n"
+    "                      float sat_mul, __constant float *prm, int symN, int mirN, int step, float cx, float cy, int trail,\n"
+    "                      uint a0, uint a1, __global Vtx *vtrail, __global Vtx *vtail, __global Vtx *vhalo,\n"
+    "                      __global Vtx *vnuc)\n"
+    "{\n"
+    "    int i = get_global_id(0);\n"
+    "    if (i >= cap) return;\n"
+    "    __global float *x = orb, *y = orb + fs, *px = orb + 2 * fs, *py = orb + 3 * fs;\n"
+    "    __global float *vx = orb + 4 * fs, *vy = orb + 5 * fs, *angle = orb + 6 * fs;\n"
+    "    __global const float *omega = orb + 7 * fs, *radius = orb + 8 * fs, *kk = orb + 9 * fs, *damp = orb + 10 * fs;\n"
+    "    __global const float *sb = orb + 11 * fs, *sa = orb + 12 * fs, *ss = orb + 13 * fs, *sp = orb + 14 * fs;\n"
+    "    __global const int *att = (__global const int *)(orb + 15 * fs);\n"
+    "\n"
+    "    float xi = x[i], yi = y[i], vxi = vx[i], vyi = vy[i];\n"
+    "    float ang = angle[i] + omega[i] * dt, ca, sn = sincos(ang, &ca);\n"
+    "    int k = att[i];\n"
+    "    float tx = ac[k] + ca * radius[i], ty = ac[A + k] + sn * radius[i];\n"
+    "    vxi += (kk[i] * (tx - xi) - damp[i] * vxi) * dt;\n"
+    "    vyi += (kk[i] * (ty - yi) - damp[i] * vyi) * dt;\n"
+    "    float xn = xi + vxi * dt, yn = yi + vyi * dt;\n"
+    "    px[i] = xi; py[i] = yi; angle[i] = ang;\n"
+    "    vx[i] = vxi; vy[i] = vyi; x[i] = xn; y[i] = yn;\n"
+    "    if (i >= n || i % step != 0) return;\n"
+    "\n"
+    "    float br = 0.5f + 0.5f * sin(ss[i] * t + sp[i]);\n"
+    "    float spd = sqrt(vxi * vxi + vyi * vyi);\n"
+    "    int pr = clamp((int)round(sb[i] * ps + sa[i] * ps * br + fmin(2.0f, spd * 0.015f)), 1, 3);\n"
+    "    float fi = (float)i, hue, sat;\n"
+    "    if (ocean)\n"
+    "    {\n"
+    "        hue = 180.0f + fmod(fi * 3.5f + 18.0f * sin(0.21f * t + fi * 0.05f), 40.0f);\n"
+    "        sat = 0.65f + 0.20f * sin(0.13f * t + fi * 0.09f);\n"
+    "    }\n"
+    "    else\n"
+    "    {\n"
+    "        hue = fmod(fi * 137.508f + 90.0f * sin(0.23f * t + fi * 0.031f), 360.0f);\n"
+    "        hue += hue < 0.0f ? 360.0f : 0.0f;\n"
+    "        sat = 0.85f;\n"
+    "    }\n"
+    "    sat = clamp(sat * sat_mul, 0.0f, 1.0f);\n"
+    "    int hi = (int)((hue + 360.0f) * (LUT_HUES / 360.0f)) & (LUT_HUES - 1);\n"
+    "    int si = (int)clamp((sat - sat_lo) * sat_scale + 0.5f, 0.0f, smax);\n"
+    "    uint rgb = lut[si * LUT_HUES + hi];\n"
+    "    uchar4 col = (uchar4)((uchar)(rgb & 0xFF), (uchar)((rgb >> 8) & 0xFF), (uchar)((rgb >> 16) & 0xFF), 0);\n"
+    "    uchar trailA = a0 & 0xFF, haloA = (a0 >> 8) & 0xFF, nucA = (a0 >> 16) & 0xFF;\n"
+    "\n"
+    "    __constant float *cosA = prm, *sinA = prm + 8, *duv = prm + 16, *ruv = prm + 28;\n"
+    "    float dx0 = xn - cx, dy0 = yn - cy, dxp = xi - cx, dyp = yi - cy;\n"
+    "    int copies = symN * mirN, j = i / step;\n"
+    "    for (int m = 0; m < symN; ++m)\n"
+    "    {\n"
+    "        float xr = cx + dx0 * cosA[m] - dy0 * sinA[m], yr = cy + dx0 * sinA[m] + dy0 * cosA[m];\n"
+    "        float xpr = cx + dxp * cosA[m] - dyp * sinA[m], ypr = cy + dxp * sinA[m] + dyp * cosA[m];\n"
+    "        for (int mir = 0; mir < mirN; ++mir)\n"
+    "        {\n"
+    "            int slot = j * copies + m * mirN + mir;\n"
+    "            float X = mir ? (2.0f * cx - xr) : xr, Y = yr;\n"
+    "            float XP = mir ? (2.0f * cx - xpr) : xpr, YP = ypr;\n"
+    "            if (trail) { col.w = trailA; line(vtrail + 4 * slot, XP, YP, X, Y, col); }\n"
+    "            float ddx = X - XP, ddy = Y - YP;\n"
+    "            for (int c = 1; c <= TAIL_QUADS; ++c)\n"
+    "            {\n"
+    "                float tp = (float)c / 4.0f;\n"
+    "                int pr2 = max(pr - c, 1);\n"
+    "                float D2 = (float)(pr2 * 2 + 1);\n"
+    "                col.w = (uchar)((a1 >> (8 * (c - 1))) & 0xFF);\n"
+    "                quad(vtail + 4 * (slot * TAIL_QUADS + c - 1), X - ddx * tp - pr2, Y - ddy * tp - pr2, D2, D2,\n"
+    "                     duv + 4 * (pr2 - 1), col);\n"
+    "            }\n"
+    "            if (haloA > 0)\n"
+    "            {\n"
+    "                float hr = (float)(pr + 2);\n"
+    "                col.w = haloA;\n"
+    "                quad(vhalo + 4 * slot, X - hr, Y - hr, hr * 2.0f, hr * 2.0f, ruv, col);\n"
+    "            }\n"
+    "            float D = (float)(pr * 2 + 1);\n"
+    "            col.w = nucA;\n"
+    "            quad(vnuc + 4 * slot, X - pr, Y - pr, D, D, duv + 4 * (pr - 1), col);\n"
+    "        }\n"
+    "    }\n"
+    "}\n";
+
+/*
+ * GpuSim: estado de --gpu 1. El bloque SoA de Orbiters vive en el
+ * dispositivo desde gpu_create (solo vuelve con gpu_download); por frame se
+ * escriben los centros de los atractores y GPU_PRM floats. Los vértices se
+ * crean sobre SpriteBatch.v con CL_MEM_USE_HOST_PTR: el map del frame deja
+ * en esos mismos punteros lo que escribió el kernel (sin copia con memoria
+ * unificada) y batch_flush los envía tal cual.
+ */
+typedef struct GpuSim
+{
+    cl_context ctx;
+    cl_command_queue q;
+    cl_program prog;
+    cl_kernel kern;
+    cl_mem orb;            // Orbiters (orbiters_bytes(n), mismo layout que orbiters_bind)
+    cl_mem att;            // cx[A] y cy[A] contiguos (como en Attractors.mem)
+    cl_mem lut;            // ColorLUT.rgb
+    cl_mem prm;            // Parámetros de expansión del frame
+    cl_mem v[LAYER_COUNT]; // Vértices por capa sobre SpriteBatch.v
+    void *vmap[LAYER_COUNT]; // Mapeo vigente (NULL si el kernel puede escribir)
+    size_t vbytes[LAYER_COUNT];
+    size_t orb_bytes;
+    float prm_host[GPU_PRM]; // Fuente del write no bloqueante de prm
+    char device[128];
+} GpuSim;
+
+/** Desmapea los vértices del frame anterior (antes de relanzar el kernel). */
+static void gpu_unmap(GpuSim *g)
+{
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        if (g->vmap[l])
+        {
+            clEnqueueUnmapMemObject(g->q, g->v[l], g->vmap[l], 0, NULL, NULL);
+            g->vmap[l] = NULL;
+        }
+}
+
+/** Libera objetos OpenCL; acepta NULL. */
+static void gpu_free(GpuSim *g)
+{
+    if (!g)
+        return;
+    if (g->q)
+    {
+        gpu_unmap(g);
+        clFinish(g->q);
+    }
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        if (g->v[l])
+            clReleaseMemObject(g->v[l]);
+    cl_mem *m[] = {&g->orb, &g->att, &g->lut, &g->prm};
+    for (size_t k = 0; k < sizeof(m) / sizeof(m[0]); ++k)
+        if (*m[k])
+            clReleaseMemObject(*m[k]);
+    if (g->kern)
+        clReleaseKernel(g->kern);
+    if (g->prog)
+        clReleaseProgram(g->prog);
+    if (g->q)
+        clReleaseCommandQueue(g->q);
+    if (g->ctx)
+        clReleaseContext(g->ctx);
+    free(g);
+}
+
+/** Primer dispositivo GPU de cualquier plataforma; si no hay, el primero de cualquier tipo. */
+static bool gpu_pick_device(cl_platform_id *plat, cl_device_id *dev)
+{
+    cl_platform_id ps[8];
+    cl_uint np = 0;
+    if (clGetPlatformIDs(8, ps, &np) != CL_SUCCESS || np == 0)
+        return false;
+    if (np > 8)
+        np = 8;
+    const cl_device_type types[2] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+    for (int t = 0; t < 2; ++t)
+        for (cl_uint p = 0; p < np; ++p)
+            if (clGetDeviceIDs(ps[p], types[t], 1, dev, NULL) == CL_SUCCESS)
+            {
+                *plat = ps[p];
+                return true;
+            }
+    return false;
+}
+
+/**
+ * Crea contexto, cola y kernel, sube Orbiters y la tabla de color una sola
+ * vez y envuelve los buffers de b, reservados para el peor frame (N
+ * partículas x cfg->sym x espejo: la adaptación solo baja de ahí). NULL con
+ * una nota en stderr si algo falla (se sigue en CPU).
+ */
+static GpuSim *gpu_create(const Config *cfg, const Orbiters *o, const Attractors *a, const ColorLUT *lut, SpriteBatch *b)
+{
+    int symN = cfg->sym < 1 ? 1 : (cfg->sym > 8 ? 8 : cfg->sym);
+    if (!batch_reserve(b, o->n * symN * (cfg->mirror ? 2 : 1)))
+    {
+        fprintf(stderr, "--gpu 1: el frame completo no cabe en SpriteBatch (%d MB); se usa la CPU\n", BATCH_BUDGET_MB);
+        return NULL;
+    }
+    GpuSim *g = (GpuSim *)calloc(1, sizeof(GpuSim));
+    if (!g)
+        return NULL;
+    cl_platform_id plat;
+    cl_device_id dev;
+    cl_int err = CL_SUCCESS;
+    const char *what = "sin plataforma/dispositivo OpenCL";
+    bool ok = gpu_pick_device(&plat, &dev);
+    if (ok)
+    {
+        clGetDeviceInfo(dev, CL_DEVICE_NAME, sizeof(g->device), g->device, NULL);
+        cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)plat, 0};
+        what = "clCreateContext";
+        g->ctx = clCreateContext(props, 1, &dev, NULL, NULL, &err);
+        ok = err == CL_SUCCESS;
+    }
+    if (ok)
+    {
+        what = "clCreateCommandQueue";
+        g->q = clCreateCommandQueue(g->ctx, dev, 0, &err);
+        ok = err == CL_SUCCESS;
+    }
+    if (ok)
+    {
+        what = "clBuildProgram";
+        char opts[128];
+        snprintf(opts, sizeof(opts), "-DLUT_HUES=%d -DTAIL_QUADS=%d%s", LUT_HUES, TAIL_QUADS,
+                 cfg->fast_math == FASTMATH_FAST ? " -cl-fast-relaxed-math" : "");
+        g->prog = clCreateProgramWithSource(g->ctx, 1, &GPU_KERNEL_SRC, NULL, &err);
+        ok = err == CL_SUCCESS && (err = clBuildProgram(g->prog, 1, &dev, opts, NULL, NULL)) == CL_SUCCESS;
+        if (!ok && g->prog)
+        {
+            char log[2048] = {0};
+            clGetProgramBuildInfo(g->prog, dev, CL_PROGRAM_BUILD_LOG, sizeof(log) - 1, log, NULL);
+            fprintf(stderr, "--gpu 1: error al compilar el kernel:\n%s\n", log);
+        }
+    }
+    if (ok)
+    {
+        what = "clCreateKernel";
+        g->kern = clCreateKernel(g->prog, "ss_step", &err);
+        ok = err == CL_SUCCESS;
+    }
+    if (ok)
+    {
+        what = "clCreateBuffer";
+        g->orb_bytes = orbiters_bytes(o->n);
+        g->orb = clCreateBuffer(g->ctx, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, g->orb_bytes, o->x, &err);
+        ok = err == CL_SUCCESS;
+        if (ok)
+            g->att = clCreateBuffer(g->ctx, CL_MEM_READ_ONLY, sizeof(float) * 2 * (size_t)a->n, NULL, &err);
+        ok = ok && err == CL_SUCCESS;
+        if (ok)
+            g->lut = clCreateBuffer(g->ctx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(lut->rgb), (void *)lut->rgb, &err);
+        ok = ok && err == CL_SUCCESS;
+        if (ok)
+            g->prm = clCreateBuffer(g->ctx, CL_MEM_READ_ONLY, sizeof(g->prm_host), NULL, &err);
+        ok = ok && err == CL_SUCCESS;
+        for (int l = 0; l < LAYER_COUNT && ok; ++l)
+        {
+            g->vbytes[l] = sizeof(SDL_Vertex) * 4 * (size_t)LAYER_QUADS[l] * (size_t)b->cap_slots;
+            g->v[l] = clCreateBuffer(g->ctx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, g->vbytes[l], b->v[l], &err);
+            ok = err == CL_SUCCESS;
+        }
+    }
+    if (!ok)
+    {
+        if (err != CL_SUCCESS)
+            fprintf(stderr, "--gpu 1: %s (error %d); se usa la CPU\n", what, (int)err);
+        else
+            fprintf(stderr, "--gpu 1: %s; se usa la CPU\n", what);
+        gpu_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+/**
+ * Un frame en el dispositivo: atractores en CPU (A centros, se suben),
+ * parámetros de batch_begin_frame y el kernel fusionado sobre las cap
+ * partículas; el map bloqueante deja los vértices listos en b->v para
+ * batch_flush. Todo cuenta en ticks[STAGE_UPDATE] (como --fused 1).
+ */
+static void gpu_frame(GpuSim *g, const Config *cfg, const ColorLUT *lut, const Orbiters *o, Attractors *att, SpriteBatch *b,
+                      float dt, float t, int W, int H, int draw_sym, uint64_t ticks[STAGE_COUNT])
+{
+    uint64_t mark = SDL_GetPerformanceCounter();
+    const Executor *ex = executor_get(cfg->exec);
+    update_attractors(ex, att, t, W, H);
+    batch_begin_frame(b, cfg, o->n, draw_sym, cfg->mirror, W * 0.5f, H * 0.5f);
+    const DrawParams *dp = &b->dp;
+    for (int m = 0; m < 8; ++m)
+    {
+        g->prm_host[m] = m < dp->symN ? dp->cosA[m] : 0.0f;
+        g->prm_host[8 + m] = m < dp->symN ? dp->sinA[m] : 0.0f;
+    }
+    for (int r = 1; r <= 3; ++r)
+        memcpy(&g->prm_host[16 + 4 * (r - 1)], &b->disc_uv[r], sizeof(SDL_FRect));
+    memcpy(&g->prm_host[28], &b->radial_uv, sizeof(SDL_FRect));
+
+    gpu_unmap(g);
+    clEnqueueWriteBuffer(g->q, g->att, CL_FALSE, 0, sizeof(float) * 2 * (size_t)att->n, att->cx, 0, NULL, NULL);
+    clEnqueueWriteBuffer(g->q, g->prm, CL_FALSE, 0, sizeof(g->prm_host), g->prm_host, 0, NULL, NULL);
+
+    const cl_int fs = (cl_int)(o->y - o->x), cap = o->cap, n = o->n, A = att->n;
+    const cl_int ocean = cfg->palette_id == PALETTE_OCEAN, symN = dp->symN, mirN = dp->mirN, step = dp->step, trail = dp->trail;
+    const cl_float cx = dp->cx, cy = dp->cy, ps = cfg->point_scale, sat_mul = cfg->sat_mul;
+    const cl_float smax = (float)(lut->buckets - 1);
+    const cl_uint a0 = (cl_uint)dp->trailA | ((cl_uint)dp->haloA << 8) | ((cl_uint)dp->nucA << 16);
+    cl_uint a1 = 0;
+    for (int c = 1; c <= TAIL_QUADS; ++c)
+        a1 |= (cl_uint)dp->tailA[c] << (8 * (c - 1));
+    const struct
+    {
+        size_t size;
+        const void *p;
+    } args[] = {
+        {sizeof(cl_mem), &g->orb}, {sizeof(fs), &fs}, {sizeof(cap), &cap}, {sizeof(n), &n}, {sizeof(cl_mem), &g->att},
+        {sizeof(A), &A}, {sizeof(dt), &dt}, {sizeof(t), &t}, {sizeof(ps), &ps}, {sizeof(cl_mem), &g->lut},
+        {sizeof(float), &lut->sat_lo}, {sizeof(float), &lut->sat_scale}, {sizeof(smax), &smax}, {sizeof(ocean), &ocean},
+        {sizeof(sat_mul), &sat_mul}, {sizeof(cl_mem), &g->prm}, {sizeof(symN), &symN}, {sizeof(mirN), &mirN},
+        {sizeof(step), &step}, {sizeof(cx), &cx}, {sizeof(cy), &cy}, {sizeof(trail), &trail}, {sizeof(a0), &a0},
+        {sizeof(a1), &a1}, {sizeof(cl_mem), &g->v[LAYER_TRAIL]}, {sizeof(cl_mem), &g->v[LAYER_TAIL]},
+        {sizeof(cl_mem), &g->v[LAYER_HALO]}, {sizeof(cl_mem), &g->v[LAYER_NUCLEUS]},
+    };
+    for (cl_uint k = 0; k < (cl_uint)(sizeof(args) / sizeof(args[0])); ++k)
+        clSetKernelArg(g->kern, k, args[k].size, args[k].p);
+    size_t global = (size_t)cap;
+    clEnqueueNDRangeKernel(g->q, g->kern, 1, NULL, &global, NULL, 0, NULL, NULL);
+
+    // Solo el tramo usado del frame; con USE_HOST_PTR el puntero devuelto es b->v[l]
+    for (int l = 0; l < LAYER_COUNT; ++l)
+    {
+        size_t used = sizeof(SDL_Vertex) * 4 * (size_t)LAYER_QUADS[l] * (size_t)b->ndraw * (size_t)dp->copies;
+        g->vmap[l] = clEnqueueMapBuffer(g->q, g->v[l], CL_TRUE, CL_MAP_READ, 0, used < g->vbytes[l] ? used : g->vbytes[l], 0,
+                                        NULL, NULL, NULL);
+    }
+    ticks[STAGE_UPDATE] += SDL_GetPerformanceCounter() - mark;
+}
+
+/** Trae el estado del dispositivo a o (checksum y --save-state). */
+static bool gpu_download(GpuSim *g, Orbiters *o)
+{
+    return clEnqueueReadBuffer(g->q, g->orb, CL_TRUE, 0, g->orb_bytes, o->x, 0, NULL, NULL) == CL_SUCCESS;
+}
+
+/** Nombre del dispositivo elegido. */
+static const char *gpu_device_name(const GpuSim *g) { return g->device; }
+
+#else // Sin USE_OPENCL: --gpu 1 avisa y sigue en CPU
+
+typedef struct GpuSim GpuSim;
+
+static GpuSim *gpu_create(const Config *cfg, const Orbiters *o, const Attractors *a, const ColorLUT *lut, SpriteBatch *b)
+{
+    (void)cfg, (void)o, (void)a, (void)lut, (void)b;
+    fprintf(stderr, "--gpu 1: compilado sin USE_OPENCL; se usa la CPU\n");
+    return NULL;
+}
+static void gpu_free(GpuSim *g) { (void)g; }
+static void gpu_frame(GpuSim *g, const Config *cfg, const ColorLUT *lut, const Orbiters *o, Attractors *att, SpriteBatch *b,
+                      float dt, float t, int W, int H, int draw_sym, uint64_t ticks[STAGE_COUNT])
+{
+    (void)g, (void)cfg, (void)lut, (void)o, (void)att, (void)b, (void)dt, (void)t, (void)W, (void)H, (void)draw_sym, (void)ticks;
+}
+static bool gpu_download(GpuSim *g, Orbiters *o)
+{
+    (void)g, (void)o;
+    return false;
+}
+static const char *gpu_device_name(const GpuSim *g)
+{
+    (void)g;
+    return "";
+}
+
+#endif // USE_OPENCL
+
+// ------------------------ Varios nodos (MPI, -DUSE_MPI) ------------------------
+
+#ifdef USE_MPI
+
+/*
+ * Descomposición por índice: cada rank integra y pre-calcula un tramo
+ * contiguo de bloques de SIM_BLOCK partículas (los mismos índices globales,
+ * así color y atractor de cada partícula no cambian). Por frame el rank 0
+ * difunde dt, t y la tabla de atractores; tras el pre-cálculo cada rank
+ * comparte su tramo de Precomp con Allgatherv y dibuja su tesela del mundo:
+ * rank r es la vista r de --outputs (mundo de size * W px). Solo este hilo
+ * llama a MPI (MPI_THREAD_FUNNELED).
+ */
+typedef struct MpiWorld
+{
+    int rank, size;
+    const Executor *inner;  // Ejecutor de cada tramo (--exec)
+    int *pc_count, *pc_off; // Bytes de Precomp por rank (Allgatherv)
+    int *orb_count, *orb_off; // Partículas por rank (Gatherv del checksum)
+} MpiWorld;
+
+static MpiWorld mpi_world; // Estado del ejecutor por tramos: sus callbacks no reciben contexto
+
+/** Tramo [*lo, *hi) del rank r sobre [0,n): bloques de `block` contiguos, repartidos parejo. */
+static void mpi_range(const MpiWorld *m, int r, int n, int block, int *lo, int *hi)
+{
+    long long nb = (n + block - 1) / block;
+    long long b0 = nb * r / m->size, b1 = nb * (r + 1) / m->size;
+    *lo = b0 * block < n ? (int)(b0 * block) : n;
+    *hi = b1 * block < n ? (int)(b1 * block) : n;
+}
+
+typedef struct
+{
+    ExecBlockFn fn;
+    void *ctx;
+    int off; // Primer índice del tramo
+} MpiSliceJob;
+
+static void mpi_slice_block(void *ctx, int i0, int i1)
+{
+    const MpiSliceJob *j = (const MpiSliceJob *)ctx;
+    j->fn(j->ctx, j->off + i0, j->off + i1);
+}
+
+static int mpi_threads(void) { return mpi_world.inner->threads(); }
+
+/** Solo los bloques del tramo de este rank, repartidos por el ejecutor interno. */
+static void mpi_for_blocks(int n, int block, ExecBlockFn fn, void *ctx)
+{
+    int lo, hi;
+    mpi_range(&mpi_world, mpi_world.rank, n, block, &lo, &hi);
+    MpiSliceJob j = {fn, ctx, lo};
+    if (hi > lo)
+        mpi_world.inner->for_blocks(hi - lo, block, mpi_slice_block, &j);
+}
+
+static const Executor EXECUTOR_MPI = {"mpi", mpi_threads, mpi_for_blocks};
+
+static void mpi_finish(void)
+{
+    free(mpi_world.pc_count);
+    MPI_Finalize();
+}
+
+/**
+ * MPI_Init (antes de parse_args: el lanzador puede tocar argv). Los ranks
+ * distintos de 0 no repiten el reporte por stdout. NULL con un solo rank.
+ */
+static MpiWorld *mpi_start(int *argc, char ***argv)
+{
+    int provided = 0;
+    MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    atexit(mpi_finish);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_world.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi_world.size);
+    if (mpi_world.size < 2)
+        return NULL;
+    if (mpi_world.rank != 0 && !freopen("/dev/null", "w", stdout))
+        fprintf(stderr, "MPI rank %d: no se pudo silenciar stdout\n", mpi_world.rank);
+    return &mpi_world;
+}
+
+/**
+ * Ajusta cfg al modo distribuido (avisa en el rank 0 lo que desactiva):
+ * --lod, --interact, --pipeline, --gpu y --adapt necesitan el mundo o el
+ * reloj de un solo proceso; instantáneas y repetición, el Orbiters completo.
+ * Las teselas son las vistas de --outputs y solo el rank 0 escribe log y
+ * grabación. Reserva los conteos de los colectivos para cfg->n partículas.
+ */
+static void mpi_configure(MpiWorld *m, Config *cfg)
+{
+    if (!m)
+        return;
+    char off[160] = "";
+    const struct
+    {
+        bool on;
+        const char *name;
+    } rules[] = {{cfg->lod != 0, " --lod"},
+                 {cfg->interact > 0.0f, " --interact"},
+                 {cfg->pipeline != 0, " --pipeline"},
+                 {cfg->gpu != 0, " --gpu"},
+                 {cfg->adapt != 0, " --adapt"},
+                 {cfg->backend != BACKEND_SDL, " --backend"},
+                 {cfg->load_state[0] || cfg->save_state[0] || cfg->save_frames[0] || cfg->replay_path[0], " instantáneas/--replay"}};
+    for (size_t k = 0; k < sizeof(rules) / sizeof(rules[0]); ++k)
+        if (rules[k].on)
+            strncat(off, rules[k].name, sizeof(off) - strlen(off) - 1);
+    if (m->rank == 0 && off[0] != '\0')
+        fprintf(stderr, "MPI (%d ranks): se desactiva%s\n", m->size, off);
+    cfg->lod = 0;
+    cfg->interact = 0.0f;
+    cfg->pipeline = 0;
+    cfg->gpu = 0;
+    cfg->adapt = 0;
+    cfg->backend = BACKEND_SDL;
+    cfg->load_state[0] = cfg->save_state[0] = cfg->save_frames[0] = cfg->replay_path[0] = '\0';
+    cfg->outputs = m->size;
+    if (m->rank != 0)
+        cfg->log_path[0] = cfg->record_path[0] = cfg->trace_path[0] = '\0';
+
+    m->inner = executor_get(cfg->exec);
+    m->pc_count = (int *)malloc(sizeof(int) * 4 * (size_t)m->size);
+    if (!m->pc_count)
+    {
+        fprintf(stderr, "MPI rank %d: sin memoria\n", m->rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    m->pc_off = m->pc_count + m->size;
+    m->orb_count = m->pc_off + m->size;
+    m->orb_off = m->orb_count + m->size;
+    for (int r = 0; r < m->size; ++r)
+    {
+        int lo, hi;
+        mpi_range(m, r, cfg->n, SIM_BLOCK, &lo, &hi);
+        m->orb_off[r] = lo;
+        m->orb_count[r] = hi - lo;
+        m->pc_off[r] = lo * (int)sizeof(Precomp);
+        m->pc_count[r] = (hi - lo) * (int)sizeof(Precomp);
+    }
+}
+
+/** Ejecutor de física y pre-cálculo: el tramo de este rank (sin MPI, el de --exec). */
+static const Executor *mpi_executor(const MpiWorld *m, const Config *cfg)
+{
+    return m ? &EXECUTOR_MPI : executor_get(cfg->exec);
+}
+
+/**
+ * Todas las teselas usan la vista W x H del rank 0 (el RT escala a cada ventana).
+ * El mundo mide ranks·W y debe caber en los deltas de Precomp: si no, la
+ * tesela se achica (misma proporción) en vez de saturar las teselas externas.
+ */
+static void mpi_share_view(const MpiWorld *m, int *W, int *H)
+{
+    if (!m)
+        return;
+    int v[2] = {*W, *H};
+    MPI_Bcast(v, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    const int wmax = PC_WORLD_W_MAX / m->size;
+    if (v[0] > wmax)
+    {
+        int h = (int)((long long)v[1] * wmax / v[0]);
+        h = h > 1 ? h : 1;
+        if (m->rank == 0)
+            fprintf(stderr, "MPI (%d ranks): tesela de %dx%d px reducida a %dx%d (mundo máx. %d px de ancho)\n",
+                    m->size, v[0], v[1], wmax, h, PC_WORLD_W_MAX);
+        v[0] = wmax;
+        v[1] = h;
+    }
+    *W = v[0];
+    *H = v[1];
+}
+
+/** Inicio de frame: corta si algún rank cierra y toma dt y t del rank 0. */
+static void mpi_sync_frame(const MpiWorld *m, bool *running, double *dt, double *t)
+{
+    if (!m)
+        return;
+    int go = *running ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &go, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    *running = go != 0;
+    double v[2] = {*dt, *t};
+    MPI_Bcast(v, 2, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    *dt = v[0];
+    *t = v[1];
+}
+
+/** Difunde la tabla de atractores del rank 0 (posiciones y centros del paso). */
+static void mpi_share_attractors(const MpiWorld *m, Attractors *a)
+{
+    if (m)
+        MPI_Bcast(a->mem, 10 * a->n, MPI_FLOAT, 0, MPI_COMM_WORLD);
+}
+
+/** Completa pc con los tramos de los demás ranks (el propio ya está escrito). */
+static void mpi_gather_precomp(const MpiWorld *m, Precomp *pc)
+{
+    if (m)
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, pc, m->pc_count, m->pc_off, MPI_BYTE, MPI_COMM_WORLD);
+}
+
+/** Junta en el rank 0 los campos del checksum de todos los tramos. */
+static void mpi_gather_orbiters(const MpiWorld *m, Orbiters *o)
+{
+    if (!m)
+        return;
+    float *f[] = {o->x, o->y, o->px, o->py, o->vx, o->vy, o->angle};
+    for (size_t k = 0; k < sizeof(f) / sizeof(f[0]); ++k)
+    {
+        float *own = f[k] + m->orb_off[m->rank];
+        MPI_Gatherv(m->rank == 0 ? MPI_IN_PLACE : own, m->orb_count[m->rank], MPI_FLOAT, f[k], m->orb_count, m->orb_off,
+                    MPI_FLOAT, 0, MPI_COMM_WORLD);
+    }
+}
+
+#else // Sin USE_MPI: un solo proceso
+
+typedef struct MpiWorld
+{
+    int rank, size;
+} MpiWorld;
+
+static MpiWorld *mpi_start(int *argc, char ***argv)
+{
+    (void)argc, (void)argv;
+    return NULL;
+}
+static void mpi_configure(MpiWorld *m, Config *cfg) { (void)m, (void)cfg; }
+static const Executor *mpi_executor(const MpiWorld *m, const Config *cfg)
+{
+    (void)m;
+    return executor_get(cfg->exec);
+}
+static void mpi_share_view(const MpiWorld *m, int *W, int *H) { (void)m, (void)W, (void)H; }
+static void mpi_sync_frame(const MpiWorld *m, bool *running, double *dt, double *t) { (void)m, (void)running, (void)dt, (void)t; }
+static void mpi_share_attractors(const MpiWorld *m, Attractors *a) { (void)m, (void)a; }
+static void mpi_gather_precomp(const MpiWorld *m, Precomp *pc) { (void)m, (void)pc; }
+static void mpi_gather_orbiters(const MpiWorld *m, Orbiters *o) { (void)m, (void)o; }
+
+#endif // USE_MPI
+
+// ------------------------ Simulación por frame y pipeline ------------------------
+
+/**
+ * Un paso de simulación: atractores, interacción por rejilla (si grid),
+ * física y pre-cálculo (fusionados o no) escritos en pc; si batch admite el
+ * frame, el pre-cálculo emite sus vértices. Con lod != NULL el pre-cálculo va
+ * a lod->src y pc recibe la lista de dibujo (clases en *lc), que se emite
+ * después. Suma los ticks en ticks[STAGE_UPDATE] (incluida la rejilla) y
+ * ticks[STAGE_PRECALC] (incluido el nivel de detalle). Con mpi != NULL solo
+ * simula el tramo del rank (atractores del rank 0) y completa pc con los
+ * demás; los colectivos cuentan en ticks[STAGE_WAIT]. Con perfil, cada
+ * región pasa por el ejecutor PROF y cada etapa deja su tramo en la traza.
+ */
+static void simulate_frame(const Config *cfg, const ColorLUT *lut, Orbiters *orbs, ParticleGrid *grid, Attractors *att, LodState *lod,
+                           float dt, float t, int W, int H, Precomp *pc, LodCounts *lc, SpriteBatch *batch, int draw_sym,
+                           uint64_t ticks[STAGE_COUNT], const MpiWorld *mpi)
+{
+    // Lotes: parámetros de expansión del frame; si cabe, el pre-cálculo emite vértices
+    SpriteBatch *emit = NULL;
+    if (batch && batch_begin_frame(batch, cfg, cfg->n, draw_sym, cfg->mirror, W * 0.5f, H * 0.5f))
+        emit = batch;
+    Precomp *out = pc;
+    if (lod)
+    {
+        out = lod->src;
+        emit = NULL;
+    }
+
+    const Executor *ex = executor_get(cfg->exec);
+    uint64_t mark = SDL_GetPerformanceCounter(), now;
+    update_attractors(prof_executor(ex, "attractors"), att, t, W, H);
+    if (mpi)
+    {
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_UPDATE] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_UPDATE], mark, now);
+        mpi_share_attractors(mpi, att);
+        mark = SDL_GetPerformanceCounter();
+        ticks[STAGE_WAIT] += mark - now;
+        prof_span(STAGE_NAMES[STAGE_WAIT], now, mark);
+        ex = mpi_executor(mpi, cfg);
+    }
+    if (grid)
+        interact_particles(grid, orbs, cfg->interact, dt);
+    if (cfg->fused)
+    {
+        // Una región: su tiempo se reporta en update (precalc queda en 0 salvo --lod)
+        update_precalc_fused(prof_executor(ex, "update+precalc"), cfg, lut, orbs, att, dt, t, W * 0.5f, H * 0.5f, out, emit);
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_UPDATE] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_UPDATE], mark, now);
+    }
+    else
+    {
+        update_orbiters(prof_executor(ex, "update"), orbs, att, dt, cfg->fast_math);
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_UPDATE] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_UPDATE], mark, now);
+        mark = now;
+        precalc_particles(prof_executor(ex, "precalc"), cfg, lut, orbs, t, W * 0.5f, H * 0.5f, out, emit);
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_PRECALC] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_PRECALC], mark, now);
+    }
+    if (mpi)
+    {
+        mark = SDL_GetPerformanceCounter();
+        mpi_gather_precomp(mpi, pc);
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_WAIT] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_WAIT], mark, now);
+    }
+    if (lod)
+    {
+        // Lista de dibujo por importancia y, con lotes, su emisión
+        mark = now;
+        int copies = draw_sym * (cfg->mirror ? 2 : 1);
+        lod_build(lod, cfg->lod_budget, copies, lod_quads_full(cfg->trail, cfg->glow), pc, lc);
+        if (batch)
+            batch_set_list(batch, pc, lc);
+        now = SDL_GetPerformanceCounter();
+        ticks[STAGE_PRECALC] += now - mark;
+        prof_span(STAGE_NAMES[STAGE_PRECALC], mark, now);
+    }
+}
+
+#define PIPE_SLOTS 2 // Doble buffer: el productor llena uno mientras se dibuja el otro
+
+/**
+ * Frame producido (pc + vértices + atractores + tiempo) y, de vuelta, los
+ * parámetros que el consumidor fija al liberarlo para el siguiente llenado.
+ */
+typedef struct
 {
-    Uint8 r = 0, g = 0, b = 0, a = (Uint8)cfg->bg_alpha;
-    if (str_ieq(cfg->palette, "ocean"))
-        hsv2rgb(210.0f + 6.0f * sinf(0.10f * t), 0.25f, 0.16f, &r, &g, &b);
+    Precomp *pc;
+    LodCounts lod;               // Clases de la lista de dibujo (--lod 1)
+    SpriteBatch *batch;          // NULL si --batch 0
+    float *atx, *aty;            // Posiciones de atractores del frame (para show_attractors)
+    float t;                     // Tiempo de simulación del frame
+    int draw_sym;                // Simetrías con que se emitió
+    uint64_t ticks[STAGE_COUNT]; // Ticks de update/precalc en el productor
+    double req_dt;               // Pedido del consumidor: dt del próximo paso
+    int req_sym;                 //   simetrías efectivas (calidad adaptativa)
+    float req_render_frac;       //   fracción de render
+    float req_lod_budget;        //   presupuesto de sprites (--lod 1)
+    int req_glow;                //   glow
+} FrameSlot;
+
+/**
+ * Productor/consumidor con dos slots: free_sem cuenta slots libres y full_sem
+ * frames listos. Ambos lados recorren los slots en el mismo orden alterno,
+ * así que el traspaso es solo el índice (sin mutex ni copia de buffers).
+ */
+typedef struct
+{
+    FrameSlot slot[PIPE_SLOTS];
+    SDL_sem *free_sem, *full_sem;
+    SDL_atomic_t quit;
+    SDL_Thread *thread;
+    Config cfg;                  // Copia privada del productor
+    const ColorLUT *lut;
+    Orbiters *orbs;              // Propiedad exclusiva del productor mientras corre
+    ParticleGrid *grid;          // Ídem (NULL sin --interact)
+    Attractors *att;             // Ídem
+    LodState *lod;               // Ídem (NULL sin --lod)
+    int W, H, threads;
+    int limit;                   // Frames a producir (0 = sin límite)
+    double t;
+} Pipeline;
+
+/** Hilo productor: simula en el slot libre y lo publica al consumidor. */
+static int pipeline_producer(void *arg)
+{
+    Pipeline *p = (Pipeline *)arg;
+#ifdef _OPENMP
+    team_setup(&p->cfg, p->threads, 1); // ICV por hilo: el equipo del productor no lo hereda de main
+#endif
+    prof_set_producer();
+    for (int k = 0, made = 0; p->limit == 0 || made < p->limit; k ^= 1, ++made)
+    {
+        SDL_SemWait(p->free_sem);
+        if (SDL_AtomicGet(&p->quit))
+            break;
+        FrameSlot *s = &p->slot[k];
+        p->cfg.render_frac = s->req_render_frac;
+        p->cfg.lod_budget = s->req_lod_budget;
+        p->cfg.glow = s->req_glow;
+        p->t += s->req_dt;
+        memset(s->ticks, 0, sizeof(s->ticks));
+        simulate_frame(&p->cfg, p->lut, p->orbs, p->grid, p->att, p->lod, (float)s->req_dt, (float)p->t, p->W, p->H,
+                       s->pc, &s->lod, s->batch, s->req_sym, s->ticks, NULL);
+        memcpy(s->atx, p->att->x, sizeof(float) * (size_t)p->att->n);
+        memcpy(s->aty, p->att->y, sizeof(float) * (size_t)p->att->n);
+        s->t = (float)p->t;
+        s->draw_sym = s->req_sym;
+        SDL_SemPost(p->full_sem);
+    }
+    return 0;
+}
+
+/** Libera el pipeline; el slot 0 (pc/batch de main) no se libera aquí. */
+static void pipeline_free(Pipeline *p)
+{
+    if (!p)
+        return;
+    if (p->free_sem)
+        SDL_DestroySemaphore(p->free_sem);
+    if (p->full_sem)
+        SDL_DestroySemaphore(p->full_sem);
+    for (int k = 0; k < PIPE_SLOTS; ++k)
+    {
+        free(p->slot[k].atx); // aty comparte el bloque
+        if (k == 0)
+            continue;
+        batch_free(p->slot[k].batch);
+        free(p->slot[k].pc);
+    }
+    free(p);
+}
+
+/**
+ * Arranca el productor. El slot 0 usa pc/batch de main y el resto se reserva
+ * aquí (con atlas compartido). Atractores, orbs, rejilla y LodState pasan al
+ * productor hasta pipeline_stop; con limit > 0 produce exactamente limit frames, así orbs queda
+ * en el mismo estado que sin pipeline. La simulación sigue desde el tiempo t0.
+ * NULL si falta memoria o no hay hilo.
+ */
+static Pipeline *pipeline_start(const Config *cfg, const ColorLUT *lut, Orbiters *orbs, ParticleGrid *grid, Attractors *att,
+                                LodState *lod, Precomp *pc, SpriteBatch *batch, int W, int H, int threads, double dt0, double t0,
+                                int draw_sym, int limit)
+{
+    Pipeline *p = (Pipeline *)calloc(1, sizeof(Pipeline));
+    if (!p)
+        return NULL;
+    p->cfg = *cfg;
+    p->lut = lut;
+    p->orbs = orbs;
+    p->grid = grid;
+    p->att = att;
+    p->lod = lod;
+    p->W = W;
+    p->H = H;
+    p->threads = threads;
+    p->limit = limit;
+    p->t = t0;
+    p->slot[0].pc = pc;
+    p->slot[0].batch = batch;
+    for (int k = 0; k < PIPE_SLOTS; ++k)
+    {
+        FrameSlot *s = &p->slot[k];
+        s->atx = (float *)malloc(sizeof(float) * 2 * (size_t)att->n);
+        if (!s->atx)
+        {
+            pipeline_free(p);
+            return NULL;
+        }
+        s->aty = s->atx + att->n;
+        if (k > 0)
+        {
+            s->pc = (Precomp *)malloc(sizeof(Precomp) * (size_t)cfg->n);
+            s->batch = batch ? batch_create_shared(batch) : NULL;
+            if (!s->pc || (batch && !s->batch))
+            {
+                pipeline_free(p);
+                return NULL;
+            }
+        }
+        s->req_dt = dt0;
+        s->req_sym = draw_sym;
+        s->req_render_frac = cfg->render_frac;
+        s->req_lod_budget = cfg->lod_budget;
+        s->req_glow = cfg->glow;
+    }
+    p->free_sem = SDL_CreateSemaphore(PIPE_SLOTS);
+    p->full_sem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&p->quit, 0);
+    if (p->free_sem && p->full_sem)
+        p->thread = SDL_CreateThread(pipeline_producer, "producer", p);
+    if (!p->thread)
+    {
+        pipeline_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * Detiene el productor (lo despierta si espera un slot) y libera el pipeline.
+ * Deja en *t el tiempo del último frame simulado (va un frame adelante del
+ * dibujado); acepta NULL y entonces no toca *t.
+ */
+static void pipeline_stop(Pipeline *p, double *t)
+{
+    if (!p)
+        return;
+    SDL_AtomicSet(&p->quit, 1);
+    SDL_SemPost(p->free_sem);
+    SDL_WaitThread(p->thread, NULL);
+    *t = p->t;
+    pipeline_free(p);
+}
+
+// ------------------------ Vistas múltiples (--outputs K) ------------------------
+
+/*
+ * Con --outputs K el mundo mide K*W x H y la salida k dibuja la vista
+ * [k*W, (k+1)*W). La 0 es la de siempre (ventana y renderer de main); cada
+ * extra tiene ventana propia (centrada en el display k si existe) y un hilo
+ * que crea y usa su renderer, sprites, lotes y RT. Física y pre-cálculo
+ * corren una vez por frame: cada vista expande el mismo Precomp a sus vértices.
+ */
+#if defined(__APPLE__)
+#define OUTPUT_THREADS 0 // Cocoa: el renderer de SDL solo desde el hilo principal (las vistas van en serie)
+#else
+#define OUTPUT_THREADS 1
+#endif
+
+/** Frame que main publica a las vistas extra; no lo reescribe hasta outputs_wait. */
+typedef struct
+{
+    Config cfg;             // Copia con las perillas vigentes (adaptación, SSAA)
+    const Precomp *pc;      // Lista de dibujo del frame (n entradas)
+    int n;
+    LodCounts lod;          // Clases de la lista (si has_lod)
+    bool has_lod;
+    const float *atx, *aty; // Atractores del frame
+    int na;
+    float t;                // Tiempo de simulación del frame
+    int sym;                // Simetrías con que se dibuja
+} OutputFrame;
+
+typedef struct OutputSet OutputSet;
+
+/** Vista extra k >= 1: ren y lo que cuelga de él solo se usan en su hilo. */
+typedef struct
+{
+    OutputSet *set;
+    int index;              // k: columna k*W del mundo
+    SDL_Window *win;        // NULL en headless
+    SDL_Surface *offscreen; // Destino del renderer software en headless
+    SDL_Renderer *ren;
+    SDL_Texture *discs[6], *radial;
+    SDL_Texture *rt;        // RT persistente (SSAA y --trail 2); NULL => directo al backbuffer
+    int ssaa, RW, RH;
+    SpriteBatch *batch;     // NULL => sprite a sprite
+    SDL_sem *go;            // Un post por frame publicado
+    SDL_Thread *thread;
+    bool ok;                // Renderer listo (el hilo lo fija antes del primer post a done)
+} Output;
+
+struct OutputSet
+{
+    Output out[OUTPUTS_MAX - 1];
+    int count;              // Vistas extra abiertas
+    int W, H;               // Tamaño de cada vista (el del backbuffer de la salida 0)
+    int threads;            // Hilos OpenMP de cada vista extra (reparto de los de main)
+    OutputFrame frame;
+    SDL_sem *done;          // Un post por vista lista y por frame dibujado
+    SDL_atomic_t quit;
+};
+
+/** Crea en el hilo que llama el renderer de la vista y sus recursos; false si no hay renderer. */
+static bool output_open(Output *o)
+{
+    const OutputSet *set = o->set;
+    const Config *cfg = &set->frame.cfg;
+    if (o->offscreen)
+        o->ren = SDL_CreateSoftwareRenderer(o->offscreen);
     else
-        hsv2rgb(200.0f, 0.10f, 0.14f, &r, &g, &b);
-    RGBA out = {r, g, b, a};
-    return out;
+        o->ren = SDL_CreateRenderer(o->win, -1, SDL_RENDERER_ACCELERATED | (cfg->vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+    if (!o->ren)
+    {
+        fprintf(stderr, "Vista %d: error SDL_CreateRenderer: %s\n", o->index, SDL_GetError());
+        return false;
+    }
+    for (int r = 1; r <= 5; ++r)
+        o->discs[r] = make_disc_texture(o->ren, r);
+    o->radial = make_radial_texture(o->ren, 32);
+    if (cfg->batch && !(o->batch = batch_create(o->ren)))
+        fprintf(stderr, "Vista %d: no se pudo crear SpriteBatch; se usa RenderCopyF por sprite\n", o->index);
+    set_ssaa(o->ren, set->W, set->H, cfg->ssaa, true, &o->ssaa, &o->rt, &o->RW, &o->RH);
+    return true;
 }
 
-/** Color de partícula por paleta con control de saturación global. */
-static void particle_color(const Config *cfg, int i, float t, Uint8 *r, Uint8 *g, Uint8 *b)
+/** Libera lo creado por output_open (en el mismo hilo); acepta una vista sin abrir. */
+static void output_close(Output *o)
 {
-    float hue, sat, val;
-    if (str_ieq(cfg->palette, "ocean"))
+    for (int r = 1; r <= 5; ++r)
+        if (o->discs[r])
+            SDL_DestroyTexture(o->discs[r]);
+    if (o->radial)
+        SDL_DestroyTexture(o->radial);
+    if (o->rt)
+        SDL_DestroyTexture(o->rt);
+    batch_free(o->batch);
+    if (o->ren)
+        SDL_DestroyRenderer(o->ren);
+}
+
+/**
+ * Dibuja el frame publicado en la vista: sus vértices (centro del mundo
+ * desplazado a la columna de la vista), render_frame en el RT y present.
+ */
+static void output_draw(Output *o)
+{
+    const OutputSet *set = o->set;
+    const OutputFrame *f = &set->frame;
+    const Config *cfg = &f->cfg;
+    const LodCounts *lc = f->has_lod ? &f->lod : NULL;
+    const float x0 = (float)(o->index * set->W);
+    if (cfg->ssaa != o->ssaa)
+        set_ssaa(o->ren, set->W, set->H, cfg->ssaa, true, &o->ssaa, &o->rt, &o->RW, &o->RH);
+    if (o->batch)
+        snap_emit_batch(o->batch, cfg, f->pc, f->n, lc, f->sym, (float)(cfg->outputs * set->W) * 0.5f - x0, set->H * 0.5f);
+    if (o->rt)
     {
-        hue = 180.0f + fmodf((float)i * 3.5f + 18.0f * sinf(0.21f * t + i * 0.05f), 40.0f);
-        sat = 0.65f + 0.20f * sinf(0.13f * t + i * 0.09f);
-        val = 0.95f;
+        SDL_SetRenderTarget(o->ren, o->rt);
+        SDL_RenderSetScale(o->ren, (float)o->ssaa, (float)o->ssaa);
     }
-    else // neon
+    render_frame(o->ren, cfg, f->pc, f->n, lc, f->atx, f->aty, f->na, set->W, set->H, x0, f->t, f->sym, o->discs, o->radial,
+                 o->batch, NULL);
+    if (o->rt)
     {
-        hue = fmodf((float)i * 137.508f + 90.0f * sinf(0.23f * t + i * 0.031f), 360.0f);
-        if (hue < 0.0f)
-            hue += 360.0f;
-        sat = 0.85f;
-        val = 1.00f;
+        SDL_RenderSetScale(o->ren, 1.0f, 1.0f);
+        SDL_SetRenderTarget(o->ren, NULL);
+        SDL_RenderCopy(o->ren, o->rt, NULL, NULL);
     }
-    sat *= cfg->sat_mul;
-    if (sat < 0.0f)
-        sat = 0.0f;
-    if (sat > 1.0f)
-        sat = 1.0f;
-    hsv2rgb(hue, sat, val, r, g, b);
+    if (o->win)
+        SDL_RenderPresent(o->ren);
 }
 
-// ------------------------ Dibujo de partículas (GPU) ------------------------
+#if OUTPUT_THREADS
+/** Hilo de una vista: abre su renderer, avisa y dibuja un frame por cada post a go. */
+static int output_thread(void *arg)
+{
+    Output *o = (Output *)arg;
+    OutputSet *set = o->set;
+#ifdef _OPENMP
+    team_setup(&set->frame.cfg, set->threads, (set->frame.cfg.pipeline ? 1 : 0) + o->index); // ICV por hilo, como el productor del pipeline
+#endif
+    o->ok = output_open(o);
+    SDL_SemPost(set->done);
+    while (o->ok)
+    {
+        SDL_SemWait(o->go);
+        if (SDL_AtomicGet(&set->quit))
+            break;
+        output_draw(o);
+        SDL_SemPost(set->done);
+    }
+    output_close(o);
+    return 0;
+}
+#endif
+
+/** Espera el hilo de la vista (que cierra su renderer) y destruye ventana o superficie. */
+static void output_free(Output *o)
+{
+    if (o->thread)
+        SDL_WaitThread(o->thread, NULL);
+    else
+        output_close(o);
+    if (o->go)
+        SDL_DestroySemaphore(o->go);
+    if (o->win)
+        SDL_DestroyWindow(o->win);
+    if (o->offscreen)
+        SDL_FreeSurface(o->offscreen);
+    memset(o, 0, sizeof(*o));
+}
+
+/** Cierra las vistas extra (despierta sus hilos con quit); acepta NULL. */
+static void outputs_destroy(OutputSet *set)
+{
+    if (!set)
+        return;
+    SDL_AtomicSet(&set->quit, 1);
+    for (int k = 0; k < set->count; ++k)
+    {
+        if (set->out[k].go)
+            SDL_SemPost(set->out[k].go);
+        output_free(&set->out[k]);
+    }
+    if (set->done)
+        SDL_DestroySemaphore(set->done);
+    free(set);
+}
 
 /**
- * Dibuja todas las partículas con simetría y espejo, usando:
- *   - sprites de discos (núcleo y colitas),
- *   - sprite radial para halo (si glow),
- *   - líneas de estela larga opcionales.
- * Respeta cfg.render_frac (salta partículas para acelerar) y ajusta alphas
- * según la cantidad de copias (simetrías * espejos).
+ * Abre las cfg->outputs - 1 vistas extra de W x H (ventanas en main; en
+ * headless, superficies con renderer software) y espera a que cada hilo tenga
+ * su renderer. La vista que no abre se omite (su columna del mundo queda sin
+ * mostrar). NULL si no queda ninguna.
  */
-static void draw_particles(SDL_Renderer *ren, const Config *cfg, const Precomp *pc, int n, int symN, int mirror, float cx, float cy, SDL_Texture **discs, SDL_Texture *radial)
+static OutputSet *outputs_create(const Config *cfg, int W, int H, int threads)
 {
-    float cosA[8], sinA[8];
-    if (symN < 1)
-        symN = 1;
-    if (symN > 8)
-        symN = 8;
-    for (int m = 0; m < symN; ++m)
+    OutputSet *set = (OutputSet *)calloc(1, sizeof(OutputSet));
+    if (!set)
+        return NULL;
+    set->W = W;
+    set->H = H;
+    set->threads = threads / cfg->outputs > 0 ? threads / cfg->outputs : 1;
+    set->frame.cfg = *cfg;
+    SDL_AtomicSet(&set->quit, 0);
+    set->done = SDL_CreateSemaphore(0);
+    const int ndisp = cfg->headless ? 0 : SDL_GetNumVideoDisplays();
+    for (int k = 1; k < cfg->outputs && set->done; ++k)
     {
-        float ang = 2.0f * (float)M_PI * (float)m / (float)symN;
-        cosA[m] = cosf(ang);
-        sinA[m] = sinf(ang);
+        Output *o = &set->out[set->count];
+        o->set = set;
+        o->index = k;
+        if (cfg->headless)
+        {
+            o->offscreen = SDL_CreateRGBSurfaceWithFormat(0, W, H, 32, SDL_PIXELFORMAT_RGBA32);
+        }
+        else
+        {
+            char title[64];
+            snprintf(title, sizeof(title), "Screensaver (paralelo) - vista %d", k);
+            int d = ndisp > 0 ? k % ndisp : 0;
+            o->win = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED_DISPLAY(d), SDL_WINDOWPOS_CENTERED_DISPLAY(d),
+                                      cfg->width, cfg->height, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+        }
+        bool ok = o->win || o->offscreen;
+#if OUTPUT_THREADS
+        char name[24];
+        snprintf(name, sizeof(name), "output%d", k);
+        if (ok)
+            o->go = SDL_CreateSemaphore(0);
+        if (o->go)
+            o->thread = SDL_CreateThread(output_thread, name, o);
+        if (o->thread)
+            SDL_SemWait(set->done); // Renderer creado (o fallido) en el hilo
+        ok = o->thread && o->ok;
+#else
+        ok = ok && (o->ok = output_open(o));
+#endif
+        if (!ok)
+        {
+            fprintf(stderr, "No se pudo abrir la vista %d; se omite\n", k);
+            output_free(o);
+            continue;
+        }
+        set->count++;
     }
-    float alpha_div = (float)((mirror ? 2 : 1) * symN);
-    int glow_on = cfg->glow ? 1 : 0;
+    if (set->count == 0)
+    {
+        outputs_destroy(set);
+        return NULL;
+    }
+    return set;
+}
 
-    // Paso de muestreo para omitir partículas (solo dibujo) manteniendo la física completa
-    int step = (cfg->render_frac >= 0.999f) ? 1 : (int)lroundf(1.0f / cfg->render_frac);
-    if (step < 1)
-        step = 1;
+/**
+ * Publica el frame (pc, lista, atractores y perillas vigentes) y despierta a
+ * las vistas; sin hilos de vista las dibuja aquí mismo. Acepta NULL.
+ */
+static void outputs_draw(OutputSet *set, const Config *cfg, const Precomp *pc, int n, const LodCounts *lc, const float *atx,
+                         const float *aty, int na, float t, int sym)
+{
+    if (!set)
+        return;
+    OutputFrame *f = &set->frame;
+    f->cfg = *cfg;
+    f->pc = pc;
+    f->n = n;
+    f->has_lod = lc != NULL;
+    if (lc)
+        f->lod = *lc;
+    f->atx = atx;
+    f->aty = aty;
+    f->na = na;
+    f->t = t;
+    f->sym = sym;
+    for (int k = 0; k < set->count; ++k)
+    {
+#if OUTPUT_THREADS
+        SDL_SemPost(set->out[k].go);
+#else
+        output_draw(&set->out[k]);
+#endif
+    }
+}
 
-    for (int i = 0; i < n; i += step)
+/** Espera a que todas las vistas terminen el frame publicado (luego main puede reescribirlo). */
+static void outputs_wait(OutputSet *set)
+{
+#if OUTPUT_THREADS
+    for (int k = 0; set && k < set->count; ++k)
+        SDL_SemWait(set->done);
+#else
+    (void)set;
+#endif
+}
+
+// ------------------------ Calidad adaptativa (--adapt 1) ------------------------
+
+#define ADAPT_PERIOD_S 0.25f  // Intervalo entre decisiones del controlador (s)
+#define ADAPT_SETTLE 3        // Frames tras un cambio que no se usan para estimar
+#define ADAPT_UP 0.85f        // Fracción del presupuesto que puede usar una subida de calidad
+#define ADAPT_FORGET 0.99     // Olvido del estimador (ventana efectiva ~100 frames)
+#define ADAPT_EWMA 0.1        // Peso de la muestra nueva en los promedios
+#define ADAPT_RIDGE 1e-3      // Regularización de las ecuaciones normales
+#define ADAPT_FRAC_FLOOR 0.6f // render_frac mínimo antes de sacrificar glow o simetrías
+
+/* Perillas de calidad que mueve --adapt, en orden de sacrificio inverso. */
+typedef struct
+{
+    int sym;    // Simetrías efectivas
+    int glow;   // 0/1
+    int ssaa;   // Factor de supersampling
+    float frac; // render_frac (con --lod 1: fracción del presupuesto inicial)
+} AdaptKnobs;
+
+/*
+ * AdaptCtl: controlador en espacio de tiempo de frame. Modela
+ *   frame_ms ≈ fijo + a·sprites + b·píxeles (render) + c·píxeles (resolve)
+ * con sprites = quads del frame (copias × quads por partícula × fracción) y
+ * píxeles = tamaño del render target. a y b salen de mínimos cuadrados con
+ * olvido (ecuaciones normales 2x2, acotados a >= 0 al resolver) sobre el
+ * tiempo de render de cada frame; c y la parte
+ * fija (eventos, física, pre-cálculo y present sin vsync) de promedios
+ * exponenciales. Con el modelo predice cada combinación de perillas y salta
+ * directo a la mejor que cabe en 1000/target_fps ms.
+ */
+typedef struct
+{
+    double theta[2];  // ms por Msprite y por Mpíxel del render
+    double A[2][2];   // Ecuaciones normales con olvido: A = Σ λ^k φφᵀ
+    double b[2];      //   b = Σ λ^k φ·render_ms
+    double resolve;   // ms por Mpíxel de resolve
+    double fixed_ms;  // Etapas que no dependen de las perillas
+    double pred_ms;   // Predicción para las perillas vigentes
+    int samples;      // Frames observados
+    int settle;       // Frames por descartar tras un cambio
+    int changes;      // Decisiones que movieron perillas
+} AdaptCtl;
+
+/** Estado inicial: sin muestras ni costos. */
+static void adapt_init(AdaptCtl *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+/** Perillas vigentes (la fracción de --lod 1 es relativa a lod_budget_max). */
+static AdaptKnobs adapt_current(const Config *cfg, int draw_sym, float lod_budget_max)
+{
+    float frac = cfg->lod ? (lod_budget_max > 0.0f ? cfg->lod_budget / lod_budget_max : 1.0f) : cfg->render_frac;
+    return (AdaptKnobs){draw_sym, cfg->glow, cfg->ssaa, frac};
+}
+
+/** Sprites (quads) por frame con las perillas k; con --lod 1 los acota el presupuesto. */
+static double adapt_sprites(const Config *cfg, const AdaptKnobs *k, float lod_budget_max)
+{
+    double full = (double)cfg->n * k->sym * (cfg->mirror ? 2 : 1) * lod_quads_full(cfg->trail, k->glow);
+    if (cfg->lod)
+        return fmin(full, (double)k->frac * lod_budget_max);
+    return full * k->frac;
+}
+
+/** Megapíxeles del render target con supersampling k->ssaa para una salida W x H. */
+static double adapt_mpixels(const AdaptKnobs *k, int W, int H)
+{
+    return (double)W * H * k->ssaa * k->ssaa * 1e-6;
+}
+
+/** Tiempo de frame (ms) que predice el modelo para las perillas k. */
+static double adapt_predict(const AdaptCtl *c, const Config *cfg, const AdaptKnobs *k, float lod_budget_max, int W, int H)
+{
+    double S = adapt_sprites(cfg, k, lod_budget_max) * 1e-6, P = adapt_mpixels(k, W, H);
+    return c->fixed_ms + c->theta[0] * S + (c->theta[1] + c->resolve) * P;
+}
+
+/**
+ * Incorpora un frame medido con las perillas k (ticks por etapa). Los frames
+ * de asentamiento tras un cambio se descartan: con --pipeline 1 el frame
+ * dibujado aún puede venir de las perillas anteriores.
+ */
+static void adapt_observe(AdaptCtl *c, const Config *cfg, const AdaptKnobs *k, float lod_budget_max, int W, int H,
+                          const uint64_t ticks[STAGE_COUNT])
+{
+    if (c->settle > 0)
     {
-        Uint8 rr = pc[i].r, gg = pc[i].g, bb = pc[i].b;
-        float dx0 = pc[i].dx0, dy0 = pc[i].dy0;
-        float dxp = pc[i].dxp, dyp = pc[i].dyp;
-        int pr = pc[i].pr;
-        if (pr < 1)
-            pr = 1;
-        if (pr > 3)
-            pr = 3;
+        c->settle--;
+        return;
+    }
+    double ms[STAGE_COUNT];
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        ms[s] = ticks_to_seconds(ticks[s]) * 1000.0;
+    // Con vsync el present absorbe la holgura: no es costo de las perillas
+    double fixed = ms[STAGE_EVENTS] + ms[STAGE_UPDATE] + ms[STAGE_PRECALC] + (cfg->vsync ? 0.0 : ms[STAGE_PRESENT]);
+    double phi[2] = {adapt_sprites(cfg, k, lod_budget_max) * 1e-6, adapt_mpixels(k, W, H)};
+    double w = c->samples ? ADAPT_EWMA : 1.0;
+    c->fixed_ms += w * (fixed - c->fixed_ms);
+    c->resolve += w * (ms[STAGE_RESOLVE] / phi[1] - c->resolve);
 
-        SDL_Texture *dot = discs[pr];
+    // Ecuaciones normales con olvido; sin variación en las perillas la
+    // regularización reparte el tiempo entre sprites y píxeles según φ
+    double y = ms[STAGE_RENDER];
+    for (int i = 0; i < 2; ++i)
+    {
+        c->b[i] = ADAPT_FORGET * c->b[i] + phi[i] * y;
+        for (int j = 0; j < 2; ++j)
+            c->A[i][j] = ADAPT_FORGET * c->A[i][j] + phi[i] * phi[j];
+    }
+    double a00 = c->A[0][0] + ADAPT_RIDGE, a11 = c->A[1][1] + ADAPT_RIDGE, a01 = c->A[0][1];
+    double det = a00 * a11 - a01 * a01;
+    c->theta[0] = (a11 * c->b[0] - a01 * c->b[1]) / det;
+    c->theta[1] = (a00 * c->b[1] - a01 * c->b[0]) / det;
+    if (c->theta[0] < 0.0)
+    {
+        c->theta[0] = 0.0;
+        c->theta[1] = fmax(0.0, c->b[1] / a11);
+    }
+    else if (c->theta[1] < 0.0)
+    {
+        c->theta[1] = 0.0;
+        c->theta[0] = fmax(0.0, c->b[0] / a00);
+    }
+    c->samples++;
+}
 
-        // Alphas base ajustados por cantidad de copias y glow
-        float a_scale = glow_on ? 1.0f : 0.6f;
-        Uint8 trailA = (Uint8)fmaxf(4.0f, (90.0f * a_scale) / alpha_div);
-        Uint8 tailA0 = (Uint8)fmaxf(3.0f, (34.0f * a_scale) / alpha_div);
-        Uint8 haloA = glow_on ? (Uint8)fmaxf(8.0f, 50.0f / alpha_div) : 0;
-        Uint8 nucA = (Uint8)fmaxf(70.0f, (185.0f + 50.0f * 0.5f) / alpha_div);
+/**
+ * Mayor fracción en [lo,1] con la que k cabe en budget ms (k->frac se
+ * ignora); -1 si ni siquiera cabe con lo.
+ */
+static float adapt_solve_frac(const AdaptCtl *c, const Config *cfg, AdaptKnobs k, float lod_budget_max, int W, int H,
+                              double budget, float lo)
+{
+    k.frac = 1.0f;
+    double at1 = adapt_predict(c, cfg, &k, lod_budget_max, W, H);
+    if (at1 <= budget)
+        return 1.0f;
+    k.frac = 0.0f;
+    double at0 = adapt_predict(c, cfg, &k, lod_budget_max, W, H);
+    if (!(at1 > at0))
+        return -1.0f; // La fracción no cambia el costo: no alcanza
+    float f = (float)((budget - at0) / (at1 - at0));
+    return f >= lo ? f : -1.0f;
+}
 
-        // Repite por cada rotación de simetría y espejo vertical opcional
-        for (int m = 0; m < symN; ++m)
-        {
-            float xr = cx + dx0 * cosA[m] - dy0 * sinA[m];
-            float yr = cy + dx0 * sinA[m] + dy0 * cosA[m];
-            float xpr = cx + dxp * cosA[m] - dyp * sinA[m];
-            float ypr = cy + dxp * sinA[m] + dyp * cosA[m];
+/** true si a es mejor calidad que b (simetrías > glow > supersampling > fracción). */
+static bool adapt_better(const AdaptKnobs *a, const AdaptKnobs *b)
+{
+    if (a->sym != b->sym)
+        return a->sym > b->sym;
+    if (a->glow != b->glow)
+        return a->glow > b->glow;
+    if (a->ssaa != b->ssaa)
+        return a->ssaa > b->ssaa;
+    return a->frac > b->frac + 0.02f;
+}
 
-            for (int mir = 0; mir < (mirror ? 2 : 1); ++mir)
+/**
+ * Elige perillas para target_fps: recorre las combinaciones de mejor a peor
+ * calidad (sacrifica primero SSAA, luego fracción hasta ADAPT_FRAC_FLOOR,
+ * luego glow y por último simetrías hasta 4, como la escalera de --adapt 2) y
+ * toma la primera que el modelo predice dentro del presupuesto; subir de
+ * calidad exige que sobre (ADAPT_UP). Sin ninguna, la peor con la fracción
+ * mínima. Retorna true si cambia algo respecto de cur.
+ */
+static bool adapt_decide(AdaptCtl *c, const Config *cfg, const AdaptKnobs *cur, const AdaptKnobs *top, float lod_budget_max,
+                         int W, int H, AdaptKnobs *out)
+{
+    const double T = 1000.0 / (double)cfg->target_fps;
+    const int sym_lo = top->sym < 4 ? top->sym : 4;
+    const float frac_min = cfg->lod ? 0.1f : 0.05f;
+    bool found = false;
+    for (int sym = top->sym; sym >= sym_lo && !found; --sym)
+        for (int glow = top->glow; glow >= 0 && !found; --glow)
+            for (int ssaa = top->ssaa; ssaa >= 1 && !found; --ssaa)
             {
-                float X = mir ? (2.0f * cx - xr) : xr;
-                float Y = yr;
-                float XP = mir ? (2.0f * cx - xpr) : xpr;
-                float YP = ypr;
-
-                // Estela larga opcional (línea)
-                if (cfg->trail)
+                const bool last = sym == sym_lo && glow == 0 && ssaa == 1;
+                AdaptKnobs k = {sym, glow, ssaa, 1.0f};
+                // Fracción continua solo sin SSAA (con SSAA > 1 se exige fracción completa)
+                float lo = ssaa > 1 ? 1.0f : (last ? frac_min : ADAPT_FRAC_FLOOR);
+                float f_keep = adapt_solve_frac(c, cfg, k, lod_budget_max, W, H, T, lo);
+                if (f_keep < 0.0f)
+                    continue;
+                k.frac = f_keep;
+                if (sym == cur->sym && glow == cur->glow && ssaa == cur->ssaa)
                 {
-                    SDL_SetRenderDrawBlendMode(ren, glow_on ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_BLEND);
-                    SDL_SetRenderDrawColor(ren, rr, gg, bb, trailA);
-                    SDL_RenderDrawLine(ren, (int)lroundf(XP), (int)lroundf(YP), (int)lroundf(X), (int)lroundf(Y));
+                    // Mismas perillas discretas: la fracción baja libre y sube solo con margen
+                    float f_up = adapt_solve_frac(c, cfg, k, lod_budget_max, W, H, ADAPT_UP * T, lo);
+                    if (k.frac > cur->frac)
+                        k.frac = f_up > cur->frac ? f_up : cur->frac;
                 }
-
-                // Colitas de 2 discos (puntos intermedios entre pos previa y actual)
-                float ddx = X - XP, ddy = Y - YP;
-                for (int c = 1; c <= 2; ++c)
+                else if (adapt_better(&k, cur))
                 {
-                    float tpos = (float)c / 4.0f;
-                    float cxp = X - ddx * tpos, cyp = Y - ddy * tpos;
-                    Uint8 ca = (Uint8)fmaxf(3.0f, (float)tailA0 / (float)c);
-                    int pr2 = (pr - c >= 1) ? (pr - c) : 1;
-                    SDL_SetTextureColorMod(discs[pr2], rr, gg, bb);
-                    SDL_SetTextureAlphaMod(discs[pr2], ca);
-                    SDL_FRect rct = {(float)(cxp - pr2), (float)(cyp - pr2), (float)(pr2 * 2 + 1), (float)(pr2 * 2 + 1)};
-                    SDL_RenderCopyF(ren, discs[pr2], NULL, &rct);
+                    float f_up = adapt_solve_frac(c, cfg, k, lod_budget_max, W, H, ADAPT_UP * T, lo);
+                    if (f_up < 0.0f)
+                        continue;
+                    k.frac = f_up;
                 }
+                *out = k;
+                found = true;
+            }
+    if (!found)
+        *out = (AdaptKnobs){sym_lo, 0, 1, frac_min};
+    c->pred_ms = adapt_predict(c, cfg, out, lod_budget_max, W, H);
+    bool changed = out->sym != cur->sym || out->glow != cur->glow || out->ssaa != cur->ssaa || fabsf(out->frac - cur->frac) > 0.02f;
+    if (!changed)
+        out->frac = cur->frac;
+    else
+    {
+        c->changes++;
+        c->settle = ADAPT_SETTLE;
+    }
+    return changed;
+}
+
+// ------------------------ Overlay de perfil (--overlay 1) ------------------------
+
+#define OVL_PERIOD_MS 250  // Período de las barras (media de sus frames) y de rearmado de rectángulos
+#define OVL_MAX_RECTS 8192
+#define OVL_MAX_GROUPS 32
+#define OVL_MAX_LANES 32   // Hilos mostrados por equipo
+#define OVL_BAR 240        // Largo (px) de la barra llena; el presupuesto del frame cae en la mitad
+#define OVL_ROW 12         // Alto de fila (px)
+#define OVL_CELL 2         // Lado (px) de cada celda de la fuente de 3x5
+
+/*
+ * Overlay sin fuente de texto: rectángulos de color en la esquina superior
+ * izquierda, de arriba abajo:
+ *   - una fila por etapa (colores de OVL_STAGE_COLORS) y el total del frame,
+ *     con ms por frame y una marca en 1000/target_fps,
+ *   - una fila por hilo de cada equipo con regiones medidas: verde =
+ *     ocupado, rojo = ocioso, con el % ocupado,
+ *   - llamadas de dibujo del frame (barra en escala log10, llena = 10^6).
+ * Los rectángulos se rearman cada OVL_PERIOD_MS; entre tanto cada frame solo
+ * repite un SDL_RenderFillRects por color.
+ */
+typedef struct
+{
+    SDL_Color c;
+    int first, count;
+} OvlGroup;
+
+typedef struct
+{
+    SDL_Rect rect[OVL_MAX_RECTS];
+    int nrect;
+    OvlGroup grp[OVL_MAX_GROUPS];
+    int ngrp;
+    double stage_ms[STAGE_COUNT]; // Suma de ms por etapa en el período
+    ProfSample prof;              // Ocupado/pared por hilo en el período
+    double draws;                 // Suma de llamadas de dibujo en el período
+    int frames;                   // Frames del período
+    uint64_t last;                // Ticks del último armado
+} Overlay;
+
+static const SDL_Color OVL_STAGE_COLORS[STAGE_COUNT] = {
+    {150, 150, 150, 255}, {80, 160, 255, 255}, {80, 220, 220, 255}, {255, 170, 60, 255},
+    {220, 90, 220, 255},  {240, 240, 90, 255}, {255, 80, 80, 255}};
+
+/** Glifos de 3x5 (filas de arriba abajo, bit alto = columna izquierda): '0'..'9', '.', '%'. */
+static const uint16_t OVL_GLYPHS[12] = {0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF,
+                                        0x79EF, 0x7249, 0x7BEF, 0x7BCF, 0x0002, 0x52A5};
+
+static Overlay *overlay_create(void)
+{
+    Overlay *o = (Overlay *)calloc(1, sizeof(Overlay));
+    if (o)
+        o->last = SDL_GetPerformanceCounter();
+    return o;
+}
 
-                // Halo radial (si glow activo)
-                if (haloA > 0)
-                {
-                    SDL_SetTextureColorMod(radial, rr, gg, bb);
-                    SDL_SetTextureAlphaMod(radial, haloA);
-                    float hr = (float)(pr + 2);
-                    SDL_FRect hrct = {(float)(X - hr), (float)(Y - hr), hr * 2.0f, hr * 2.0f};
-                    SDL_RenderCopyF(ren, radial, NULL, &hrct);
-                }
+static void overlay_free(Overlay *o) { free(o); }
 
-                // Núcleo del punto
-                SDL_SetTextureColorMod(dot, rr, gg, bb);
-                SDL_SetTextureAlphaMod(dot, nucA);
-                SDL_FRect rct = {(float)(X - pr), (float)(Y - pr), (float)(pr * 2 + 1), (float)(pr * 2 + 1)};
-                SDL_RenderCopyF(ren, dot, NULL, &rct);
-            }
-        }
+/** Suma el frame cerrado: ticks por etapa, llamadas de dibujo y lo medido por el perfil. */
+static void overlay_observe(Overlay *o, const uint64_t ticks[STAGE_COUNT], int draws)
+{
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        o->stage_ms[s] += ticks_to_seconds(ticks[s]) * 1000.0;
+    ProfSample p;
+    prof_take(&p);
+    for (int team = 0; team < 2; ++team)
+    {
+        o->prof.span[team] += p.span[team];
+        for (int t = 0; t < p.lanes[team]; ++t)
+            o->prof.busy[team][t] += p.busy[team][t];
+        if (p.lanes[team] > o->prof.lanes[team])
+            o->prof.lanes[team] = p.lanes[team];
     }
+    o->draws += draws;
+    o->frames++;
 }
 
-/**
- * Renderiza un frame completo:
- *  1) Aplica fade con tinte de fondo por paleta.
- *  2) Dibuja partículas con simetrías y espejo.
- *  3) Opcional: dibuja guías/rectángulos de atractores.
- */
-static void render_frame(SDL_Renderer *ren, const Config *cfg, const Precomp *pc, int n, Attractor a[NUM_ATTR], int W, int H, float t, int draw_sym, SDL_Texture **discs, SDL_Texture *radial)
+/** Abre un grupo de rectángulos del color dado (false si no quedan grupos). */
+static bool ovl_color(Overlay *o, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
-    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
-    SDL_Rect full = {0, 0, W, H};
-    RGBA tint = palette_bg_tint(cfg, t);
-    SDL_SetRenderDrawColor(ren, tint.r, tint.g, tint.b, tint.a);
-    SDL_RenderFillRect(ren, &full);
+    if (o->ngrp == OVL_MAX_GROUPS)
+        return false;
+    o->grp[o->ngrp++] = (OvlGroup){{r, g, b, a}, o->nrect, 0};
+    return true;
+}
 
-    draw_particles(ren, cfg, pc, n, draw_sym, cfg->mirror, W * 0.5f, H * 0.5f, discs, radial);
+static void ovl_rect(Overlay *o, int x, int y, int w, int h)
+{
+    if (w <= 0 || h <= 0 || o->nrect == OVL_MAX_RECTS || o->ngrp == 0)
+        return;
+    o->rect[o->nrect++] = (SDL_Rect){x, y, w, h};
+    o->grp[o->ngrp - 1].count++;
+}
 
-    if (cfg->show_attractors)
+/** Escribe s con la fuente de 3x5 (un rectángulo por tramo horizontal de celdas). */
+static void ovl_text(Overlay *o, int x, int y, const char *s)
+{
+    for (; *s; ++s, x += 4 * OVL_CELL)
     {
-        for (int k = 0; k < NUM_ATTR; ++k)
+        int g = *s == '.' ? 10 : (*s == '%' ? 11 : (*s >= '0' && *s <= '9' ? *s - '0' : -1));
+        if (g < 0)
+            continue;
+        for (int row = 0; row < 5; ++row)
         {
-            Uint8 rr, gg, bb;
-            palette_attractor_color(cfg->palette, k, t, &rr, &gg, &bb);
-            SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_ADD);
-            SDL_SetRenderDrawColor(ren, rr, gg, bb, 24);
-            SDL_FRect rct = {(float)a[k].x - 14, (float)a[k].y - 14, 28, 28};
-            SDL_RenderDrawRectF(ren, &rct);
+            unsigned bits = (OVL_GLYPHS[g] >> (3 * (4 - row))) & 7u;
+            for (int col = 0; col < 3; ++col)
+            {
+                if (!(bits & (4u >> col)))
+                    continue;
+                int run = 1;
+                while (col + run < 3 && (bits & (4u >> (col + run))))
+                    run++;
+                ovl_rect(o, x + col * OVL_CELL, y + row * OVL_CELL, run * OVL_CELL, OVL_CELL);
+                col += run - 1;
+            }
         }
     }
 }
 
-// ------------------------ SSAA (Render Target escalado) ------------------------
-
-/**
- * Configura (crea/destruye) el render target para SSAA al cambiar el factor.
- * Ajusta RW,RH según outW/outH y ssaa. Si falla creación, cae a ssaa=1.
- */
-static void set_ssaa(SDL_Renderer *ren, int outW, int outH, int newk,
-                     int *ssaa, SDL_Texture **rt, int *RW, int *RH)
+/** Rearma los rectángulos con la media del período y lo reinicia. */
+static void overlay_build(Overlay *o, int target_fps)
 {
-    if (newk < 1)
-        newk = 1;
-    if (newk > 4)
-        newk = 4;
-    if (*rt && newk == *ssaa)
-        return; // No hace nada si ya coincide
+    const double inv = 1.0 / (double)o->frames;
+    const double px_per_ms = (OVL_BAR * 0.5) / (1000.0 / (double)target_fps);
+    const int x0 = 8, xb = x0 + 10, xt = xb + OVL_BAR + 8;
+    int lanes[2];
+    for (int team = 0; team < 2; ++team)
+    {
+        lanes[team] = o->prof.span[team] > 0 ? o->prof.lanes[team] : 0;
+        if (lanes[team] > OVL_MAX_LANES)
+            lanes[team] = OVL_MAX_LANES;
+    }
 
-    if (*rt) // Destruye RT previo si existía
+    // Filas: etapas, frame, [hueco, hilos del equipo 0], [hueco, hilos del equipo 1], hueco, llamadas
+    int y_stage = 8, y_lanes[2], y = y_stage + (STAGE_COUNT + 1) * OVL_ROW;
+    for (int team = 0; team < 2; ++team)
     {
-        SDL_DestroyTexture(*rt);
-        *rt = NULL;
+        if (lanes[team])
+            y += OVL_ROW / 2;
+        y_lanes[team] = y;
+        y += lanes[team] * OVL_ROW;
     }
-    *ssaa = newk;
-    *RW = outW * (*ssaa);
-    *RH = outH * (*ssaa);
-    if (*ssaa > 1)
+    const int y_draws = y + OVL_ROW / 2, y_end = y_draws + OVL_ROW;
+
+    double ms[STAGE_COUNT + 1];
+    ms[STAGE_COUNT] = 0.0;
+    for (int s = 0; s < STAGE_COUNT; ++s)
     {
-        *rt = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, *RW, *RH);
-        if (!*rt)
+        ms[s] = o->stage_ms[s] * inv;
+        ms[STAGE_COUNT] += ms[s];
+    }
+    const double draws = o->draws * inv;
+
+    o->nrect = o->ngrp = 0;
+    ovl_color(o, 0, 0, 0, 160);
+    ovl_rect(o, x0 - 4, y_stage - 4, xt + 7 * 4 * OVL_CELL - x0 + 8, y_end - y_stage + 4);
+    for (int s = 0; s <= STAGE_COUNT; ++s)
+    {
+        SDL_Color c = s < STAGE_COUNT ? OVL_STAGE_COLORS[s] : (SDL_Color){230, 230, 230, 255};
+        int len = (int)(ms[s] * px_per_ms + 0.5);
+        ovl_color(o, c.r, c.g, c.b, 220);
+        ovl_rect(o, x0, y_stage + s * OVL_ROW + 1, 6, OVL_ROW - 4);
+        ovl_rect(o, xb, y_stage + s * OVL_ROW + 2, len < OVL_BAR ? len : OVL_BAR, OVL_ROW - 6);
+    }
+    ovl_color(o, 255, 255, 255, 140); // Presupuesto del frame
+    ovl_rect(o, xb + OVL_BAR / 2, y_stage, 1, (STAGE_COUNT + 1) * OVL_ROW);
+
+    static const SDL_Color team_colors[2] = {{80, 160, 255, 220}, {255, 170, 60, 220}};
+    int busy_px[2][OVL_MAX_LANES];
+    for (int team = 0; team < 2; ++team)
+    {
+        ovl_color(o, team_colors[team].r, team_colors[team].g, team_colors[team].b, team_colors[team].a);
+        for (int t = 0; t < lanes[team]; ++t)
         {
-            fprintf(stderr, "No se pudo crear RT SSAA=%d (%dx%d). Sin SSAA.\n", *ssaa, *RW, *RH);
-            *ssaa = 1;
-            *RW = outW;
-            *RH = outH;
+            double f = (double)o->prof.busy[team][t] / (double)o->prof.span[team];
+            busy_px[team][t] = (int)((f > 1.0 ? 1.0 : f) * OVL_BAR + 0.5);
+            ovl_rect(o, x0, y_lanes[team] + t * OVL_ROW + 1, 6, OVL_ROW - 4);
+        }
+    }
+    ovl_color(o, 90, 220, 110, 220); // Ocupado
+    for (int team = 0; team < 2; ++team)
+        for (int t = 0; t < lanes[team]; ++t)
+            ovl_rect(o, xb, y_lanes[team] + t * OVL_ROW + 2, busy_px[team][t], OVL_ROW - 6);
+    ovl_color(o, 150, 40, 40, 200); // Ocioso
+    for (int team = 0; team < 2; ++team)
+        for (int t = 0; t < lanes[team]; ++t)
+            ovl_rect(o, xb + busy_px[team][t], y_lanes[team] + t * OVL_ROW + 2, OVL_BAR - busy_px[team][t], OVL_ROW - 6);
+    ovl_color(o, 255, 255, 255, 200); // Llamadas de dibujo
+    ovl_rect(o, x0, y_draws + 1, 6, OVL_ROW - 4);
+    ovl_rect(o, xb, y_draws + 2, (int)(OVL_BAR * fmin(1.0, log10(1.0 + draws) / 6.0)), OVL_ROW - 6);
+
+    // Cifras: ms por etapa, % ocupado por hilo y llamadas de dibujo
+    char num[16];
+    ovl_color(o, 255, 255, 255, 230);
+    for (int s = 0; s <= STAGE_COUNT; ++s)
+    {
+        snprintf(num, sizeof(num), "%.2f", ms[s]);
+        ovl_text(o, xt, y_stage + s * OVL_ROW + 1, num);
+    }
+    for (int team = 0; team < 2; ++team)
+        for (int t = 0; t < lanes[team]; ++t)
+        {
+            snprintf(num, sizeof(num), "%d%%", busy_px[team][t] * 100 / OVL_BAR);
+            ovl_text(o, xt, y_lanes[team] + t * OVL_ROW + 1, num);
         }
+    snprintf(num, sizeof(num), "%.0f", draws);
+    ovl_text(o, xt, y_draws + 1, num);
+
+    memset(o->stage_ms, 0, sizeof(o->stage_ms));
+    memset(&o->prof, 0, sizeof(o->prof));
+    o->draws = 0.0;
+    o->frames = 0;
+}
+
+/** Dibuja el overlay sobre el destino actual (la ventana); rearma sus barras cada OVL_PERIOD_MS. */
+static void overlay_draw(SDL_Renderer *ren, Overlay *o, int target_fps)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (o->frames > 0 && ticks_to_ms_u64(now - o->last) >= OVL_PERIOD_MS)
+    {
+        overlay_build(o, target_fps);
+        o->last = now;
+    }
+    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+    for (int k = 0; k < o->ngrp; ++k)
+    {
+        const OvlGroup *g = &o->grp[k];
+        if (g->count == 0)
+            continue;
+        SDL_SetRenderDrawColor(ren, g->c.r, g->c.g, g->c.b, g->c.a);
+        SDL_RenderFillRects(ren, o->rect + g->first, g->count);
     }
 }
 
 // ------------------------ Programa principal ------------------------
 
+#define HEADLESS_DT (1.0 / 60.0) // Paso fijo de headless y --deterministic (s)
+#define TITLE_PERIOD_MS 500      // Período del título con estado en vivo (formatearlo y fijarlo cuesta)
+
 /**
  * main() realiza:
  *  - Inicialización de SDL (ventana, renderer, hints).
  *  - Creación de recursos (render target SSAA, sprites).
- *  - Construcción del mundo (3 atractores + N orbitadores).
- *  - Bucle principal: eventos, dt/FPS, update en paralelo, precálculo, render.
- *  - Calidad adaptativa (si cfg.adapt): reduce SSAA, fracción de render, glow
- *    o simetrías cuando FPS cae por debajo del objetivo; los eleva si sobra margen.
- *  - Logging periódico de métricas a CSV.
+ *  - Construcción del mundo (--attractors atractores + N orbitadores).
+ *  - Bucle principal: eventos, dt/FPS, update en paralelo, precálculo, render
+ *    (con --pipeline 1 update+precálculo van en un hilo productor, un frame adelante;
+ *    con --backend cpu el frame se rasteriza por tiles en CPU y se sube como textura).
+ *  - Calidad adaptativa: con --adapt 1 el controlador AdaptCtl mide el costo
+ *    por sprite y por píxel en cada frame y salta a las perillas (SSAA,
+ *    fracción de render, glow, simetrías) que predice dentro de target_fps;
+ *    con --adapt 2 la escalera por pasos reduce SSAA, fracción de render (con
+ *    --lod 1, el presupuesto de sprites en proporción al FPS), glow o
+ *    simetrías cuando FPS cae por debajo del objetivo; los eleva si sobra margen.
+ *  - Logging periódico de métricas a CSV; título de ventana cada TITLE_PERIOD_MS.
+ *  - Con --overlay 1 / --trace: perfil por etapa y por hilo (Prof), dibujado
+ *    sobre la ventana (F1 lo oculta) o escrito como traza de Chrome al salir.
+ *  - Con --record: lectura diferida de cada frame (texturas staging) hacia
+ *    un hilo codificador (Recorder); el render no toca el disco.
+ *  - Instantáneas: --load-state mapea el mundo guardado con --save-state;
+ *    --replay dibuja las listas de --save-frames sin simular.
+ *  - En modo headless: renderer por software sobre superficie offscreen,
+ *    cfg.frames pasos de HEADLESS_DT sin eventos ni present, y resumen de
+ *    tiempos por etapa al terminar.
+ *  - Con --deterministic 1: cfg.frames pasos de HEADLESS_DT también con
+ *    ventana y checksum del estado final (comparable con el secuencial).
  *  - Liberación ordenada de recursos.
  */
 int main(int argc, char **argv)
 {
+    MpiWorld *mpi = mpi_start(&argc, &argv); // NULL sin -DUSE_MPI o con un solo rank
     Config cfg = parse_args(argc, argv);
-    srand((unsigned)cfg.seed);
+    mpi_configure(mpi, &cfg);
+    if (cfg.self_test)
+        return fastmath_self_test() | color_lut_self_test(&cfg);
+
+    // Instantánea o repetición: el archivo fija N, atractores y semilla del mundo
+    SnapMap snap;
+    memset(&snap, 0, sizeof(snap));
+    if (cfg.load_state[0] != '\0' || cfg.replay_path[0] != '\0')
+    {
+        bool rp = cfg.replay_path[0] != '\0';
+        if (!snap_open(&snap, rp ? cfg.replay_path : cfg.load_state, rp ? SNAP_FRAMES : SNAP_STATE))
+            return 1;
+        cfg.n = snap.h->n;
+        cfg.attractors = snap.h->attractors;
+        cfg.attr_k = snap.h->attr_k;
+        cfg.seed = snap.h->seed;
+        if (rp)
+        {
+            // Solo el camino de dibujo: sin productor, adaptación ni interacción
+            cfg.lod = snap.h->lod;
+            cfg.pipeline = 0;
+            cfg.adapt = 0;
+            cfg.interact = 0.0f;
+        }
+    }
+    const bool replaying = cfg.replay_path[0] != '\0';
 
-    // SDL: video + timer
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0)
+    // SDL: video + timer (headless no necesita subsistema de video)
+    if (SDL_Init(cfg.headless ? SDL_INIT_TIMER : (SDL_INIT_VIDEO | SDL_INIT_TIMER)) != 0)
     {
         fprintf(stderr, "Error SDL_Init: %s\n", SDL_GetError());
         return 1;
     }
 
-    // Hints: intenta usar “metal” y batching en plataformas compatibles
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "metal");
+    // Hints: intenta usar “metal” (u “opengl” con --backend gl) y batching en plataformas compatibles
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, cfg.backend == BACKEND_GL ? "opengl" : "metal");
     SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
 
-    // Ventana
-    SDL_Window *win = SDL_CreateWindow(
-        "Screensaver (paralelo) - Inicializando…",
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        cfg.width, cfg.height,
-        SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
-    if (!win)
+    SDL_Window *win = NULL;
+    SDL_Surface *offscreen = NULL; // Destino del renderer software en headless
+    SDL_Renderer *ren = NULL;
+    if (cfg.headless)
     {
-        fprintf(stderr, "Error SDL_CreateWindow: %s\n", SDL_GetError());
-        SDL_Quit();
-        return 1;
+        // Superficie en memoria + renderer software: sin compositor ni vsync
+        offscreen = SDL_CreateRGBSurfaceWithFormat(0, cfg.width, cfg.height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!offscreen)
+        {
+            fprintf(stderr, "Error SDL_CreateRGBSurfaceWithFormat: %s\n", SDL_GetError());
+            SDL_Quit();
+            return 1;
+        }
+        ren = SDL_CreateSoftwareRenderer(offscreen);
+        if (!ren)
+        {
+            fprintf(stderr, "Error SDL_CreateSoftwareRenderer: %s\n", SDL_GetError());
+            SDL_FreeSurface(offscreen);
+            SDL_Quit();
+            return 1;
+        }
     }
-
-    // Renderer acelerado; VSYNC según config
-    int rflags = SDL_RENDERER_ACCELERATED | (cfg.vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
-    SDL_Renderer *ren = SDL_CreateRenderer(win, -1, rflags);
-    if (!ren)
+    else
     {
-        fprintf(stderr, "Error SDL_CreateRenderer: %s\n", SDL_GetError());
-        SDL_DestroyWindow(win);
-        SDL_Quit();
-        return 1;
+        // Ventana
+        win = SDL_CreateWindow(
+            "Screensaver (paralelo) - Inicializando…",
+            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            cfg.width, cfg.height,
+            SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+        if (!win)
+        {
+            fprintf(stderr, "Error SDL_CreateWindow: %s\n", SDL_GetError());
+            SDL_Quit();
+            return 1;
+        }
+
+        // Renderer acelerado; VSYNC según config
+        int rflags = SDL_RENDERER_ACCELERATED | (cfg.vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+        ren = SDL_CreateRenderer(win, -1, rflags);
+        if (!ren)
+        {
+            fprintf(stderr, "Error SDL_CreateRenderer: %s\n", SDL_GetError());
+            SDL_DestroyWindow(win);
+            SDL_Quit();
+            return 1;
+        }
     }
 
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "2"); // Mejor filtrado de escalado
     int outW = cfg.width, outH = cfg.height;
     SDL_GetRendererOutputSize(ren, &outW, &outH); // Tamaño real del backbuffer (HiDPI)
+    mpi_share_view(mpi, &outW, &outH);
+    const int worldW = outW * cfg.outputs;                               // --outputs (o ranks MPI): vistas contiguas de outW px
+    const float view_x0 = mpi ? (float)(mpi->rank * outW) : 0.0f;       // Columna del mundo que muestra este proceso
 
-    // Render target para SSAA
+    // Render target para SSAA (con --backend cpu el supersampling vive en CpuRaster)
     SDL_Texture *rt = NULL;
     int RW = outW, RH = outH;
-    set_ssaa(ren, outW, outH, cfg.ssaa, &cfg.ssaa, &rt, &RW, &RH);
+    CpuRaster *cpu = NULL;
+    if (cfg.backend == BACKEND_CPU)
+    {
+        cpu = cpu_raster_create(ren, outW, outH);
+        if (!cpu || !cpu_raster_set_ssaa(cpu, cfg.ssaa, &cfg.ssaa, &RW, &RH))
+        {
+            fprintf(stderr, "No se pudo crear el rasterizador CPU; se usa el renderer de SDL\n");
+            cpu_raster_free(cpu);
+            cpu = NULL;
+            cfg.backend = BACKEND_SDL;
+        }
+    }
+    // --trail 2 acumula en el destino: rt también con factor 1 (el backbuffer no persiste tras present)
+    const bool accum = cfg.trail == TRAIL_ACCUM;
+    if (!cpu)
+        set_ssaa(ren, outW, outH, cfg.ssaa, accum, &cfg.ssaa, &rt, &RW, &RH);
 
     // Sprites de discos (radios 1..5) y halo radial 32x32
     SDL_Texture *discs[6] = {0};
@@ -1067,36 +6943,186 @@ int main(int argc, char **argv)
         discs[r] = make_disc_texture(ren, r);
     SDL_Texture *radial = make_radial_texture(ren, 32);
 
-    // Mundo: atractores + partículas
-    Attractor att[NUM_ATTR];
-    init_attractors(att, outW, outH);
+    int eff_threads = 1;
+#ifdef _OPENMP
+    eff_threads = (cfg.threads > 0 ? cfg.threads : omp_get_max_threads()); // Hilos efectivos
+#endif
+    // Una sola vez: las regiones por frame (y la primera escritura) heredan hilos, reparto y afinidad
+    int bound = team_setup(&cfg, eff_threads, 0);
+    if (cfg.bind != BIND_NONE && bound == 0 && eff_threads > 1)
+        fprintf(stderr, "--bind %s sin efecto (sin OpenMP/Linux o OMP_PROC_BIND definido)\n", BIND_NAMES[cfg.bind]);
 
-    Orbiter *orbs = (Orbiter *)malloc(sizeof(Orbiter) * (size_t)cfg.n);
-    if (!orbs)
+    // Mundo: atractores + partículas (Orbiters y Precomp en una sola arena)
+    Attractors att;
+    if (!attractors_alloc(&att, cfg.attractors, cfg.attr_k))
     {
-        fprintf(stderr, "Sin memoria para %d orbitadores\n", cfg.n);
+        fprintf(stderr, "Sin memoria para %d atractores\n", cfg.attractors);
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
+        SDL_FreeSurface(offscreen);
         SDL_Quit();
         return 1;
     }
-    init_orbiters(orbs, cfg.n, att, outW, outH);
+    init_attractors(&att, worldW, outH, cfg.seed);
 
-    Precomp *pc = (Precomp *)malloc(sizeof(Precomp) * (size_t)cfg.n);
-    if (!pc)
+    ParticleArena arena;
+    Orbiters orbs;
+    Precomp *pc = NULL;
+    size_t arena_bytes = orbiters_bytes(cfg.n) + arena_chunk(sizeof(Precomp) * (size_t)cfg.n);
+    if (snap.map && !replaying)
+        arena_bytes += SNAP_ALIGN; // Holgura: snap_restore mapea páginas enteras sobre la arena
+    if (!arena_create(&arena, arena_bytes, cfg.hugepages != 0) || !orbiters_alloc(&orbs, cfg.n, &arena) ||
+        !(pc = (Precomp *)arena_push(&arena, sizeof(Precomp) * (size_t)cfg.n)))
     {
-        fprintf(stderr, "Sin memoria para pre-cálculo\n");
-        free(orbs);
+        fprintf(stderr, "Sin memoria para %d orbitadores\n", cfg.n);
+        arena_destroy(&arena);
+        attractors_free(&att);
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
+        SDL_FreeSurface(offscreen);
         SDL_Quit();
         return 1;
     }
+    // Primera escritura en paralelo, con el mismo reparto que el bucle por frame
+    // (al reanudar, las páginas de Orbiters vienen del archivo al tocarlas)
+    if (snap.map && !replaying)
+    {
+        if (snap.h->width != worldW || snap.h->height != outH)
+            fprintf(stderr, "Instantánea de un mundo %dx%d; se reanuda en %dx%d\n", snap.h->width, snap.h->height, worldW, outH);
+        snap_restore(&snap, &att, &arena);
+    }
+    else if (!replaying)
+    {
+        init_orbiters(mpi_executor(mpi, &cfg), &orbs, &att, worldW, outH, cfg.seed);
+    }
+    precomp_first_touch(mpi_executor(mpi, &cfg), pc, cfg.n); // Con MPI, solo el tramo propio (el resto llega por Allgatherv)
+    if (cfg.headless)
+        printf("Arena: %.1f MB (%s%s), Precomp %u B/partícula\n", (double)arena.size / (1024.0 * 1024.0),
+               arena.mapped ? "mmap" : "heap", arena.huge ? ", hugepages" : "", (unsigned)sizeof(Precomp));
+    if (mpi && cfg.headless)
+        printf("MPI: %d ranks (mundo %dx%d, una tesela de %dx%d por rank)\n", mpi->size, worldW, outH, outW, outH);
+
+    // Tabla de color de la paleta activa (sin memoria => HSV por partícula)
+    ColorLUT *lut = NULL;
+    if (cfg.color_lut)
+    {
+        lut = color_lut_create(&cfg);
+        if (!lut)
+        {
+            fprintf(stderr, "Sin memoria para ColorLUT; se usa HSV por partícula\n");
+            cfg.color_lut = 0;
+        }
+    }
+
+    // Instancias GL sobre el contexto del renderer (sin "opengl" 3.3+ => renderer de SDL)
+    GlSprites *gl = NULL;
+    if (cfg.backend == BACKEND_GL)
+    {
+        gl = gl_sprites_create(ren);
+        if (!gl)
+        {
+            fprintf(stderr, "No se pudo iniciar --backend gl; se usa el renderer de SDL\n");
+            cfg.backend = BACKEND_SDL;
+        }
+        else
+        {
+            cfg.batch = 0; // Simetrías y capas salen del vertex shader
+        }
+    }
+
+    // Lotes de geometría (sin memoria o sin atlas => sprite a sprite)
+    SpriteBatch *batch = NULL;
+    if (cfg.batch)
+    {
+        batch = batch_create(ren);
+        if (!batch)
+        {
+            fprintf(stderr, "No se pudo crear SpriteBatch; se usa RenderCopyF por sprite\n");
+            cfg.batch = 0;
+        }
+    }
+
+    // Rejilla de interacción entre partículas (sin memoria => solo atractores)
+    ParticleGrid *grid = NULL;
+    if (cfg.interact > 0.0f)
+    {
+        grid = grid_create(worldW, outH, cfg.interact_radius, cfg.n);
+        if (!grid)
+        {
+            fprintf(stderr, "Sin memoria para ParticleGrid; se desactiva --interact\n");
+            cfg.interact = 0.0f;
+        }
+    }
+
+    // Nivel de detalle: presupuesto por defecto = render_frac del costo a detalle completo
+    LodState *lod = NULL;
+    LodCounts lodc = {0, 0, 0};
+    float lod_budget_max = 0.0f; // Tope del presupuesto para la calidad adaptativa
+    if (cfg.lod && !replaying) // En --replay la lista ya viene compactada
+    {
+        lod = lod_create(executor_get(cfg.exec), worldW, outH, cfg.n, cfg.seed);
+        if (!lod)
+        {
+            fprintf(stderr, "Sin memoria para LodState; se usa --render-frac por salto\n");
+            cfg.lod = 0;
+        }
+        else if (cfg.lod_budget <= 0.0f)
+        {
+            cfg.lod_budget = cfg.render_frac * (float)cfg.n * (float)(cfg.sym * (cfg.mirror ? 2 : 1)) *
+                             (float)lod_quads_full(cfg.trail, cfg.glow);
+        }
+        lod_budget_max = cfg.lod_budget;
+    }
+
+    // Cómputo en GPU: Orbiters se sube una vez y queda residente (si no aplica => CPU)
+    GpuSim *gpu = NULL;
+    if (cfg.gpu)
+    {
+        const char *why = gpu_unsupported(&cfg, replaying);
+        if (why)
+            fprintf(stderr, "--gpu 1: %s; se usa la CPU\n", why);
+        else
+            gpu = gpu_create(&cfg, &orbs, &att, lut, batch);
+        if (!gpu)
+            cfg.gpu = 0;
+        else if (cfg.headless)
+            printf("GPU: %s\n", gpu_device_name(gpu));
+    }
+
+    // Vistas extra: ventana en este hilo, renderer y dibujo en el suyo (sin ninguna => solo la salida 0)
+    OutputSet *outs = NULL;
+    if (cfg.outputs > 1 && !mpi) // Con MPI cada rank es una vista
+    {
+        outs = outputs_create(&cfg, outW, outH, eff_threads);
+        if (!outs)
+            fprintf(stderr, "--outputs %d: no se abrió ninguna vista extra\n", cfg.outputs);
+        else if (cfg.headless)
+            printf("Vistas: %d de %dx%d (mundo %dx%d), %d hilos por vista extra\n", outs->count + 1, outW, outH, worldW, outH,
+                   outs->threads);
+    }
+
+    // Perfil de la ruta caliente: overlay en la ventana y/o traza de Chrome
+    Overlay *ovl = NULL;
+    bool ovl_visible = true; // F1 alterna
+    if (cfg.overlay || cfg.trace_path[0] != '\0')
+    {
+        if (!prof_init(cfg.trace_path[0] != '\0'))
+        {
+            fprintf(stderr, "Sin memoria para el perfil; se desactivan --overlay y --trace\n");
+            cfg.overlay = 0;
+            cfg.trace_path[0] = '\0';
+        }
+        else if (cfg.overlay && !cfg.headless && !(ovl = overlay_create()))
+        {
+            fprintf(stderr, "Sin memoria para el overlay; se desactiva --overlay\n");
+        }
+    }
 
     // Tiempo / FPS / Logging
     bool running = true;
     uint64_t t0 = SDL_GetPerformanceCounter();
-    double t_sec = 0.0;
+    double t_sec = snap.map && !replaying ? snap.h->t : 0.0;
+    const int frames_base = snap.map && !replaying ? snap.h->frames : 0; // Frames previos a la instantánea
 
     FPSCounter fpsc;
     fpsc.last_ticks = SDL_GetPerformanceCounter();
@@ -1104,13 +7130,34 @@ int main(int argc, char **argv)
     fpsc.alpha = 0.1;
 
     FILE *logfp = NULL;
+    BinLog *blog = NULL; // --log-format bin: un registro por frame, escrito en otro hilo
     uint64_t start_ticks = SDL_GetPerformanceCounter(), last_log_ms = 0;
-    if (cfg.log_path[0] != '\0')
+    if (cfg.log_path[0] != '\0' && cfg.log_format == LOG_BIN)
+    {
+        // Parámetros fijos de la corrida (mismos nombres que las columnas del CSV)
+        char meta[640];
+        snprintf(meta, sizeof(meta),
+                 "n=%d\nwidth=%d\nheight=%d\npalette=%s\nvsync=%d\nthreads=%d\nheadless=%d\nfused=%d\nfast_math=%d\n"
+                 "color_lut=%d\nbatch=%d\npipeline=%d\nbackend=%s\ndeterministic=%d\nhugepages=%d\nschedule=%s\nchunk=%d\n"
+                 "bind=%s\ninteract=%.1f\ninteract_radius=%.1f\nattractors=%d\nattr_k=%d\nlod=%d\nadapt=%d\ntarget_fps=%d\n"
+                 "replay=%d\nexec=%s\ngpu=%d\noutputs=%d\nseed=%u\n",
+                 cfg.n, cfg.width, cfg.height, cfg.palette, cfg.vsync, eff_threads, cfg.headless, cfg.fused, cfg.fast_math,
+                 cfg.color_lut, cfg.batch, cfg.pipeline, BACKEND_NAMES[cfg.backend], cfg.deterministic,
+                 arena.huge, SCHED_NAMES[cfg.schedule], cfg.chunk, BIND_NAMES[cfg.bind], cfg.interact, cfg.interact_radius,
+                 att.n, att.k, cfg.lod, cfg.adapt, cfg.target_fps, replaying ? 1 : 0,
+                 executor_get(cfg.exec)->name, cfg.gpu, cfg.outputs, (unsigned)cfg.seed);
+        blog = blog_open(cfg.log_path, meta);
+        if (!blog)
+            fprintf(stderr, "No se pudo abrir log '%s'\n", cfg.log_path);
+    }
+    else if (cfg.log_path[0] != '\0')
     {
         logfp = fopen(cfg.log_path, "w");
         if (logfp)
         {
-            fprintf(logfp, "time_s,smoothed_fps,fps_inst,n,width,height,palette,vsync,threads,ssaa,render_frac,sym\n");
+            fprintf(logfp, "time_s,smoothed_fps,fps_inst,n,width,height,palette,vsync,threads,ssaa,render_frac,sym,headless,fused,fast_math,color_lut,batch,pipeline,backend,deterministic,hugepages,schedule,chunk,bind,interact,interact_radius,attractors,attr_k,lod,lod_budget,adapt,glow,adapt_pred_ms,adapt_ms_per_msprite,adapt_ms_per_mpixel,adapt_changes,replay,exec,gpu,outputs,draw_calls,work_blocks,work_imbalance,steals");
+            stage_csv_header(logfp);
+            fputc('\n', logfp);
             fflush(logfp);
         }
         else
@@ -1119,51 +7166,137 @@ int main(int argc, char **argv)
         }
     }
 
-    int eff_threads = 1;
-    (void)eff_threads;
-#ifdef _OPENMP
-    eff_threads = (cfg.threads > 0 ? cfg.threads : omp_get_max_threads()); // Hilos efectivos
-#endif
-
     int draw_sym = cfg.sym;    // Simetrías efectivas (pueden bajar en adaptación)
     float last_adapt_t = 0.0f; // Histeresis temporal para no “parpadear” ajustes
+    AdaptCtl actl;             // --adapt 1: modelo de costo y decisiones
+    adapt_init(&actl);
+    const AdaptKnobs adapt_top = {cfg.sym, cfg.glow, cfg.ssaa, 1.0f}; // Calidad máxima admitida
+
+    StageTimes stimes;
+    memset(&stimes, 0, sizeof(stimes));
+    stimes.span = prof.ev ? prof_span : NULL; // --trace: un tramo por etapa
+    int frames_done = 0;
+    uint64_t draws_total = 0;    // Llamadas de dibujo de la salida 0 (reporte headless)
+    uint64_t title_ticks = 0;    // Última actualización del título
+    ExecStats work_win, work_total = {0}; // Trabajo por hilo: ventana del log y corrida completa
+
+    // Stream de frames para --replay (se escribe en este hilo, tras producir cada frame)
+    SnapWriter *snap_out = NULL;
+    if (cfg.save_frames[0] != '\0' && !(snap_out = snap_frames_open(cfg.save_frames, &cfg, worldW, outH)))
+        fprintf(stderr, "--save-frames: no se pudo abrir '%s'\n", cfg.save_frames);
+
+    // Grabación: con el renderer de SDL siempre se dibuja en rt (también con factor 1)
+    Recorder *rec = NULL;
+    if (cfg.record_path[0] != '\0')
+    {
+        rec = record_create(cpu ? NULL : ren, cfg.record_path, outW, outH, cfg.headless || cfg.deterministic);
+        if (rec && !cpu)
+        {
+            set_ssaa(ren, outW, outH, cfg.ssaa, true, &cfg.ssaa, &rt, &RW, &RH);
+            if (!rt)
+            {
+                fprintf(stderr, "--record: no se pudo crear el render target; no se graba\n");
+                record_finish(ren, rec);
+                rec = NULL;
+            }
+        }
+    }
+
+    // Pipeline: el productor simula el frame N+1 mientras este hilo dibuja el N
+    Pipeline *pipe = NULL;
+    int pipe_k = 0; // Próximo slot a consumir (mismo orden alterno que el productor)
+    if (cfg.pipeline)
+    {
+        pipe = pipeline_start(&cfg, lut, &orbs, grid, &att, lod, pc, batch, worldW, outH, eff_threads,
+                              HEADLESS_DT, t_sec, draw_sym, (cfg.headless || cfg.deterministic) ? cfg.frames : 0);
+        if (!pipe)
+        {
+            fprintf(stderr, "No se pudo iniciar el pipeline; se simula en el hilo principal\n");
+            cfg.pipeline = 0;
+        }
+    }
+    uint64_t wall0 = SDL_GetPerformanceCounter();
 
     // Bucle principal
     while (running)
     {
-        // Corte por tiempo si --seconds > 0
-        if (cfg.seconds > 0)
+        uint64_t mark = SDL_GetPerformanceCounter();
+        if (cfg.headless || cfg.deterministic)
         {
-            uint64_t now = SDL_GetPerformanceCounter();
-            double elapsed = ticks_to_seconds(now - t0);
-            if (elapsed >= (double)cfg.seconds)
-                running = false;
+            // Headless / determinista: corte por número de frames
+            if (frames_done >= cfg.frames)
+                break;
         }
-
-        // Eventos: cerrar ventana / ESC
-        SDL_Event e;
-        while (SDL_PollEvent(&e))
+        if (!cfg.headless)
         {
-            if (e.type == SDL_QUIT)
-                running = false;
-            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
-                running = false;
+            // Corte por tiempo si --seconds > 0 (el modo determinista corta por frames)
+            if (cfg.seconds > 0 && !cfg.deterministic)
+            {
+                uint64_t now = SDL_GetPerformanceCounter();
+                double elapsed = ticks_to_seconds(now - t0);
+                if (elapsed >= (double)cfg.seconds)
+                    running = false;
+            }
+
+            // Eventos: cerrar ventana / ESC
+            SDL_Event e;
+            while (SDL_PollEvent(&e))
+            {
+                if (e.type == SDL_QUIT)
+                    running = false;
+                if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE)
+                    running = false; // Con varias ventanas SDL_QUIT solo llega al cerrar la última
+                if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
+                    running = false;
+                if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F1 && !e.key.repeat)
+                    ovl_visible = !ovl_visible;
+            }
         }
+        stage_lap(&stimes, STAGE_EVENTS, &mark);
 
         // Avance temporal y medición de FPS
         double fps_inst = 0.0;
         double dt = fps_tick(&fpsc, &fps_inst);
-        if (dt > 0.05)
+        if (cfg.headless || cfg.deterministic)
+            dt = HEADLESS_DT; // Paso fijo: misma carga de trabajo en cada corrida
+        else if (dt > 0.05)
             dt = 0.05; // Cap para estabilidad si hubo pausa larga
         t_sec += dt;
+        if (mpi)
+        {
+            // Mismo paso en todos los ranks (reloj del rank 0); cierre en cualquiera corta todos
+            mpi_sync_frame(mpi, &running, &dt, &t_sec);
+            stage_lap(&stimes, STAGE_WAIT, &mark);
+        }
 
-        // Actualización del mundo
-        update_attractors(att, (float)t_sec, outW, outH);
-        update_orbiters_parallel(orbs, cfg.n, att, (float)dt, cfg.threads);
-        precalc_particles(&cfg, orbs, cfg.n, (float)t_sec, outW * 0.5f, outH * 0.5f, pc, cfg.threads);
-
-        // Calidad adaptativa para intentar mantener >= target_fps
-        if (cfg.adapt)
+        // Calidad adaptativa para intentar mantener >= target_fps (antes del
+        // pre-cálculo: fija simetrías, render_frac y glow con los que se emite)
+        if (cfg.adapt == 1)
+        {
+            // Controlador: salta a las perillas que el modelo predice dentro del objetivo
+            if (actl.samples > 0 && (float)t_sec - last_adapt_t > ADAPT_PERIOD_S)
+            {
+                last_adapt_t = (float)t_sec;
+                AdaptKnobs cur = adapt_current(&cfg, draw_sym, lod_budget_max), next;
+                if (adapt_decide(&actl, &cfg, &cur, &adapt_top, lod_budget_max, outW, outH, &next))
+                {
+                    if (next.ssaa != cfg.ssaa)
+                    {
+                        if (cpu)
+                            cpu_raster_set_ssaa(cpu, next.ssaa, &cfg.ssaa, &RW, &RH);
+                        else
+                            set_ssaa(ren, outW, outH, next.ssaa, rec != NULL || accum, &cfg.ssaa, &rt, &RW, &RH);
+                    }
+                    draw_sym = next.sym;
+                    cfg.glow = next.glow;
+                    if (cfg.lod)
+                        cfg.lod_budget = next.frac * lod_budget_max;
+                    else
+                        cfg.render_frac = next.frac;
+                }
+            }
+        }
+        else if (cfg.adapt == 2)
         {
             if ((float)t_sec - last_adapt_t > 0.7f) // Evita ajustar cada frame
             {
@@ -1172,12 +7305,21 @@ int main(int argc, char **argv)
                 {
                     if (fpsc.smoothed_fps < cfg.target_fps - 1)
                     {
-                        // Baja calidad por pasos: SSAA -> render_frac -> glow -> simetrías
+                        // Baja calidad por pasos: SSAA -> render_frac (o presupuesto de --lod) -> glow -> simetrías
                         if (cfg.ssaa > 1)
                         {
-                            set_ssaa(ren, outW, outH, cfg.ssaa - 1, &cfg.ssaa, &rt, &RW, &RH);
+                            if (cpu)
+                                cpu_raster_set_ssaa(cpu, cfg.ssaa - 1, &cfg.ssaa, &RW, &RH);
+                            else
+                                set_ssaa(ren, outW, outH, cfg.ssaa - 1, rec != NULL || accum, &cfg.ssaa, &rt, &RW, &RH);
+                        }
+                        else if (cfg.lod && cfg.lod_budget > 0.1f * lod_budget_max)
+                        {
+                            // Continuo: escala el presupuesto según el déficit de FPS
+                            float r = (float)fpsc.smoothed_fps / (float)cfg.target_fps;
+                            cfg.lod_budget = fmaxf(0.1f * lod_budget_max, cfg.lod_budget * fmaxf(0.7f, r));
                         }
-                        else if (cfg.render_frac > 0.6f)
+                        else if (!cfg.lod && cfg.render_frac > 0.6f)
                         {
                             cfg.render_frac -= 0.1f;
                         }
@@ -1192,12 +7334,17 @@ int main(int argc, char **argv)
                     }
                     else if (fpsc.smoothed_fps > cfg.target_fps + 8)
                     {
-                        // Sube calidad: simetrías y luego render_frac
+                        // Sube calidad: simetrías y luego render_frac (o presupuesto de --lod)
                         if (draw_sym < cfg.sym)
                         {
                             draw_sym++;
                         }
-                        else if (cfg.render_frac < 1.0f)
+                        else if (cfg.lod && cfg.lod_budget < lod_budget_max)
+                        {
+                            float r = (float)fpsc.smoothed_fps / (float)cfg.target_fps;
+                            cfg.lod_budget = fminf(lod_budget_max, cfg.lod_budget * fminf(1.25f, r));
+                        }
+                        else if (!cfg.lod && cfg.render_frac < 1.0f)
                         {
                             cfg.render_frac = fminf(1.0f, cfg.render_frac + 0.1f);
                         }
@@ -1206,22 +7353,162 @@ int main(int argc, char **argv)
             }
         }
 
-        // Render con o sin SSAA (RT escalado)
-        if (cfg.ssaa > 1 && rt)
+        // Actualización del mundo: aquí mismo o, con pipeline, el frame que dejó listo el productor
+        const Precomp *fpc = pc;
+        const LodCounts *flc = lod ? &lodc : NULL;
+        SpriteBatch *fbatch = batch;
+        const float *fatx = att.x, *faty = att.y;
+        float ft = (float)t_sec;
+        int fsym = draw_sym;
+        FrameSlot *slot = NULL;
+        if (pipe)
+        {
+            mark = SDL_GetPerformanceCounter();
+            SDL_SemWait(pipe->full_sem);
+            stage_lap(&stimes, STAGE_WAIT, &mark);
+            slot = &pipe->slot[pipe_k];
+            for (int s = 0; s < STAGE_COUNT; ++s)
+                stimes.frame[s] += slot->ticks[s];
+            fpc = slot->pc;
+            flc = lod ? &slot->lod : NULL;
+            fbatch = slot->batch;
+            fatx = slot->atx;
+            faty = slot->aty;
+            ft = slot->t;
+            fsym = slot->draw_sym;
+        }
+        else if (replaying)
+        {
+            // Repetición: la lista grabada (mapeada, sin copia) reemplaza física y pre-cálculo
+            mark = SDL_GetPerformanceCounter();
+            const SnapFrame *sf = snap_frame(&snap, frames_done % snap.h->frames, &fatx, &faty, &fpc);
+            lodc.nuc = sf->nuc;
+            lodc.full = sf->full;
+            lodc.splat = sf->splat;
+            flc = cfg.lod ? &lodc : NULL;
+            ft = sf->t;
+            fsym = sf->sym;
+            if (batch)
+                snap_emit_batch(batch, &cfg, fpc, sf->count, flc, fsym, worldW * 0.5f, outH * 0.5f);
+            stage_lap(&stimes, STAGE_PRECALC, &mark);
+        }
+        else if (gpu)
+        {
+            // Física y vértices en el dispositivo; pc no se escribe (gpu_unsupported descarta a quien lo lee)
+            gpu_frame(gpu, &cfg, lut, &orbs, &att, batch, (float)dt, (float)t_sec, worldW, outH, draw_sym, stimes.frame);
+        }
+        else
+        {
+            simulate_frame(&cfg, lut, &orbs, grid, &att, lod, (float)dt, (float)t_sec, worldW, outH, pc, &lodc, mpi ? NULL : batch,
+                           draw_sym, stimes.frame, mpi);
+            if (mpi && batch)
+            {
+                // Vértices de la tesela del rank, con el Precomp ya completo
+                mark = SDL_GetPerformanceCounter();
+                snap_emit_batch(batch, &cfg, pc, cfg.n, NULL, draw_sym, worldW * 0.5f - view_x0, outH * 0.5f);
+                stage_lap(&stimes, STAGE_PRECALC, &mark);
+            }
+        }
+        const int fn = flc ? flc->nuc + flc->full + flc->splat : cfg.n; // Entradas de fpc a dibujar
+        if (snap_out && !snap_frames_put(snap_out, ft, fsym, fpc, fn, flc, fatx, faty, att.n))
+        {
+            fprintf(stderr, "--save-frames: error al escribir '%s'; se deja de grabar\n", cfg.save_frames);
+            snap_frames_close(snap_out);
+            snap_out = NULL;
+        }
+        // Las vistas extra dibujan este mismo frame en sus hilos mientras main dibuja la salida 0
+        outputs_draw(outs, &cfg, fpc, fn, flc, fatx, faty, att.n, ft, fsym);
+
+        // Render con o sin SSAA (RT escalado; con --record siempre hay RT); headless no presenta
+        mark = SDL_GetPerformanceCounter();
+        int draws = 0; // Llamadas de dibujo de la salida 0
+        if (rec && !cpu)
+        {
+            // Lectura del frame de hace REC_LAG frames (ya presentado): cuenta en resolve
+            record_readback(ren, rec);
+            stage_lap(&stimes, STAGE_RESOLVE, &mark);
+        }
+        if (cpu)
+        {
+            // Rasterizador CPU: tiles en paralelo; resolve = reducción SSAA + subida
+            cpu_raster_frame(cpu, &cfg, fpc, fn, flc, fsym, ft);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
+            cpu_raster_present(ren, cpu);
+            draws = 1;
+            if (rec)
+                record_image(rec, cpu_raster_image(cpu));
+            if (cfg.show_attractors)
+            {
+                draw_attractors(ren, &cfg, fatx, faty, att.n, 0.0f, ft);
+                draws += att.n;
+            }
+            stage_lap(&stimes, STAGE_RESOLVE, &mark);
+        }
+        else if (rt)
         {
             SDL_SetRenderTarget(ren, rt);
             SDL_RenderSetScale(ren, (float)cfg.ssaa, (float)cfg.ssaa);
-            render_frame(ren, &cfg, pc, cfg.n, att, outW, outH, (float)t_sec, draw_sym, discs, radial);
+            draws = render_frame(ren, &cfg, fpc, fn, flc, fatx, faty, att.n, outW, outH, view_x0, ft, fsym, discs, radial, fbatch, gl);
             SDL_RenderSetScale(ren, 1.0f, 1.0f);
             SDL_SetRenderTarget(ren, NULL);
-            SDL_RenderCopy(ren, rt, NULL, NULL);
-            SDL_RenderPresent(ren);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
+            if (rec)
+                record_resolve(ren, rec, rt);
+            else
+                SDL_RenderCopy(ren, rt, NULL, NULL);
+            draws++;
+            stage_lap(&stimes, STAGE_RESOLVE, &mark);
         }
         else
         {
-            render_frame(ren, &cfg, pc, cfg.n, att, outW, outH, (float)t_sec, draw_sym, discs, radial);
+            draws = render_frame(ren, &cfg, fpc, fn, flc, fatx, faty, att.n, outW, outH, view_x0, ft, fsym, discs, radial, fbatch, gl);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
+        }
+        draws_total += (uint64_t)draws;
+        if (ovl && ovl_visible)
+        {
+            // Sobre la ventana (fuera del RT y de --record): cuenta como render
+            overlay_draw(ren, ovl, cfg.target_fps);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
+        }
+        if (!cfg.headless)
+        {
             SDL_RenderPresent(ren);
+            stage_lap(&stimes, STAGE_PRESENT, &mark);
+        }
+        if (outs)
+        {
+            outputs_wait(outs); // Leen fpc y la lista: antes de devolver el slot o simular el siguiente
+            stage_lap(&stimes, STAGE_WAIT, &mark);
+        }
+        if (slot)
+        {
+            // Devuelve el slot con los parámetros vigentes para su próximo llenado
+            slot->req_dt = dt;
+            slot->req_sym = draw_sym;
+            slot->req_render_frac = cfg.render_frac;
+            slot->req_lod_budget = cfg.lod_budget;
+            slot->req_glow = cfg.glow;
+            SDL_SemPost(pipe->free_sem);
+            pipe_k ^= 1;
+        }
+        if (cfg.adapt == 1)
+        {
+            AdaptKnobs k = adapt_current(&cfg, draw_sym, lod_budget_max);
+            adapt_observe(&actl, &cfg, &k, lod_budget_max, outW, outH, stimes.frame);
         }
+        if (blog)
+        {
+            LogRecord lr = {t_sec, frames_done, (float)fps_inst, (float)fpsc.smoothed_fps, {0}, cfg.ssaa, draw_sym, cfg.glow,
+                            cfg.render_frac, cfg.lod_budget, (float)actl.pred_ms};
+            for (int s = 0; s < STAGE_COUNT; ++s)
+                lr.stage_ms[s] = (float)(ticks_to_seconds(stimes.frame[s]) * 1000.0);
+            blog_push(blog, &lr);
+        }
+        if (ovl)
+            overlay_observe(ovl, stimes.frame, draws);
+        stage_end_frame(&stimes);
+        frames_done++;
 
         // Logging periódico
         if (logfp)
@@ -1230,20 +7517,36 @@ int main(int argc, char **argv)
             uint64_t elapsed_ms = ticks_to_ms_u64(now_ticks - start_ticks);
             if (elapsed_ms >= last_log_ms + (uint64_t)cfg.log_every_ms)
             {
-                fprintf(logfp, "%.3f,%.3f,%.3f,%d,%d,%d,%s,%d,%d,%d,%.2f,%d\n",
+                fprintf(logfp, "%.3f,%.3f,%.3f,%d,%d,%d,%s,%d,%d,%d,%.2f,%d,%d,%d,%d,%d,%d,%d,%s,%d,%d,%s,%d,%s,%.1f,%.1f,%d,%d,%d,%.0f,%d,%d,%.3f,%.3f,%.3f,%d,%d,%s,%d,%d,%d",
                         t_sec, fpsc.smoothed_fps, fps_inst,
                         cfg.n, cfg.width, cfg.height, cfg.palette, cfg.vsync,
-                        eff_threads, cfg.ssaa, cfg.render_frac, draw_sym);
+                        eff_threads, cfg.ssaa, cfg.render_frac, draw_sym, cfg.headless, cfg.fused, cfg.fast_math, cfg.color_lut, cfg.batch, cfg.pipeline,
+                        BACKEND_NAMES[cfg.backend], cfg.deterministic, arena.huge,
+                        SCHED_NAMES[cfg.schedule], cfg.chunk, BIND_NAMES[cfg.bind], cfg.interact, cfg.interact_radius, att.n, att.k,
+                        cfg.lod, cfg.lod_budget, cfg.adapt, cfg.glow, actl.pred_ms, actl.theta[0], actl.theta[1] + actl.resolve, actl.changes, replaying ? 1 : 0,
+                        executor_get(cfg.exec)->name, cfg.gpu, cfg.outputs, draws);
+                executor_take_stats(&work_win);
+                work_add(&work_total, &work_win);
+                work_csv_row(logfp, &work_win);
+                stage_csv_row(logfp, &stimes);
+                fputc('\n', logfp);
                 fflush(logfp);
                 last_log_ms = elapsed_ms;
             }
         }
 
+        if (cfg.headless)
+            continue; // Sin ventana: no hay título que actualizar
+        uint64_t now_ticks = SDL_GetPerformanceCounter();
+        if (title_ticks != 0 && ticks_to_ms_u64(now_ticks - title_ticks) < TITLE_PERIOD_MS)
+            continue;
+        title_ticks = now_ticks;
+
         // Título de ventana con estado en vivo
-        char title[420];
+        char title[440];
         snprintf(title, sizeof(title),
                  "Screensaver (paralelo%s) | FPS: %.1f | thr=%d | N=%d win=%dx%d draw=%dx%d RT=%dx%d SSAA=%d | "
-                 "palette=%s sat=%.2f bgA=%d glow=%d trail=%d | pt=%.2f | sym=%d mir=%d frac=%.2f",
+                 "palette=%s sat=%.2f bgA=%d glow=%d trail=%d | pt=%.2f | sym=%d mir=%d frac=%.2f | draws=%d",
 #ifdef _OPENMP
                  " OMP"
 #else
@@ -1259,13 +7562,60 @@ int main(int argc, char **argv)
                  ,
                  cfg.n, cfg.width, cfg.height, outW, outH, RW, RH, cfg.ssaa,
                  cfg.palette, cfg.sat_mul, cfg.bg_alpha, cfg.glow, cfg.trail, cfg.point_scale,
-                 draw_sym, cfg.mirror, cfg.render_frac);
+                 draw_sym, cfg.mirror, cfg.render_frac, draws);
         SDL_SetWindowTitle(win, title);
     }
 
+    double wall_s = ticks_to_seconds(SDL_GetPerformanceCounter() - wall0);
+    double sim_t = t_sec; // Tiempo del estado de orbs (con pipeline, el del productor)
+    pipeline_stop(pipe, &sim_t);
+    outputs_destroy(outs);
+    record_finish(ren, rec);
+    if (gpu && !gpu_download(gpu, &orbs))
+        fprintf(stderr, "--gpu 1: no se pudo leer el estado del dispositivo\n");
+    if (cfg.headless)
+    {
+        stage_report(stdout, &stimes, &cfg, eff_threads, wall_s);
+        prof_report(stdout, stimes.frames, draws_total);
+        executor_take_stats(&work_win);
+        work_add(&work_total, &work_win);
+        work_report(stdout, &work_total);
+    }
+    if (cfg.trace_path[0] != '\0')
+    {
+        if (trace_write(cfg.trace_path))
+            printf("Traza: %zu eventos en '%s'\n", prof.nev, cfg.trace_path);
+        else
+            fprintf(stderr, "--trace: no se pudo escribir '%s'\n", cfg.trace_path);
+    }
+    if (cfg.deterministic && !replaying)
+    {
+        mpi_gather_orbiters(mpi, &orbs); // Con MPI el checksum cubre los tramos de todos los ranks
+        printf("Estado final: frames=%d N=%d mundo=%dx%d seed=%u fast_math=%d checksum=%016llx\n",
+               frames_done, cfg.n, worldW, outH, (unsigned)cfg.seed, cfg.fast_math,
+               (unsigned long long)orbiters_checksum(&orbs));
+    }
+
+    if (cpu && cfg.dump_path[0] != '\0' && frames_done > 0 && !cpu_raster_dump(cpu, cfg.dump_path))
+        fprintf(stderr, "No se pudo escribir '%s'\n", cfg.dump_path);
+    if (cfg.save_state[0] != '\0')
+    {
+        if (snap_save_state(cfg.save_state, &cfg, &att, &arena, worldW, outH, frames_base + frames_done, sim_t))
+            printf("Instantánea: N=%d t=%.3f s en '%s'\n", cfg.n, sim_t, cfg.save_state);
+        else
+            fprintf(stderr, "No se pudo escribir la instantánea '%s'\n", cfg.save_state);
+    }
+    if (!snap_frames_close(snap_out))
+        fprintf(stderr, "--save-frames: error al cerrar '%s'\n", cfg.save_frames);
+
     // Liberación ordenada de recursos
+    stage_free(&stimes);
+    overlay_free(ovl);
+    prof_free();
     if (logfp)
         fclose(logfp);
+    if (!blog_close(blog))
+        fprintf(stderr, "Error al escribir log '%s'\n", cfg.log_path);
     for (int r = 1; r <= 5; ++r)
         if (discs[r])
             SDL_DestroyTexture(discs[r]);
@@ -1273,10 +7623,21 @@ int main(int argc, char **argv)
         SDL_DestroyTexture(radial);
     if (rt)
         SDL_DestroyTexture(rt);
-    free(pc);
-    free(orbs);
+    cpu_raster_free(cpu);
+    gpu_free(gpu); // Antes que batch: sus buffers envuelven batch->v
+    batch_free(batch);
+    gl_sprites_free(gl); // Con el contexto de ren aún vivo
+    grid_free(grid);
+    lod_free(lod);
+    free(lut);
+    arena_destroy(&arena); // Orbiters + Precomp
+    snap_close(&snap);
+    attractors_free(&att);
     SDL_DestroyRenderer(ren);
-    SDL_DestroyWindow(win);
+    if (win)
+        SDL_DestroyWindow(win);
+    if (offscreen)
+        SDL_FreeSurface(offscreen);
     SDL_Quit();
     return 0;
 }
\ No newline at end of file
@@ -10,11 +10,14 @@
  *  - Inicializa SDL2 (ventana + renderer; opcional SSAA como render target).
  *  - Construye 3 atractores con movimiento senoidal y N orbitadores.
  *  - Integra la dinámica por cuadro y dibuja partículas + estelas con simetría.
- *  - Registra métricas a CSV si se especifica (--log).
+ *  - Registra métricas a CSV si se especifica (--log), con media y p95 por
+ *    etapa del frame (eventos, update, render, resolución SSAA, present).
  *  - Finaliza al presionar ESC, cerrar la ventana o al agotar --seconds>0.
  *
  * Dependencias: SDL2 (o SDL en Windows), math.h para trigonometría,
- * y uso de reloj de alto rendimiento para medir FPS y dt.
+ * y uso de reloj de alto rendimiento para medir FPS y dt. El mundo, la física
+ * y el color base salen de comun/src/mandala_core (igual que el paralelo),
+ * recorridos con el ejecutor en serie.
  */
 
 #include <stdio.h>
@@ -33,9 +36,7 @@
 #include <SDL2/SDL.h>
 #endif
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+#include "mandala_core.h" // Mundo, física y utilidades compartidas con el paralelo
 
 /** RGBA de 8 bits por canal.
  *  Representa un color con componentes rojo, verde, azul y alpha (opacidad). */
@@ -67,6 +68,9 @@ typedef struct
     float sat_mul; // Multiplicador global de saturación (0..1) para paletas.
     int glow;      // 1=usa blending aditivo (glow), 0=modo limpio.
     int bg_alpha;  // Alpha del “fade” de fondo por frame (0..255): mayor => más arrastre.
+    // Benchmark reproducible:
+    int deterministic; // 1=dt fijo (FIXED_DT), corta tras `frames` frames e imprime checksum.
+    int frames;        // Frames a simular con --deterministic 1 (>=1).
 } Config;
 
 /** Muestra ayuda de CLI con valores por defecto y opciones válidas.
@@ -78,62 +82,14 @@ static void print_usage(const char *exe)
             "Uso: %s [--n N] [--width W] [--height H] [--seconds S] [--seed SEED] "
             "[--palette NAME] [--vsync 0|1] [--log PATH] [--log-every-ms MS] "
             "[--show-attractors 0|1] [--point-scale F] [--sym K] [--mirror 0|1] [--ssaa K] "
-            "[--sat F] [--glow 0|1] [--bg-alpha A]\n"
+            "[--sat F] [--glow 0|1] [--bg-alpha A] [--deterministic 0|1] [--frames F]\n"
             "Defaults: N=100, W=800, H=600, S=10 (<=0 infinito), SEED=now, "
             "PALETTE=neon, VSYNC=1, LOG_EVERY_MS=500, SHOW_ATTRACTORS=0, POINT_SCALE=1.0, "
-            "SYM=6, MIRROR=1, SSAA=2, SAT=0.65, GLOW=0, BG_ALPHA=10\n"
+            "SYM=6, MIRROR=1, SSAA=2, SAT=0.65, GLOW=0, BG_ALPHA=10, DETERMINISTIC=0, FRAMES=600\n"
             "Paletas: neon | ocean\n",
             exe);
 }
 
-/** Convierte entero desde string con validación robusta.
- *  @param s   Cadena a convertir.
- *  @param out Puntero de salida para el entero.
- *  @return true si convierte correctamente en el rango de int; false en caso contrario. */
-static bool parse_int(const char *s, int *out)
-{
-    char *end = NULL;
-    long v = strtol(s, &end, 10);
-    if (end == NULL || *end != '\0')
-        return false; // Falla si hay basura al final o no hay número.
-    if (v < INT_MIN || v > INT_MAX)
-        return false; // Falla si excede rangos de int.
-    *out = (int)v;
-    return true;
-}
-
-/** Convierte float desde string con validación.
- *  @param s   Cadena a convertir.
- *  @param out Puntero de salida para el float.
- *  @return true si convierte correctamente; false en caso contrario. */
-static bool parse_float(const char *s, float *out)
-{
-    char *end = NULL;
-    float v = strtof(s, &end);
-    if (end == NULL || *end != '\0')
-        return false; // Falla si hay caracteres extra.
-    *out = v;
-    return true;
-}
-
-/** Compara cadenas C de forma case-insensitive.
- *  @param a Cadena A.
- *  @param b Cadena B.
- *  @return true si son iguales ignorando mayúsculas/minúsculas; false si difieren. */
-static bool str_ieq(const char *a, const char *b)
-{
-    if (!a || !b)
-        return false;
-    while (*a && *b)
-    {
-        char ca = (char)tolower((unsigned char)*a++);
-        char cb = (char)tolower((unsigned char)*b++);
-        if (ca != cb)
-            return false;
-    }
-    return *a == '\0' && *b == '\0';
-}
-
 /** Parsea los argumentos CLI y aplica programación defensiva.
  *  - Valida rangos numéricos.
  *  - Aplica mínimos (resolución/N).
@@ -163,6 +119,8 @@ static Config parse_args(int argc, char **argv)
     cfg.sat_mul = 0.65f;    // Saturación contenida.
     cfg.glow = 0;           // Modo “limpio” por defecto.
     cfg.bg_alpha = 10;      // Fade de fondo moderado.
+    cfg.deterministic = 0;  // dt de reloj real por defecto.
+    cfg.frames = 600;       // 10 s simulados a FIXED_DT.
 
     // Bucle de parseo de flags
     for (int i = 1; i < argc; ++i)
@@ -360,6 +318,28 @@ static Config parse_args(int argc, char **argv)
                 aint = 255;
             cfg.bg_alpha = aint;
         }
+        else if (strcmp(a, "--deterministic") == 0)
+        {
+            int v;
+            NEED();
+            if (!parse_int(argv[++i], &v))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            cfg.deterministic = v ? 1 : 0;
+        }
+        else if (strcmp(a, "--frames") == 0)
+        {
+            NEED();
+            if (!parse_int(argv[++i], &cfg.frames))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            if (cfg.frames < 1)
+                cfg.frames = 1;
+        }
         else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0)
         {
             print_usage(argv[0]);
@@ -391,251 +371,12 @@ static Config parse_args(int argc, char **argv)
     return cfg;
 }
 
-// ------------------------ Utilidades ------------------------
-
-/** Genera un float uniforme en [0,1]. */
-static float frand01(void) { return (float)rand() / (float)RAND_MAX; }
-
-/** Genera un float uniforme en [a,b]. */
-static float frand_range(float a, float b) { return a + (b - a) * frand01(); }
-
-/** Satura un entero a Uint8 [0,255]. */
-static Uint8 clamp_u8(int v)
-{
-    if (v < 0)
-        v = 0;
-    if (v > 255)
-        v = 255;
-    return (Uint8)v;
-}
-
-/** Conversión HSV→RGB en 8bpc.
- *  Entradas: h en grados [0..360), s en [0..1], v en [0..1].
- *  Salida: r,g,b en [0..255]. */
-static void hsv2rgb(float h, float s, float v, Uint8 *r, Uint8 *g, Uint8 *b)
-{
-    float C = v * s, X = C * (1.0f - fabsf(fmodf(h / 60.0f, 2.0f) - 1.0f)), m = v - C;
-    float R = 0, G = 0, B = 0;
-    if (h < 60)
-    {
-        R = C;
-        G = X;
-        B = 0;
-    }
-    else if (h < 120)
-    {
-        R = X;
-        G = C;
-        B = 0;
-    }
-    else if (h < 180)
-    {
-        R = 0;
-        G = C;
-        B = X;
-    }
-    else if (h < 240)
-    {
-        R = 0;
-        G = X;
-        B = C;
-    }
-    else if (h < 300)
-    {
-        R = X;
-        G = 0;
-        B = C;
-    }
-    else
-    {
-        R = C;
-        G = 0;
-        B = X;
-    }
-    *r = clamp_u8((int)((R + m) * 255.0f));
-    *g = clamp_u8((int)((G + m) * 255.0f));
-    *b = clamp_u8((int)((B + m) * 255.0f));
-}
-
-/** Medidor de FPS con suavizado exponencial.
- *  - last_ticks: último sello temporal de alto rendimiento.
- *  - smoothed_fps: FPS suavizados (EMA).
- *  - alpha: factor de suavizado [0..1], mayor => responde más rápido. */
-typedef struct
-{
-    uint64_t last_ticks;
-    double smoothed_fps;
-    double alpha;
-} FPSCounter;
-
-/** Convierte ticks de alto rendimiento a segundos. */
-static double ticks_to_seconds(uint64_t ticks) { return (double)ticks / (double)SDL_GetPerformanceFrequency(); }
-
-/** Convierte ticks a milisegundos (uint64). Hace redondeo correcto. */
-static uint64_t ticks_to_ms_u64(uint64_t ticks)
-{
-    double ms = (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
-    if (ms < 0.0)
-        ms = 0.0;
-    return (uint64_t)(ms + 0.5);
-}
-
-/** Avanza el contador de FPS y entrega dt (segundos) desde la última llamada.
- *  @param f        Estructura FPSCounter (estado).
- *  @param fps_inst Salida opcional: FPS instantáneo (1/dt).
- *  @return dt en segundos (capaz de ser 0 si no pasó tiempo). */
-static double fps_tick(FPSCounter *f, double *fps_inst)
-{
-    uint64_t now = SDL_GetPerformanceCounter();
-    double dt = ticks_to_seconds(now - f->last_ticks);
-    f->last_ticks = now;
-    double inst = (dt > 0.0) ? (1.0 / dt) : 0.0;
-    if (f->smoothed_fps <= 0.0)
-        f->smoothed_fps = inst; // Inicializa EMA
-    else
-        f->smoothed_fps = f->alpha * inst + (1.0 - f->alpha) * f->smoothed_fps;
-    if (fps_inst)
-        *fps_inst = inst;
-    return dt;
-}
-
 // ------------------------ Atractores y Orbitadores ------------------------
 
-/** Atractor con movimiento senoidal independiente en X/Y.
- *  x,y: posición actual (se actualiza cada frame).
- *  ax,ay: amplitudes de oscilación (en px).
- *  fx,fy: frecuencias en rad/seg.
- *  phx,phy: fases en radianes (desfase inicial). */
-typedef struct
-{
-    float x, y;
-    float ax, ay;
-    float fx, fy;
-    float phx, phy;
-} Attractor;
-
-/** Orbitador/Partícula con dinámica resorte-amortiguador hacia una órbita
- *  desplazada alrededor de un atractor.
- *  - (x,y): posición actual, (px,py): posición previa (para trazar estela).
- *  - (vx,vy): velocidad.
- *  - att: índice del atractor que sigue [0..NUM_ATTR-1].
- *  - angle/radius/omega: parametrización polar de la órbita alrededor del atractor.
- *  - k/damping: constante de resorte y amortiguamiento para estabilidad.
- *  - size_*: controlan “pulso” y tamaño del punto renderizado. */
-typedef struct
-{
-    float x, y;
-    float px, py;
-    float vx, vy;
-    int att;
-    float angle;
-    float radius;
-    float omega;
-    float k;
-    float damping;
-    // Estética del puntito animado (respiración/pulso)
-    float size_base, size_amp, size_speed, size_phase;
-} Orbiter;
-
+/* Attractors/Orbiters (SoA), su inicialización y la física vienen de
+ * mandala_core; aquí se recorren con el ejecutor en serie. */
 #define NUM_ATTR 3 // Se modelan exactamente 3 atractores coordinados.
 
-/** Inicializa los 3 atractores centrados con amplitudes/frecuencias aleatorias.
- *  @param a  Arreglo de atractores.
- *  @param W  Ancho de la escena.
- *  @param H  Alto de la escena. */
-static void init_attractors(Attractor a[NUM_ATTR], int W, int H)
-{
-    float cx = W * 0.5f, cy = H * 0.5f;
-    for (int i = 0; i < NUM_ATTR; ++i)
-    {
-        a[i].x = cx;
-        a[i].y = cy;
-        a[i].ax = frand_range(W * 0.20f, W * 0.35f);
-        a[i].ay = frand_range(H * 0.20f, H * 0.35f);
-        float fx_hz = frand_range(0.05f, 0.15f), fy_hz = frand_range(0.05f, 0.15f);
-        a[i].fx = 2.0f * (float)M_PI * fx_hz; // Convierte Hz a rad/s
-        a[i].fy = 2.0f * (float)M_PI * fy_hz;
-        a[i].phx = frand_range(0.0f, (float)M_PI * 2.0f);
-        a[i].phy = frand_range(0.0f, (float)M_PI * 2.0f);
-    }
-}
-
-/** Actualiza las posiciones de los atractores con movimiento senoidal.
- *  @param t  Tiempo acumulado en segundos.
- *  @param W,H Dimensiones (sólo para mantener centro de referencia). */
-static void update_attractors(Attractor a[NUM_ATTR], float t, int W, int H)
-{
-    float cx = W * 0.5f, cy = H * 0.5f;
-    for (int i = 0; i < NUM_ATTR; ++i)
-    {
-        a[i].x = cx + a[i].ax * sinf(a[i].fx * t + a[i].phx);
-        a[i].y = cy + a[i].ay * sinf(a[i].fy * t + a[i].phy);
-    }
-}
-
-/** Crea N orbitadores con radios y fases aleatorias alrededor de atractores.
- *  @param o   Arreglo de orbitadores (prealocado).
- *  @param n   Número de orbitadores.
- *  @param a   Atractores a seguir.
- *  @param W,H Dimensiones para derivar rangos de radio inicial. */
-static void init_orbiters(Orbiter *o, int n, Attractor a[NUM_ATTR], int W, int H)
-{
-    const float minR = (float)((W < H ? W : H)) * 0.08f;
-    const float maxR = (float)((W < H ? W : H)) * 0.38f;
-    for (int i = 0; i < n; ++i)
-    {
-        o[i].att = i % NUM_ATTR;               // Reparte orbitadores sobre 3 atractores
-        o[i].radius = frand_range(minR, maxR); // Radio de la órbita
-        o[i].angle = frand_range(0.0f, (float)M_PI * 2.0f);
-        float hz = frand_range(0.04f, 0.35f);
-        o[i].omega = 2.0f * (float)M_PI * hz;   // rad/s
-        o[i].k = frand_range(4.0f, 10.0f);      // Constante de resorte
-        o[i].damping = frand_range(1.4f, 3.2f); // Amortiguamiento (reduce oscilaciones)
-        // Posición inicial en la órbita
-        float tx = a[o[i].att].x + cosf(o[i].angle) * o[i].radius;
-        float ty = a[o[i].att].y + sinf(o[i].angle) * o[i].radius;
-        o[i].x = o[i].px = tx;
-        o[i].y = o[i].py = ty;
-        o[i].vx = o[i].vy = 0.0f;
-        // Parámetros estéticos de “pulso” del punto
-        o[i].size_base = frand_range(2.0f, 3.5f);
-        o[i].size_amp = frand_range(1.2f, 2.8f);
-        o[i].size_speed = frand_range(0.6f, 1.6f) * 2.0f * (float)M_PI; // rad/s
-        o[i].size_phase = frand_range(0.0f, 2.0f * (float)M_PI);
-    }
-}
-
-/** Integra la dinámica de cada orbitador (resorte-amortiguador explícito).
- *  Actualiza posición previa, avanza el ángulo, calcula destino (tx,ty) orbitando
- *  el atractor, y aplica fuerzas tipo resorte con amortiguamiento.
- *  @param dt   Delta de tiempo del frame (segundos). */
-static void update_orbiters(Orbiter *o, int n, Attractor a[NUM_ATTR], float dt, int W, int H)
-{
-    (void)W;
-    (void)H; // No se usan actualmente
-    for (int i = 0; i < n; ++i)
-    {
-        Orbiter *p = &o[i];
-        p->px = p->x;
-        p->py = p->y;              // Guarda la posición anterior (para estela)
-        p->angle += p->omega * dt; // Avanza el ángulo de la órbita
-
-        // Punto objetivo sobre la órbita alrededor del atractor
-        float tx = a[p->att].x + cosf(p->angle) * p->radius;
-        float ty = a[p->att].y + sinf(p->angle) * p->radius;
-
-        // Aceleración tipo resorte (k*(dest - pos)) con amortiguamiento (-damping*vel)
-        float ax = p->k * (tx - p->x) - p->damping * p->vx;
-        float ay = p->k * (ty - p->y) - p->damping * p->vy;
-
-        // Integración explícita (Euler)
-        p->vx += ax * dt;
-        p->vy += ay * dt;
-        p->x += p->vx * dt;
-        p->y += p->vy * dt;
-    }
-}
-
 // ------------------------ Dibujo ------------------------
 
 /** Dibuja un disco sólido mediante scanlines (rápido y sin texturas).
@@ -703,19 +444,9 @@ static void palette_color(const Config *cfg, int i, float t, Uint8 *r, Uint8 *g,
 {
     float hue, sat, val;
     if (str_ieq(cfg->palette, "ocean"))
-    {
-        hue = 180.0f + fmodf((float)i * 3.5f + 18.0f * sinf(0.21f * t + i * 0.05f), 40.0f);
-        sat = 0.65f + 0.20f * sinf(0.13f * t + i * 0.09f);
-        val = 0.95f;
-    }
+        ocean_particle_hsv(i, t, &hue, &sat, &val);
     else
-    { // neon (default)
-        hue = fmodf((float)i * 137.508f + 90.0f * sinf(0.23f * t + i * 0.031f), 360.0f);
-        if (hue < 0.0f)
-            hue += 360.0f;
-        sat = 0.85f;
-        val = 1.00f;
-    }
+        neon_particle_hsv(i, t, &hue, &sat, &val); // neon (default)
     sat *= cfg->sat_mul; // Control global de saturación
     if (sat < 0.0f)
         sat = 0.0f;
@@ -754,7 +485,7 @@ static RGBA palette_bg_tint(const Config *cfg, float t)
  *   - alpha_div: factor de división para repartir alpha cuando hay múltiples copias por simetría/espejo.
  *   - glow_on: activa blending aditivo para halos/estelas más brillantes.
  */
-static void render_frame(SDL_Renderer *ren, Orbiter *o, int n, Attractor a[NUM_ATTR], int W, int H, float t, const Config *cfg)
+static void render_frame(SDL_Renderer *ren, const Orbiters *o, const Attractors *a, int W, int H, float t, const Config *cfg)
 {
     int symN = cfg->sym;
     if (symN < 1)
@@ -781,25 +512,18 @@ static void render_frame(SDL_Renderer *ren, Orbiter *o, int n, Attractor a[NUM_A
     SDL_RenderFillRect(ren, &full);
 
     // (2) Puntos + estelas + colitas + halos/núcleos con simetría y espejo
-    for (int i = 0; i < n; ++i)
+    for (int i = 0; i < o->n; ++i)
     {
         Uint8 rr, gg, bb;
         palette_color(cfg, i, t, &rr, &gg, &bb);
 
         // Vectores relativos al centro para aplicar rotaciones de simetría
-        float dx0 = o[i].x - cx, dy0 = o[i].y - cy;
-        float dxp = o[i].px - cx, dyp = o[i].py - cy;
+        float dx0 = o->x[i] - cx, dy0 = o->y[i] - cy;
+        float dxp = o->px[i] - cx, dyp = o->py[i] - cy;
 
-        // Tamaño del punto: base + pulso + (ligero) escalado por velocidad
-        float spd = sqrtf(o[i].vx * o[i].vx + o[i].vy * o[i].vy);
-        float breath = 0.5f + 0.5f * sinf(o[i].size_speed * t + o[i].size_phase);
-        float base = o[i].size_base * cfg->point_scale;
-        float amp = o[i].size_amp * cfg->point_scale;
-        int pr = (int)lroundf(base + amp * breath + fminf(2.0f, spd * 0.015f));
-        if (pr < 1)
-            pr = 1;
-        if (pr > 3)
-            pr = 3; // Se limita para una apariencia “HD”
+        // Tamaño del punto: base + pulso + (ligero) escalado por velocidad, en [1..3]
+        float breath;
+        int pr = particle_radius(o, i, t, cfg->point_scale, &breath);
 
         // Alphas derivados según presencia de glow y cantidad de copias (simetrías+espejo)
         float a_scale = glow_on ? 1.0f : 0.6f;
@@ -861,36 +585,39 @@ static void render_frame(SDL_Renderer *ren, Orbiter *o, int n, Attractor a[NUM_A
     // (3) Atractores (opcional)
     if (cfg->show_attractors)
     {
-        for (int k = 0; k < NUM_ATTR; ++k)
+        for (int k = 0; k < a->n; ++k)
         {
             Uint8 rr2, gg2, bb2;
             palette_attractor_color(cfg->palette, k, t, &rr2, &gg2, &bb2);
-            draw_radial_glow(ren, (int)lroundf(a[k].x), (int)lroundf(a[k].y), 10, rr2, gg2, bb2);
+            draw_radial_glow(ren, (int)lroundf(a->x[k]), (int)lroundf(a->y[k]), 10, rr2, gg2, bb2);
         }
         // Líneas tenues que conectan los atractores
         SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_ADD);
-        for (int i = 0; i < NUM_ATTR; ++i)
+        for (int i = 0; i < a->n; ++i)
         {
-            int j = (i + 1) % NUM_ATTR;
+            int j = (i + 1) % a->n;
             SDL_SetRenderDrawColor(ren, 255, 255, 255, 18);
-            SDL_RenderDrawLine(ren, (int)lroundf(a[i].x), (int)lroundf(a[i].y),
-                               (int)lroundf(a[j].x), (int)lroundf(a[j].y));
+            SDL_RenderDrawLine(ren, (int)lroundf(a->x[i]), (int)lroundf(a->y[i]),
+                               (int)lroundf(a->x[j]), (int)lroundf(a->y[j]));
         }
     }
 }
 
+#define FIXED_DT (1.0 / 60.0) // Paso fijo de --deterministic 1 (igual a HEADLESS_DT del paralelo)
+#define TITLE_PERIOD_MS 500   // Período del título con estado en vivo (igual que el paralelo)
+
 /** Punto de entrada:
- *  - Parsea argumentos y siembra RNG.
+ *  - Parsea argumentos (la semilla alimenta el RNG por contador).
  *  - Inicializa SDL, ventana y renderer (con VSync si corresponde).
  *  - Configura SSAA como render target si ssaa>1.
  *  - Genera mundo (3 atractores + N orbitadores).
  *  - Bucle principal: eventos, dt/FPS, update, render, logging CSV.
+ *  - Con --deterministic 1: dt = FIXED_DT, `frames` frames y checksum final.
  *  - Limpia recursos y cierra SDL.
  */
 int main(int argc, char **argv)
 {
-    Config cfg = parse_args(argc, argv);
-    srand((unsigned)cfg.seed); // Si seed=0, parse_args ya lo reemplazó por time(NULL)
+    Config cfg = parse_args(argc, argv); // Si seed=0, parse_args ya lo reemplazó por time(NULL)
 
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0)
     {
@@ -947,19 +674,31 @@ int main(int argc, char **argv)
     SDL_RenderClear(ren);
     SDL_RenderPresent(ren);
 
-    // Mundo: atractores + orbitadores
-    Attractor att[NUM_ATTR];
-    init_attractors(att, outW, outH);
-    Orbiter *orbs = (Orbiter *)malloc(sizeof(Orbiter) * (size_t)cfg.n);
-    if (!orbs)
+    // Mundo: atractores + orbitadores (SoA del núcleo, un bloque alineado)
+    const Executor *ex = executor_get(EXEC_SERIAL);
+    Attractors att;
+    Orbiters orbs;
+#if defined(_WIN32)
+    void *orb_mem = _aligned_malloc(orbiters_bytes(cfg.n), ORB_ALIGN);
+#else
+    void *orb_mem = aligned_alloc(ORB_ALIGN, orbiters_bytes(cfg.n));
+#endif
+    if (!orb_mem || !attractors_alloc(&att, NUM_ATTR, 1))
     {
         fprintf(stderr, "Sin memoria para %d orbitadores\n", cfg.n);
+#if defined(_WIN32)
+        _aligned_free(orb_mem);
+#else
+        free(orb_mem);
+#endif
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
         SDL_Quit();
         return 1;
     }
-    init_orbiters(orbs, cfg.n, att, outW, outH);
+    init_attractors(&att, outW, outH, cfg.seed);
+    orbiters_bind(&orbs, cfg.n, orb_mem);
+    init_orbiters(ex, &orbs, &att, outW, outH, cfg.seed);
 
     // Medición de tiempo y FPS
     bool running = true;
@@ -980,16 +719,27 @@ int main(int argc, char **argv)
             fprintf(stderr, "No se pudo abrir log '%s' para escritura.\n", cfg.log_path);
         else
         {
-            fprintf(logfp, "time_s,smoothed_fps,fps_inst,n,width,height,palette,vsync\n");
+            fprintf(logfp, "time_s,smoothed_fps,fps_inst,n,width,height,palette,vsync");
+            stage_csv_header(logfp);
+            fputc('\n', logfp);
             fflush(logfp);
         }
     }
 
+    StageTimes stimes; // Tiempos por etapa para el CSV
+    memset(&stimes, 0, sizeof(stimes));
+    int frames_done = 0; // Frames simulados (corte de --deterministic)
+    uint64_t title_ticks = 0; // Última actualización del título
+
     // Bucle principal
     while (running)
     {
+        uint64_t mark = SDL_GetPerformanceCounter();
+        // Modo determinista: corta por número de frames, no por tiempo
+        if (cfg.deterministic && frames_done >= cfg.frames)
+            break;
         // Si --seconds > 0, se corta al alcanzar esa duración
-        if (cfg.seconds > 0)
+        if (cfg.seconds > 0 && !cfg.deterministic)
         {
             uint64_t now = SDL_GetPerformanceCounter();
             double elapsed = ticks_to_seconds(now - t0);
@@ -1006,17 +756,22 @@ int main(int argc, char **argv)
             if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
                 running = false;
         }
+        stage_lap(&stimes, STAGE_EVENTS, &mark);
 
         // Timestep y FPS
         double fps_inst = 0.0;
         double dt = fps_tick(&fpsc, &fps_inst); // Calcula dt desde la última iteración
-        if (dt > 0.05)
+        if (cfg.deterministic)
+            dt = FIXED_DT; // Misma trayectoria en cada corrida (y en el paralelo)
+        else if (dt > 0.05)
             dt = 0.05; // Cap para evitar explosiones por pausas largas
         t_sec += dt;
 
         // Actualiza mundo físico/geométrico
-        update_attractors(att, (float)t_sec, outW, outH);
-        update_orbiters(orbs, cfg.n, att, (float)dt, outW, outH);
+        mark = SDL_GetPerformanceCounter();
+        update_attractors(ex, &att, (float)t_sec, outW, outH);
+        update_orbiters(ex, &orbs, &att, (float)dt, FASTMATH_OFF);
+        stage_lap(&stimes, STAGE_UPDATE, &mark);
 
         // Logging periódico (si está activo)
         if (logfp)
@@ -1025,29 +780,42 @@ int main(int argc, char **argv)
             uint64_t elapsed_ms = ticks_to_ms_u64(now_ticks - start_ticks);
             if (elapsed_ms >= last_log_ms + (uint64_t)cfg.log_every_ms)
             {
-                fprintf(logfp, "%.3f,%.3f,%.3f,%d,%d,%d,%s,%d\n",
+                fprintf(logfp, "%.3f,%.3f,%.3f,%d,%d,%d,%s,%d",
                         t_sec, fpsc.smoothed_fps, fps_inst, cfg.n, cfg.width, cfg.height, cfg.palette, cfg.vsync);
+                stage_csv_row(logfp, &stimes);
+                fputc('\n', logfp);
                 fflush(logfp);
                 last_log_ms = elapsed_ms;
             }
         }
 
         // Renderiza: si hay SSAA, dibuja en el render target grande y luego lo copia
+        mark = SDL_GetPerformanceCounter();
         if (cfg.ssaa > 1 && rt)
         {
             SDL_SetRenderTarget(ren, rt);
             SDL_RenderSetScale(ren, (float)cfg.ssaa, (float)cfg.ssaa); // Opcional; dibuja en “escala 1” lógica
-            render_frame(ren, orbs, cfg.n, att, outW, outH, (float)t_sec, &cfg);
+            render_frame(ren, &orbs, &att, outW, outH, (float)t_sec, &cfg);
             SDL_RenderSetScale(ren, 1.0f, 1.0f);
             SDL_SetRenderTarget(ren, NULL);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
             SDL_RenderCopy(ren, rt, NULL, NULL);
-            SDL_RenderPresent(ren);
+            stage_lap(&stimes, STAGE_RESOLVE, &mark);
         }
         else
         {
-            render_frame(ren, orbs, cfg.n, att, outW, outH, (float)t_sec, &cfg);
-            SDL_RenderPresent(ren);
+            render_frame(ren, &orbs, &att, outW, outH, (float)t_sec, &cfg);
+            stage_lap(&stimes, STAGE_RENDER, &mark);
         }
+        SDL_RenderPresent(ren);
+        stage_lap(&stimes, STAGE_PRESENT, &mark);
+        stage_end_frame(&stimes);
+        frames_done++;
+
+        uint64_t now_ticks = SDL_GetPerformanceCounter();
+        if (title_ticks != 0 && ticks_to_ms_u64(now_ticks - title_ticks) < TITLE_PERIOD_MS)
+            continue;
+        title_ticks = now_ticks;
 
         // Título de la ventana con estado en vivo
         char title[320];
@@ -1058,10 +826,21 @@ int main(int argc, char **argv)
         SDL_SetWindowTitle(win, title);
     }
 
+    if (cfg.deterministic)
+        printf("Estado final: frames=%d N=%d mundo=%dx%d seed=%u fast_math=0 checksum=%016llx\n",
+               frames_done, cfg.n, outW, outH, (unsigned)cfg.seed,
+               (unsigned long long)orbiters_checksum(&orbs));
+
     // Limpieza y cierre ordenado
+    stage_free(&stimes);
     if (logfp)
         fclose(logfp);
-    free(orbs);
+    attractors_free(&att);
+#if defined(_WIN32)
+    _aligned_free(orb_mem);
+#else
+    free(orb_mem);
+#endif
     SDL_DestroyRenderer(ren);
     SDL_DestroyWindow(win);
     SDL_Quit();